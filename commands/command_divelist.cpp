@@ -602,6 +602,7 @@ void ShiftTime::redoit()
 
 	// Changing times may have unsorted the dive and trip tables
 	sort_dive_table(&dive_table);
+	invalidate_deco_chains();
 	sort_trip_table(&trip_table);
 	for (dive_trip *trip: trips)
 		sort_dive_table(&trip->dives); // Keep the trip-table in order
@@ -297,6 +297,7 @@ bool EditDiveSiteLocation::workToBeDone()
 void EditDiveSiteLocation::redo()
 {
 	std::swap(value, ds->location);
+	invalidate_dive_site_grids();
 	emit diveListNotifier.diveSiteChanged(ds, LocationInformationModel::LOCATION); // Inform frontend of changed dive site.
 }
 
@@ -406,6 +407,7 @@ ApplyGPSFixes::ApplyGPSFixes(const std::vector<DiveAndLocation> &fixes)
 		} else {
 			ds = create_dive_site(qPrintable(dl.name), &dive_site_table);
 			ds->location = dl.location;
+			invalidate_dive_site_grids();
 			add_dive_to_dive_site(dl.d, ds);
 			dl.d->dive_site = nullptr; // This will be set on redo()
 			sitesToAdd.emplace_back(ds);
@@ -422,6 +424,7 @@ void ApplyGPSFixes::editDiveSites()
 {
 	for (SiteAndLocation &sl: siteLocations) {
 		std::swap(sl.location, sl.ds->location);
+		invalidate_dive_site_grids();
 		emit diveListNotifier.diveSiteChanged(sl.ds, LocationInformationModel::LOCATION); // Inform frontend of changed dive site.
 	}
 }
@@ -1378,6 +1378,9 @@ void EditDive::exchangeDives()
 	if (oldDiveSite)
 		unregister_dive_from_dive_site(oldDive); // the dive-site pointer in the dive is now NULL
 	std::swap(*newDive, *oldDive);
+	// The cached tissue loading belongs to the position of the dive in the table.
+	// Keep it and recalculate it in invalidate_dive_cache() below.
+	std::swap(newDive->deco_chain, oldDive->deco_chain);
 	fulltext_register(oldDive);
 	if (newDiveSite)
 		add_dive_to_dive_site(oldDive, newDiveSite);
@@ -1408,6 +1411,7 @@ void EditDive::editDs()
 {
 	if (siteToEdit) {
 		std::swap(siteToEdit->location, dsLocation);
+		invalidate_dive_site_grids();
 		emit diveListNotifier.diveSiteChanged(siteToEdit, LocationInformationModel::LOCATION); // Inform frontend of changed dive site.
 	}
 }
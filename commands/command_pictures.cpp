@@ -206,6 +206,7 @@ void AddPictures::swapDiveSites()
 
 	for (DiveSiteEditEntry &entry: sitesToEdit) {
 		std::swap(entry.ds->location, entry.location);
+		invalidate_dive_site_grids();
 		emit diveListNotifier.diveSiteChanged(entry.ds, LocationInformationModel::LOCATION); // Inform frontend of changed dive site.
 	}
 }
@@ -12,6 +12,8 @@
  * deco_allowed_depth() - ceiling based on lead tissue, surface pressure, 3m increments or smooth
  * set_gf()		- set Buehlmann gradient factors
  * set_vpmb_conservatism() - set VPM-B conservatism value
+ * get_deco_params()	- the current values of these settings and of the deco preferences
+ * deco_ascent_velocity() - the ascent rate at a depth, with the rates of these settings
  * clear_deco()
  * cache_deco_state()
  * restore_deco_state()
@@ -156,17 +158,17 @@ static const double vpmb_conservatism_lvls[] = { 1.0, 1.05, 1.12, 1.22, 1.35 };
 
 #define TISSUE_ARRAY_SZ sizeof(ds->tissue_n2_sat)
 
-static double get_crit_radius_He()
+static double get_crit_radius_He(const struct deco_state *ds)
 {
-	if (vpmb_config.conservatism <= 4)
-		return vpmb_config.crit_radius_He * vpmb_conservatism_lvls[vpmb_config.conservatism] * subsurface_conservatism_factor;
+	if (ds->params.vpmb_conservatism <= 4)
+		return vpmb_config.crit_radius_He * vpmb_conservatism_lvls[ds->params.vpmb_conservatism] * subsurface_conservatism_factor;
 	return vpmb_config.crit_radius_He;
 }
 
-static double get_crit_radius_N2()
+static double get_crit_radius_N2(const struct deco_state *ds)
 {
-	if (vpmb_config.conservatism <= 4)
-		return vpmb_config.crit_radius_N2 * vpmb_conservatism_lvls[vpmb_config.conservatism] * subsurface_conservatism_factor;
+	if (ds->params.vpmb_conservatism <= 4)
+		return vpmb_config.crit_radius_N2 * vpmb_conservatism_lvls[ds->params.vpmb_conservatism] * subsurface_conservatism_factor;
 	return vpmb_config.crit_radius_N2;
 }
 
@@ -218,22 +220,232 @@ static double vpmb_tolerated_ambient_pressure(struct deco_state *ds, double refe
 	return ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci] + vpmb_config.other_gases_pressure - total_gradient;
 }
 
+/*
+ * Return Buehlmann factor for a particular period and tissue index.
+ */
+static double factor(int period_in_seconds, int ci, enum inertgas gas)
+{
+	if (period_in_seconds == 1) {
+		if (gas == N2)
+			return buehlmann_N2_factor_expositon_one_second[ci];
+		else
+			return buehlmann_He_factor_expositon_one_second[ci];
+	}
+
+	// ln(2)/60 = 1.155245301e-02
+	if (gas == N2)
+		return 1.0 - exp(-period_in_seconds * 1.155245301e-02 / buehlmann_N2_t_halflife[ci]);
+	else
+		return 1.0 - exp(-period_in_seconds * 1.155245301e-02 / buehlmann_He_t_halflife[ci]);
+}
+
+/*
+ * Exposure factors for the other step sizes that the profile and the planner use over
+ * and over again: 2s (planner TIMESTEP), 20s (profile interpolation) and 60s (DECOTIMESTEP,
+ * NDL/TTS steps). Computed like factor() does, i.e. 1 - exp(-period / (halflife * 60) * ln(2)),
+ * and printed with enough digits to be bit-identical. Being constant, they can be used
+ * from several threads at once. Other periods fall back to factor().
+ */
+static const double buehlmann_N2_factor_expositon_two_seconds[] = {
+	4.61032089703672376E-03, 2.88394666557723056E-03, 1.84668525625319990E-03, 1.24813427060210813E-03,
+	8.55371221289313866E-04, 6.03079328300393236E-04, 4.25414200624474326E-04, 3.00018699931570154E-04,
+	2.11949150466961278E-04, 1.58240259648056991E-04, 1.23548014481111856E-04, 9.66685742378459167E-05,
+	7.57509209835527386E-05, 5.92415939166812677E-05, 4.63943173648617702E-05, 3.63850168209056690E-05
+};
+
+static const double buehlmann_N2_factor_expositon_twenty_seconds[] = {
+	4.51583960921331240E-02, 2.84680588480155095E-02, 1.83141447542940483E-02, 1.24114727621494891E-02,
+	8.52086250481232099E-03, 6.01445286594803896E-03, 4.24600726231050274E-03, 2.99613973330714600E-03,
+	2.11747113689120248E-03, 1.58127627273929594E-03, 1.23479348603006134E-03, 9.66265334166105383E-04,
+	7.57251042898587912E-04, 5.92258033623616065E-04, 4.63846326159811362E-04, 3.63790599863467179E-04
+};
+
+static const double buehlmann_N2_factor_expositon_one_minute[] = {
+	1.29449436710849741E-01, 8.29959567999201120E-02, 5.39423532774355730E-02, 3.67741962391252564E-02,
+	2.53453908790147731E-02, 1.79350552326865698E-02, 1.26840126033884726E-02, 8.96151553592372530E-03,
+	6.33897185269838292E-03, 4.73633146814378403E-03, 3.69980819593884735E-03, 2.89599589858180462E-03,
+	2.27003327549957223E-03, 1.77572199988185186E-03, 1.39089361803468314E-03, 1.09097481693398723E-03
+};
+
+static const double buehlmann_He_factor_expositon_two_seconds[] = {
+	1.22146319281022375E-02, 7.62143954621230524E-03, 4.88314569592651626E-03, 3.29996599655968392E-03,
+	2.26040968603336001E-03, 1.59437031999110079E-03, 1.12478857844622304E-03, 7.93395367393312512E-04,
+	5.60641471611167397E-04, 4.18555360418348954E-04, 3.26794886571946108E-04, 2.55722289952742265E-04,
+	2.00386772347127540E-04, 1.56716154637748240E-04, 1.22734212227859629E-04, 9.62537767568161229E-05
+};
+
+static const double buehlmann_He_factor_expositon_twenty_seconds[] = {
+	1.15646523768310194E-01, 7.36529322065749836E-02, 4.77722809160535666E-02, 3.25139075662913557E-02,
+	2.23755519896801092E-02, 1.58297974431589328E-02, 1.11911244912737962E-02, 7.90568709221795007E-03,
+	5.59229149311524232E-03, 4.17767891033793415E-03, 3.26314728092358397E-03, 2.55428218032016652E-03,
+	2.00206172007966199E-03, 1.56605681023314069E-03, 1.22666447818231550E-03, 9.62120959032919387E-04
+};
+
+static const double buehlmann_He_factor_expositon_one_minute[] = {
+	3.08363886234176765E-01, 2.05084082421572944E-01, 1.36579295737538242E-01, 9.44046323566479773E-02,
+	6.56358626515620713E-02, 4.67416115382158770E-02, 3.31990512622983847E-02, 2.35300557160145196E-02,
+	1.66832281986954989E-02, 1.24807506408146640E-02, 9.75753219865671539E-03, 7.64329013364040133E-03,
+	5.99416843161204582E-03, 4.69081666970827538E-03, 3.67548116309002193E-03, 2.88358673749222749E-03
+};
+
+struct exposure_factors {
+	int period;
+	const double *n2;
+	const double *he;
+};
+
+static const struct exposure_factors exposure_factor_table[] = {
+	{ 1, buehlmann_N2_factor_expositon_one_second, buehlmann_He_factor_expositon_one_second },
+	{ 2, buehlmann_N2_factor_expositon_two_seconds, buehlmann_He_factor_expositon_two_seconds },
+	{ 20, buehlmann_N2_factor_expositon_twenty_seconds, buehlmann_He_factor_expositon_twenty_seconds },
+	{ 60, buehlmann_N2_factor_expositon_one_minute, buehlmann_He_factor_expositon_one_minute }
+};
+
+/* Return the precomputed factors for the given period or fill n2_buf and he_buf */
+static struct exposure_factors get_exposure_factors(int period_in_seconds, double n2_buf[16], double he_buf[16])
+{
+	unsigned int i;
+	int ci;
+	struct exposure_factors res = { period_in_seconds, n2_buf, he_buf };
+
+	for (i = 0; i < sizeof(exposure_factor_table) / sizeof(exposure_factor_table[0]); i++) {
+		if (exposure_factor_table[i].period == period_in_seconds)
+			return exposure_factor_table[i];
+	}
+
+	for (ci = 0; ci < 16; ci++) {
+		n2_buf[ci] = factor(period_in_seconds, ci, N2);
+		he_buf[ci] = factor(period_in_seconds, ci, HE);
+	}
+	return res;
+}
+
+/*
+ * The Buehlmann kernels below work on the plain 16-element tissue arrays of struct deco_state.
+ * They are written without loop-carried dependencies or data-dependent branches so that the
+ * compiler can vectorize them. On x86-64 Linux with GCC we additionally let the compiler emit
+ * an AVX2 clone that is selected at load time depending on the CPU (SSE2 is the baseline of the
+ * architecture). We deliberately don't ask for FMA: contracting multiply-adds would change
+ * the rounding and thus the results compared to the scalar code.
+ *
+ * The scalar reference versions of the kernels are compiled without vectorization and are
+ * used if deco_scalar_kernels is set. The tests check that both give the same results.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__) && !defined(__ANDROID__)
+#define DECO_KERNEL __attribute__((target_clones("avx2", "default")))
+#define DECO_SCALAR_KERNEL __attribute__((optimize("no-tree-vectorize")))
+#else
+#define DECO_KERNEL
+#define DECO_SCALAR_KERNEL
+#endif
+
+bool deco_scalar_kernels = false;
+
+DECO_KERNEL
+static void saturate_tissues(double *restrict n2_sat, double *restrict he_sat, double *restrict inertgas_sat,
+			     const double *restrict n2_f, const double *restrict he_f,
+			     double pn2, double phe, double satmult, double desatmult)
+{
+	int ci;
+
+	for (ci = 0; ci < 16; ci++) {
+		double pn2_oversat = pn2 - n2_sat[ci];
+		double phe_oversat = phe - he_sat[ci];
+		double n2_satmult = pn2_oversat > 0 ? satmult : desatmult;
+		double he_satmult = phe_oversat > 0 ? satmult : desatmult;
+
+		n2_sat[ci] += n2_satmult * pn2_oversat * n2_f[ci];
+		he_sat[ci] += he_satmult * phe_oversat * he_f[ci];
+		inertgas_sat[ci] = n2_sat[ci] + he_sat[ci];
+	}
+}
+
+DECO_SCALAR_KERNEL
+static void saturate_tissues_scalar(double *n2_sat, double *he_sat, double *inertgas_sat, const double *n2_f, const double *he_f,
+				    double pn2, double phe, double satmult, double desatmult)
+{
+	int ci;
+
+	for (ci = 0; ci < 16; ci++) {
+		double pn2_oversat = pn2 - n2_sat[ci];
+		double phe_oversat = phe - he_sat[ci];
+		double n2_satmult = pn2_oversat > 0 ? satmult : desatmult;
+		double he_satmult = phe_oversat > 0 ? satmult : desatmult;
+
+		n2_sat[ci] += n2_satmult * pn2_oversat * n2_f[ci];
+		he_sat[ci] += he_satmult * phe_oversat * he_f[ci];
+		inertgas_sat[ci] = n2_sat[ci] + he_sat[ci];
+	}
+}
+
+DECO_KERNEL
+static void mix_buehlmann_coefficients(double *restrict a, double *restrict b, const double *restrict n2_sat,
+				       const double *restrict he_sat, const double *restrict inertgas_sat)
+{
+	int ci;
+
+	for (ci = 0; ci < 16; ci++) {
+		a[ci] = ((buehlmann_N2_a[ci] * n2_sat[ci]) + (buehlmann_He_a[ci] * he_sat[ci])) / inertgas_sat[ci];
+		b[ci] = ((buehlmann_N2_b[ci] * n2_sat[ci]) + (buehlmann_He_b[ci] * he_sat[ci])) / inertgas_sat[ci];
+	}
+}
+
+DECO_SCALAR_KERNEL
+static void mix_buehlmann_coefficients_scalar(double *a, double *b, const double *n2_sat, const double *he_sat, const double *inertgas_sat)
+{
+	int ci;
+
+	for (ci = 0; ci < 16; ci++) {
+		a[ci] = ((buehlmann_N2_a[ci] * n2_sat[ci]) + (buehlmann_He_a[ci] * he_sat[ci])) / inertgas_sat[ci];
+		b[ci] = ((buehlmann_N2_b[ci] * n2_sat[ci]) + (buehlmann_He_b[ci] * he_sat[ci])) / inertgas_sat[ci];
+	}
+}
+
+/*
+ * The gradient factor adjusted M-values of a compartment with the given (mixed) coefficients
+ * are interpolated between gf_low at gf_low_pressure and gf_high at the surface. This only
+ * gives a usable line if the M-value at the surface is the lower one.
+ */
+static bool buehlmann_gf_line_usable(const struct deco_state *ds, double a, double b, double surface)
+{
+	double gf_low_pressure = ds->gf_low_pressure_this_dive;
+
+	return (surface / b + a - surface) * ds->params.gf_high + surface <
+	       (gf_low_pressure / b + a - gf_low_pressure) * ds->params.gf_low + gf_low_pressure;
+}
+
+/* The ambient pressure that a compartment with the given coefficients and loading tolerates */
+static double buehlmann_tolerated(const struct deco_state *ds, double a, double b, double sat, double surface)
+{
+	double gf_low_pressure = ds->gf_low_pressure_this_dive;
+	double gf_high = ds->params.gf_high;
+	double gf_low = ds->params.gf_low;
+
+	return (-a * b * (gf_high * gf_low_pressure - gf_low * surface) -
+		(1.0 - b) * (gf_high - gf_low) * gf_low_pressure * surface +
+		b * (gf_low_pressure - surface) * sat) /
+	       (-a * b * (gf_high - gf_low) +
+		(1.0 - b) * (gf_low * gf_low_pressure - gf_high * surface) +
+		b * (gf_low_pressure - surface));
+}
+
 double tissue_tolerance_calc(struct deco_state *ds, const struct dive *dive, double pressure)
 {
 	int ci = -1;
 	double ret_tolerance_limit_ambient_pressure = 0.0;
-	double gf_high = buehlmann_config.gf_high;
-	double gf_low = buehlmann_config.gf_low;
+	double gf_low = ds->params.gf_low;
 	double surface = get_surface_pressure_in_mbar(dive, true) / 1000.0;
 	double lowest_ceiling = 0.0;
 	double tissue_lowest_ceiling[16];
 
-	for (ci = 0; ci < 16; ci++) {
-		ds->buehlmann_inertgas_a[ci] = ((buehlmann_N2_a[ci] * ds->tissue_n2_sat[ci]) + (buehlmann_He_a[ci] * ds->tissue_he_sat[ci])) / ds->tissue_inertgas_saturation[ci];
-		ds->buehlmann_inertgas_b[ci] = ((buehlmann_N2_b[ci] * ds->tissue_n2_sat[ci]) + (buehlmann_He_b[ci] * ds->tissue_he_sat[ci])) / ds->tissue_inertgas_saturation[ci];
-	}
+	if (deco_scalar_kernels)
+		mix_buehlmann_coefficients_scalar(ds->buehlmann_inertgas_a, ds->buehlmann_inertgas_b,
+						  ds->tissue_n2_sat, ds->tissue_he_sat, ds->tissue_inertgas_saturation);
+	else
+		mix_buehlmann_coefficients(ds->buehlmann_inertgas_a, ds->buehlmann_inertgas_b,
+					   ds->tissue_n2_sat, ds->tissue_he_sat, ds->tissue_inertgas_saturation);
 
-	if (decoMode() != VPMB) {
+	if (ds->params.mode != VPMB) {
 		for (ci = 0; ci < 16; ci++) {
 
 			/* tolerated = (tissue_inertgas_saturation - buehlmann_inertgas_a) * buehlmann_inertgas_b; */
@@ -248,14 +460,9 @@ double tissue_tolerance_calc(struct deco_state *ds, const struct dive *dive, dou
 		for (ci = 0; ci < 16; ci++) {
 			double tolerated;
 
-			if ((surface / ds->buehlmann_inertgas_b[ci] + ds->buehlmann_inertgas_a[ci] - surface) * gf_high + surface <
-			    (ds->gf_low_pressure_this_dive / ds->buehlmann_inertgas_b[ci] + ds->buehlmann_inertgas_a[ci] - ds->gf_low_pressure_this_dive) * gf_low + ds->gf_low_pressure_this_dive)
-				tolerated = (-ds->buehlmann_inertgas_a[ci] * ds->buehlmann_inertgas_b[ci] * (gf_high * ds->gf_low_pressure_this_dive - gf_low * surface) -
-					     (1.0 - ds->buehlmann_inertgas_b[ci]) * (gf_high - gf_low) * ds->gf_low_pressure_this_dive * surface +
-					     ds->buehlmann_inertgas_b[ci] * (ds->gf_low_pressure_this_dive - surface) * ds->tissue_inertgas_saturation[ci]) /
-					    (-ds->buehlmann_inertgas_a[ci] * ds->buehlmann_inertgas_b[ci] * (gf_high - gf_low) +
-					     (1.0 - ds->buehlmann_inertgas_b[ci]) * (gf_low * ds->gf_low_pressure_this_dive - gf_high * surface) +
-					     ds->buehlmann_inertgas_b[ci] * (ds->gf_low_pressure_this_dive - surface));
+			if (buehlmann_gf_line_usable(ds, ds->buehlmann_inertgas_a[ci], ds->buehlmann_inertgas_b[ci], surface))
+				tolerated = buehlmann_tolerated(ds, ds->buehlmann_inertgas_a[ci], ds->buehlmann_inertgas_b[ci], ds->tissue_inertgas_saturation[ci],
+								surface);
 			else
 				tolerated = ret_tolerance_limit_ambient_pressure;
 
@@ -290,28 +497,16 @@ double tissue_tolerance_calc(struct deco_state *ds, const struct dive *dive, dou
 	return ret_tolerance_limit_ambient_pressure;
 }
 
-/*
- * Return Buehlmann factor for a particular period and tissue index.
- */
-static double factor(int period_in_seconds, int ci, enum inertgas gas)
-{
-	if (period_in_seconds == 1) {
-		if (gas == N2)
-			return buehlmann_N2_factor_expositon_one_second[ci];
-		else
-			return buehlmann_He_factor_expositon_one_second[ci];
-	}
 
-	// ln(2)/60 = 1.155245301e-02
-	if (gas == N2)
-		return 1.0 - exp(-period_in_seconds * 1.155245301e-02 / buehlmann_N2_t_halflife[ci]);
-	else
-		return 1.0 - exp(-period_in_seconds * 1.155245301e-02 / buehlmann_He_t_halflife[ci]);
+/* VPM-B in the planner uses the water vapour pressure of Schreiner */
+static double water_vapour_pressure(const struct deco_state *ds)
+{
+	return ds->params.planner && ds->params.mode == VPMB ? WV_PRESSURE_SCHREINER : WV_PRESSURE;
 }
 
-static double calc_surface_phase(double surface_pressure, double he_pressure, double n2_pressure, double he_time_constant, double n2_time_constant)
+static double calc_surface_phase(const struct deco_state *ds, double surface_pressure, double he_pressure, double n2_pressure, double he_time_constant, double n2_time_constant)
 {
-	double inspired_n2 = (surface_pressure - ((in_planner() && (decoMode() == VPMB)) ? WV_PRESSURE_SCHREINER : WV_PRESSURE)) * NITROGEN_FRACTION;
+	double inspired_n2 = (surface_pressure - water_vapour_pressure(ds)) * NITROGEN_FRACTION;
 
 	if (n2_pressure > inspired_n2)
 		return (he_pressure / he_time_constant + (n2_pressure - inspired_n2) / n2_time_constant) / (he_pressure + n2_pressure - inspired_n2);
@@ -344,7 +539,7 @@ void vpmb_next_gradient(struct deco_state *ds, double deco_time, double surface_
 	deco_time /= 60.0;
 
 	for (ci = 0; ci < 16; ++ci) {
-		desat_time = deco_time + calc_surface_phase(surface_pressure, ds->tissue_he_sat[ci], ds->tissue_n2_sat[ci], log(2.0) / buehlmann_He_t_halflife[ci], log(2.0) / buehlmann_N2_t_halflife[ci]);
+		desat_time = deco_time + calc_surface_phase(ds, surface_pressure, ds->tissue_he_sat[ci], ds->tissue_n2_sat[ci], log(2.0) / buehlmann_He_t_halflife[ci], log(2.0) / buehlmann_N2_t_halflife[ci]);
 
 		n2_b = ds->initial_n2_gradient[ci] + (vpmb_config.crit_volume_lambda * vpmb_config.surface_tension_gamma) / (vpmb_config.skin_compression_gammaC * desat_time);
 		he_b = ds->initial_he_gradient[ci] + (vpmb_config.crit_volume_lambda * vpmb_config.surface_tension_gamma) / (vpmb_config.skin_compression_gammaC * desat_time);
@@ -359,6 +554,27 @@ void vpmb_next_gradient(struct deco_state *ds, double deco_time, double surface_
 	}
 }
 
+/*
+ * The next deco time for the CVA iterations. Planning with the gradients for a deco time
+ * gives a new deco time, and we are looking for the deco time that reproduces itself.
+ * Plain iteration just takes the new deco time. If we have the result of the previous
+ * iteration as well (prev_estimate >= 0), take a secant step instead, which converges in
+ * fewer iterations. The deco times come in whole stops, so don't trust slopes that are
+ * implausible and fall back to plain iteration for those.
+ */
+int vpmb_next_deco_time(int prev_estimate, int prev_deco_time, int estimate, int deco_time)
+{
+	double slope, next;
+
+	if (prev_estimate < 0 || prev_estimate == estimate)
+		return deco_time;
+	slope = (double)(deco_time - prev_deco_time) / (estimate - prev_estimate);
+	if (slope < -1.0 || slope > 0.5)
+		return deco_time;
+	next = estimate + (deco_time - estimate) / (1.0 - slope);
+	return next > 0.0 ? (int)lrint(next) : deco_time;
+}
+
 // A*r^3 - B*r^2 - C == 0
 // Solved with the help of mathematica
 
@@ -388,11 +604,11 @@ void nuclear_regeneration(struct deco_state *ds, double time)
 	double crushing_radius_N2, crushing_radius_He;
 	for (ci = 0; ci < 16; ++ci) {
 		//rm
-		crushing_radius_N2 = 1.0 / (ds->max_n2_crushing_pressure[ci] / (2.0 * (vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma)) + 1.0 / get_crit_radius_N2());
-		crushing_radius_He = 1.0 / (ds->max_he_crushing_pressure[ci] / (2.0 * (vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma)) + 1.0 / get_crit_radius_He());
+		crushing_radius_N2 = 1.0 / (ds->max_n2_crushing_pressure[ci] / (2.0 * (vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma)) + 1.0 / get_crit_radius_N2(ds));
+		crushing_radius_He = 1.0 / (ds->max_he_crushing_pressure[ci] / (2.0 * (vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma)) + 1.0 / get_crit_radius_He(ds));
 		//rs
-		ds->n2_regen_radius[ci] = crushing_radius_N2 + (get_crit_radius_N2() - crushing_radius_N2) * (1.0 - exp (-time / vpmb_config.regeneration_time));
-		ds->he_regen_radius[ci] = crushing_radius_He + (get_crit_radius_He() - crushing_radius_He) * (1.0 - exp (-time / vpmb_config.regeneration_time));
+		ds->n2_regen_radius[ci] = crushing_radius_N2 + (get_crit_radius_N2(ds) - crushing_radius_N2) * (1.0 - exp (-time / vpmb_config.regeneration_time));
+		ds->he_regen_radius[ci] = crushing_radius_He + (get_crit_radius_He(ds) - crushing_radius_He) * (1.0 - exp (-time / vpmb_config.regeneration_time));
 	}
 }
 
@@ -432,8 +648,8 @@ void calc_crushing_pressure(struct deco_state *ds, double pressure)
 			if (ds->max_ambient_pressure >= pressure)
 				return;
 
-			n2_inner_pressure = calc_inner_pressure(get_crit_radius_N2(), ds->crushing_onset_tension[ci], pressure);
-			he_inner_pressure = calc_inner_pressure(get_crit_radius_He(), ds->crushing_onset_tension[ci], pressure);
+			n2_inner_pressure = calc_inner_pressure(get_crit_radius_N2(ds), ds->crushing_onset_tension[ci], pressure);
+			he_inner_pressure = calc_inner_pressure(get_crit_radius_He(ds), ds->crushing_onset_tension[ci], pressure);
 
 			n2_crushing_pressure = pressure - n2_inner_pressure;
 			he_crushing_pressure = pressure - he_inner_pressure;
@@ -448,36 +664,202 @@ void calc_crushing_pressure(struct deco_state *ds, double pressure)
 void add_segment(struct deco_state *ds, double pressure, struct gasmix gasmix, int period_in_seconds, int ccpo2, enum divemode_t divemode, int sac)
 {
 	UNUSED(sac);
-	int ci;
+	int ci = ds->ci_pointing_to_guiding_tissue;
 	struct gas_pressures pressures;
+	double n2_buf[16], he_buf[16];
+	struct exposure_factors f = get_exposure_factors(period_in_seconds, n2_buf, he_buf);
 	bool icd = false;
-	fill_pressures(&pressures, pressure - ((in_planner() && (decoMode() == VPMB)) ? WV_PRESSURE_SCHREINER : WV_PRESSURE),
+	fill_pressures(&pressures, pressure - water_vapour_pressure(ds),
 		       gasmix, (double) ccpo2 / 1000.0, divemode);
 
-	for (ci = 0; ci < 16; ci++) {
+	// Report ICD if N2 is more on-gasing than He off-gasing in leading tissue
+	if (ci >= 0 && ci < 16) {
 		double pn2_oversat = pressures.n2 - ds->tissue_n2_sat[ci];
 		double phe_oversat = pressures.he - ds->tissue_he_sat[ci];
-		double n2_f = factor(period_in_seconds, ci, N2);
-		double he_f = factor(period_in_seconds, ci, HE);
 		double n2_satmult = pn2_oversat > 0 ? buehlmann_config.satmult : buehlmann_config.desatmult;
 		double he_satmult = phe_oversat > 0 ? buehlmann_config.satmult : buehlmann_config.desatmult;
 
-		// Report ICD if N2 is more on-gasing than He off-gasing in leading tissue
-		if (ci == ds->ci_pointing_to_guiding_tissue && pn2_oversat > 0.0 && phe_oversat < 0.0 &&
-		    pn2_oversat * n2_satmult * n2_f + phe_oversat * he_satmult * he_f > 0)
+		if (pn2_oversat > 0.0 && phe_oversat < 0.0 &&
+		    pn2_oversat * n2_satmult * f.n2[ci] + phe_oversat * he_satmult * f.he[ci] > 0)
 			icd = true;
-
-		ds->tissue_n2_sat[ci] += n2_satmult * pn2_oversat * n2_f;
-		ds->tissue_he_sat[ci] += he_satmult * phe_oversat * he_f;
-		ds->tissue_inertgas_saturation[ci] = ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci];
-
 	}
-	if (decoMode() == VPMB)
+
+	if (deco_scalar_kernels)
+		saturate_tissues_scalar(ds->tissue_n2_sat, ds->tissue_he_sat, ds->tissue_inertgas_saturation, f.n2, f.he,
+					pressures.n2, pressures.he, buehlmann_config.satmult, buehlmann_config.desatmult);
+	else
+		saturate_tissues(ds->tissue_n2_sat, ds->tissue_he_sat, ds->tissue_inertgas_saturation, f.n2, f.he,
+				 pressures.n2, pressures.he, buehlmann_config.satmult, buehlmann_config.desatmult);
+	if (ds->params.mode == VPMB)
 		calc_crushing_pressure(ds, pressure);
 	ds->icd_warning = icd;
 	return;
 }
 
+/*
+ * Closed-form variants of add_segment() and of the ceiling checks, used for the NDL and TTS
+ * in the profile if prefs.analyticndltts is set. Instead of stepping through time, the
+ * loading of each compartment is solved directly: with the Haldane equation at constant
+ * depth and with the Schreiner equation for ascents at a constant rate. Like the stepwise
+ * calculation with Buehlmann, this assumes saturation and desaturation multipliers of 1.0.
+ */
+
+// ln(2)/60, see factor()
+static double compartment_rate(int ci, enum inertgas gas)
+{
+	return 1.155245301e-02 / (gas == N2 ? buehlmann_N2_t_halflife[ci] : buehlmann_He_t_halflife[ci]);
+}
+
+void deco_level_init(const struct deco_state *ds, struct deco_level *level, double pressure, struct gasmix gasmix, int ccpo2, enum divemode_t divemode)
+{
+	struct gas_pressures pressures;
+
+	fill_pressures(&pressures, pressure - water_vapour_pressure(ds),
+		       gasmix, (double) ccpo2 / 1000.0, divemode);
+	level->pressure = pressure;
+	level->pn2 = pressures.n2;
+	level->phe = pressures.he;
+}
+
+/*
+ * The ceiling of compartment ci as in tissue_tolerance_calc() for the given loading. A
+ * compartment that tissue_tolerance_calc() skips never has a ceiling.
+ */
+static double compartment_tolerated(const struct deco_state *ds, int ci, double n2, double he, double surface)
+{
+	double sat = n2 + he;
+	double a = (buehlmann_N2_a[ci] * n2 + buehlmann_He_a[ci] * he) / sat;
+	double b = (buehlmann_N2_b[ci] * n2 + buehlmann_He_b[ci] * he) / sat;
+
+	if (!buehlmann_gf_line_usable(ds, a, b, surface))
+		return 0.0;
+	return buehlmann_tolerated(ds, a, b, sat, surface);
+}
+
+static double haldane(double p, double inspired, double k, double t)
+{
+	return inspired + (p - inspired) * exp(-k * t);
+}
+
+static double compartment_tolerated_after(const struct deco_state *ds, int ci, const struct deco_level *at, double t, double surface)
+{
+	return compartment_tolerated(ds, ci, haldane(ds->tissue_n2_sat[ci], at->pn2, compartment_rate(ci, N2), t),
+				     haldane(ds->tissue_he_sat[ci], at->phe, compartment_rate(ci, HE), t), surface);
+}
+
+/*
+ * Seconds at 'at' until the ceiling of compartment ci passes 'limit', in either direction.
+ * Returns max_time if this doesn't happen earlier.
+ */
+static double compartment_time_to_limit(const struct deco_state *ds, int ci, const struct deco_level *at, double limit, double surface, double max_time)
+{
+	bool above = compartment_tolerated(ds, ci, ds->tissue_n2_sat[ci], ds->tissue_he_sat[ci], surface) > limit;
+	double low = 0.0, high = max_time;
+
+	if (ds->tissue_he_sat[ci] == 0.0 && at->phe == 0.0) {
+		/* Nitrogen only: the ceiling is linear in the loading, solve for the time */
+		double n0 = ds->tissue_n2_sat[ci];
+		double c0 = compartment_tolerated(ds, ci, n0, 0.0, surface);
+		double c1 = compartment_tolerated(ds, ci, n0 + 1.0, 0.0, surface);
+		double ratio;
+
+		if (n0 == at->pn2 || c1 == c0)
+			return max_time;
+		/* the loading at which the ceiling is at the limit */
+		ratio = (n0 + (limit - c0) / (c1 - c0) - at->pn2) / (n0 - at->pn2);
+		if (ratio <= 0.0 || ratio > 1.0)
+			return max_time;
+		return MIN(-log(ratio) / compartment_rate(ci, N2), max_time);
+	}
+
+	/* With helium the coefficients move with the mix in the compartment, so search for it */
+	if ((compartment_tolerated_after(ds, ci, at, max_time, surface) > limit) == above)
+		return max_time;
+	while (high - low > 0.5) {
+		double mid = (low + high) / 2;
+		if ((compartment_tolerated_after(ds, ci, at, mid, surface) > limit) == above)
+			low = mid;
+		else
+			high = mid;
+	}
+	return high;
+}
+
+/* Is the ceiling deeper than 'limit' (in bar)? */
+static bool ceiling_deeper_than(const struct deco_state *ds, const struct dive *dive, double limit)
+{
+	double surface = get_surface_pressure_in_mbar(dive, true) / 1000.0;
+	int ci;
+
+	for (ci = 0; ci < 16; ci++) {
+		if (compartment_tolerated(ds, ci, ds->tissue_n2_sat[ci], ds->tissue_he_sat[ci], surface) > limit)
+			return true;
+	}
+	return false;
+}
+
+/* Seconds at 'at' until the ceiling gets deeper than 'limit' */
+double deco_time_to_ceiling(const struct deco_state *ds, const struct dive *dive, const struct deco_level *at, double limit, double max_time)
+{
+	double surface = get_surface_pressure_in_mbar(dive, true) / 1000.0;
+	double res = max_time;
+	int ci;
+
+	if (ceiling_deeper_than(ds, dive, limit))
+		return 0.0;
+	for (ci = 0; ci < 16; ci++)
+		res = MIN(res, compartment_time_to_limit(ds, ci, at, limit, surface, res));
+	return res;
+}
+
+/* Seconds at 'at' until the ceiling is at 'limit' or shallower */
+double deco_time_to_clear(const struct deco_state *ds, const struct dive *dive, const struct deco_level *at, double limit, double max_time)
+{
+	double surface = get_surface_pressure_in_mbar(dive, true) / 1000.0;
+	double res = 0.0;
+	int ci;
+
+	for (ci = 0; ci < 16; ci++) {
+		if (compartment_tolerated(ds, ci, ds->tissue_n2_sat[ci], ds->tissue_he_sat[ci], surface) > limit)
+			res = MAX(res, compartment_time_to_limit(ds, ci, at, limit, surface, max_time));
+	}
+	return res;
+}
+
+/* Stay at 'at' for the given time */
+void deco_expose(struct deco_state *ds, const struct deco_level *at, double seconds)
+{
+	int ci;
+
+	for (ci = 0; ci < 16; ci++) {
+		ds->tissue_n2_sat[ci] = haldane(ds->tissue_n2_sat[ci], at->pn2, compartment_rate(ci, N2), seconds);
+		ds->tissue_he_sat[ci] = haldane(ds->tissue_he_sat[ci], at->phe, compartment_rate(ci, HE), seconds);
+		ds->tissue_inertgas_saturation[ci] = ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci];
+	}
+}
+
+/* Schreiner equation: linear change of the inspired pressure from 'start' to 'end' */
+static double schreiner(double p, double start, double end, double k, double t)
+{
+	double rate = (end - start) / t;
+
+	return start + rate * (t - 1.0 / k) - (start - p - rate / k) * exp(-k * t);
+}
+
+/* Move from 'from' to 'to' at a constant rate in the given time */
+void deco_expose_travel(struct deco_state *ds, const struct deco_level *from, const struct deco_level *to, double seconds)
+{
+	int ci;
+
+	if (seconds <= 0.0)
+		return;
+	for (ci = 0; ci < 16; ci++) {
+		ds->tissue_n2_sat[ci] = schreiner(ds->tissue_n2_sat[ci], from->pn2, to->pn2, compartment_rate(ci, N2), seconds);
+		ds->tissue_he_sat[ci] = schreiner(ds->tissue_he_sat[ci], from->phe, to->phe, compartment_rate(ci, HE), seconds);
+		ds->tissue_inertgas_saturation[ci] = ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci];
+	}
+}
+
 #if DECO_CALC_DEBUG
 void dump_tissues(struct deco_state *ds)
 {
@@ -509,14 +891,15 @@ void clear_deco(struct deco_state *ds, double surface_pressure)
 	int ci;
 
 	memset(ds, 0, sizeof(*ds));
+	get_deco_params(&ds->params);
 	clear_vpmb_state(ds);
 	for (ci = 0; ci < 16; ci++) {
-		ds->tissue_n2_sat[ci] = (surface_pressure - ((in_planner() && (decoMode() == VPMB)) ? WV_PRESSURE_SCHREINER : WV_PRESSURE)) * N2_IN_AIR / 1000;
+		ds->tissue_n2_sat[ci] = (surface_pressure - water_vapour_pressure(ds)) * N2_IN_AIR / 1000;
 		ds->tissue_he_sat[ci] = 0.0;
 		ds->max_n2_crushing_pressure[ci] = 0.0;
 		ds->max_he_crushing_pressure[ci] = 0.0;
-		ds->n2_regen_radius[ci] = get_crit_radius_N2();
-		ds->he_regen_radius[ci] = get_crit_radius_He();
+		ds->n2_regen_radius[ci] = get_crit_radius_N2(ds);
+		ds->he_regen_radius[ci] = get_crit_radius_He(ds);
 	}
 	ds->gf_low_pressure_this_dive = surface_pressure + buehlmann_config.gf_low_position_min;
 	ds->max_ambient_pressure = 0.0;
@@ -588,11 +971,48 @@ void set_vpmb_conservatism(short conservatism)
 		vpmb_config.conservatism = conservatism;
 }
 
+void get_deco_params(struct deco_params *params)
+{
+	params->gf_low = buehlmann_config.gf_low;
+	params->gf_high = buehlmann_config.gf_high;
+	params->vpmb_conservatism = vpmb_config.conservatism;
+	params->mode = decoMode();
+	params->planner = in_planner();
+	params->calcceiling3m = prefs.calcceiling3m;
+	params->calcndltts = prefs.calcndltts;
+	params->analyticndltts = prefs.analyticndltts;
+	params->ascrate75 = prefs.ascrate75;
+	params->ascrate50 = prefs.ascrate50;
+	params->ascratestops = prefs.ascratestops;
+	params->ascratelast6m = prefs.ascratelast6m;
+	params->bottomsac = prefs.bottomsac;
+	params->decosac = prefs.decosac;
+}
+
+int deco_ascent_velocity(const struct deco_params *params, int depth, int avg_depth)
+{
+	/* As an example (and possibly reasonable default) this is the Tech 1 provedure according
+	 * to http://www.globalunderwaterexplorers.org/files/Standards_and_Procedures/SOP_Manual_Ver2.0.2.pdf */
+
+	if (depth * 4 > avg_depth * 3) {
+		return params->ascrate75;
+	} else {
+		if (depth * 2 > avg_depth) {
+			return params->ascrate50;
+		} else {
+			if (depth > 6000)
+				return params->ascratestops;
+			else
+				return params->ascratelast6m;
+		}
+	}
+}
+
 double get_gf(struct deco_state *ds, double ambpressure_bar, const struct dive *dive)
 {
 	double surface_pressure_bar = get_surface_pressure_in_mbar(dive, true) / 1000.0;
-	double gf_low = buehlmann_config.gf_low;
-	double gf_high = buehlmann_config.gf_high;
+	double gf_low = ds->params.gf_low;
+	double gf_high = ds->params.gf_high;
 	double gf;
 	if (ds->gf_low_pressure_this_dive > surface_pressure_bar)
 		gf = MAX((double)gf_low, (ambpressure_bar - surface_pressure_bar) /
@@ -5,6 +5,7 @@
 #include "units.h"
 #include "gas.h"
 #include "divemode.h"
+#include "pref.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -14,6 +15,21 @@ struct dive;
 struct divecomputer;
 struct decostop;
 
+/*
+ * The deco parameters that can be changed at runtime by set_gf() and set_vpmb_conservatism(),
+ * and the settings of the deco calculation, as they were when the calculation was started.
+ * The profile may be calculated in a worker thread, while the user changes the preferences.
+ */
+struct deco_params {
+	double gf_low, gf_high;
+	short vpmb_conservatism;
+	enum deco_mode mode;		/* decoMode() */
+	bool planner;			/* in_planner() */
+	bool calcceiling3m, calcndltts, analyticndltts;
+	int ascrate75, ascrate50, ascratestops, ascratelast6m;
+	int bottomsac, decosac;
+};
+
 struct deco_state {
 	double tissue_n2_sat[16];
 	double tissue_he_sat[16];
@@ -45,6 +61,15 @@ struct deco_state {
 	long sumx, sumxx;
 	double sumy, sumxy;
 	int plot_depth;
+	/* Copied from the global settings by clear_deco(), so that a calculation
+	 * isn't affected by changes of the settings while it is running */
+	struct deco_params params;
+};
+
+/* A depth for the closed-form calculations: the ambient and the inspired pressures */
+struct deco_level {
+	double pressure;
+	double pn2, phe;
 };
 
 extern const double buehlmann_N2_t_halflife[];
@@ -56,16 +81,25 @@ extern void clear_deco(struct deco_state *ds, double surface_pressure);
 extern void dump_tissues(struct deco_state *ds);
 extern void set_gf(short gflow, short gfhigh);
 extern void set_vpmb_conservatism(short conservatism);
+extern bool deco_scalar_kernels;	// use the non-vectorized Buehlmann kernels, for testing
+extern void get_deco_params(struct deco_params *params);
+extern int deco_ascent_velocity(const struct deco_params *params, int depth, int avg_depth);
 extern void cache_deco_state(struct deco_state *source, struct deco_state **datap);
 extern void restore_deco_state(struct deco_state *data, struct deco_state *target, bool keep_vpmb_state);
 extern void nuclear_regeneration(struct deco_state *ds, double time);
 extern void vpmb_start_gradient(struct deco_state *ds);
 extern void vpmb_next_gradient(struct deco_state *ds, double deco_time, double surface_pressure);
+extern int vpmb_next_deco_time(int prev_estimate, int prev_deco_time, int estimate, int deco_time);
 extern double tissue_tolerance_calc(struct deco_state *ds, const struct dive *dive, double pressure);
 extern void calc_crushing_pressure(struct deco_state *ds, double pressure);
 extern void vpmb_start_gradient(struct deco_state *ds);
 extern void clear_vpmb_state(struct deco_state *ds);
 extern void add_segment(struct deco_state *ds, double pressure, struct gasmix gasmix, int period_in_seconds, int setpoint, enum divemode_t divemode, int sac);
+extern void deco_level_init(const struct deco_state *ds, struct deco_level *level, double pressure, struct gasmix gasmix, int setpoint, enum divemode_t divemode);
+extern double deco_time_to_ceiling(const struct deco_state *ds, const struct dive *dive, const struct deco_level *at, double limit, double max_time);
+extern double deco_time_to_clear(const struct deco_state *ds, const struct dive *dive, const struct deco_level *at, double limit, double max_time);
+extern void deco_expose(struct deco_state *ds, const struct deco_level *at, double seconds);
+extern void deco_expose_travel(struct deco_state *ds, const struct deco_level *from, const struct deco_level *to, double seconds);
 
 extern double regressiona(const struct deco_state *ds);
 extern double regressionb(const struct deco_state *ds);
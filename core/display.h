@@ -23,6 +23,17 @@ struct plot_info {
 	double maxpp;
 	struct plot_data *entry;
 	struct plot_pressure_data *pressures; /* cylinders.nr blocks of nr entries. */
+	struct plot_tissue_data *tissues; /* nr entries, NULL if no deco information was calculated */
+	/* Snapshots of the deco state, used to resume the deco calculation after edits.
+	 * prev_entry/prev_tissues/prev_nr are the results of the previous calculation and
+	 * are only valid during create_plot_info_new(). deco_resumed_entries is the number
+	 * of entries whose deco data was taken from the previous calculation. */
+	int nr_deco_checkpoints;
+	int deco_resumed_entries;
+	struct deco_checkpoint *deco_checkpoints;
+	struct plot_data *prev_entry;
+	struct plot_tissue_data *prev_tissues;
+	int prev_nr;
 };
 
 extern struct divecomputer *select_dc(struct dive *);
@@ -19,7 +19,9 @@
 #include "tag.h"
 #include "trip.h"
 #include "structured_list.h"
+#include "stringpool.h"
 #include "fulltext.h"
+#include "plotinfoservice.h"
 
 
 /* one could argue about the best place to have this variable -
@@ -129,7 +131,18 @@ int event_is_gaschange(const struct event *ev)
 
 bool event_is_divemodechange(const struct event *ev)
 {
-	return same_string(ev->name, "modechange");
+	return ev->kind == EVENT_KIND_MODECHANGE;
+}
+
+enum event_kind get_event_kind(const char *name)
+{
+	if (same_string(name, "gaschange"))
+		return EVENT_KIND_GASCHANGE;
+	if (same_string(name, "modechange"))
+		return EVENT_KIND_MODECHANGE;
+	if (same_string(name, "SP change"))
+		return EVENT_KIND_SETPOINT;
+	return EVENT_KIND_OTHER;
 }
 
 struct event *create_event(unsigned int time, int type, int flags, int value, const char *name)
@@ -148,6 +161,7 @@ struct event *create_event(unsigned int time, int type, int flags, int value, co
 	ev->type = type;
 	ev->flags = flags;
 	ev->value = value;
+	ev->kind = get_event_kind(ev->name);
 
 	/*
 	 * Expand the events into a sane format. Currently
@@ -387,9 +401,9 @@ static void copy_extra_data(struct extra_data *sed, struct extra_data *ded)
 static void copy_dc(const struct divecomputer *sdc, struct divecomputer *ddc)
 {
 	*ddc = *sdc;
-	ddc->model = copy_string(sdc->model);
-	ddc->serial = copy_string(sdc->serial);
-	ddc->fw_version = copy_string(sdc->fw_version);
+	ddc->model = intern_string(sdc->model);
+	ddc->serial = intern_string(sdc->serial);
+	ddc->fw_version = intern_string(sdc->fw_version);
 	copy_samples(sdc, ddc);
 	copy_events(sdc, ddc);
 	STRUCTURED_LIST_COPY(struct extra_data, sdc->extra_data, ddc->extra_data, copy_extra_data);
@@ -427,6 +441,7 @@ static void free_dive_structures(struct dive *d)
 	if (!d)
 		return;
 	fulltext_unregister(d);
+	free_deco_chain(d);
 	/* free the strings */
 	free(d->buddy);
 	free(d->divemaster);
@@ -461,6 +476,13 @@ void clear_dive(struct dive *d)
 	memset(d, 0, sizeof(struct dive));
 }
 
+/* Only the caches that are stored in the dive itself, see invalidate_dive_cache() */
+static void invalidate_dive_data_cache(struct dive *dive)
+{
+	memset(dive->git_id, 0, 20);
+	invalidate_deco_chain(dive);
+}
+
 /* make a true copy that is independent of the source dive;
  * all data structures are duplicated, so the copy can be modified without
  * any impact on the source */
@@ -475,7 +497,9 @@ static void copy_dive_nodc(const struct dive *s, struct dive *d)
 	memset(&d->weightsystems, 0, sizeof(d->weightsystems));
 	memset(&d->pictures, 0, sizeof(d->pictures));
 	d->full_text = NULL;
-	invalidate_dive_cache(d);
+	d->deco_chain = NULL;
+	/* The copy has the id of the original, whose cached profile is still valid */
+	invalidate_dive_data_cache(d);
 	d->buddy = copy_string(s->buddy);
 	d->divemaster = copy_string(s->divemaster);
 	d->notes = copy_string(s->notes);
@@ -670,6 +694,26 @@ void free_samples(struct divecomputer *dc)
 	}
 }
 
+/* alloc_samples() over-allocates by half to make appending cheap. Once a
+ * dive computer is complete, give the slack back: with thousands of dives
+ * it adds up to a noticeable part of the memory of a loaded log. */
+void trim_samples(struct divecomputer *dc)
+{
+	struct sample *sample;
+
+	if (dc->alloc_samples <= dc->samples)
+		return;
+	if (!dc->samples) {
+		free_samples(dc);
+		return;
+	}
+	sample = realloc(dc->sample, dc->samples * sizeof(struct sample));
+	if (!sample)
+		return;
+	dc->sample = sample;
+	dc->alloc_samples = dc->samples;
+}
+
 struct sample *prepare_sample(struct divecomputer *dc)
 {
 	if (dc) {
@@ -1617,6 +1661,8 @@ static void fixup_dive_dc(struct dive *dive, struct divecomputer *dc)
 
 	/* Fixup CCR / PSCR dives with o2sensor values, but without no_o2sensors */
 	fixup_no_o2sensors(dc);
+
+	trim_samples(dc);
 }
 
 struct dive *fixup_dive(struct dive *dive)
@@ -2779,9 +2825,9 @@ static void free_extra_data(struct extra_data *ed)
 static void free_dc_contents(struct divecomputer *dc)
 {
 	free(dc->sample);
-	free((void *)dc->model);
-	free((void *)dc->serial);
-	free((void *)dc->fw_version);
+	free_unless_interned(dc->model);
+	free_unless_interned(dc->serial);
+	free_unless_interned(dc->fw_version);
 	free_events(dc->events);
 	STRUCTURED_LIST_FREE(struct extra_data, dc->extra_data, free_extra_data);
 }
@@ -2888,9 +2934,9 @@ static const struct divecomputer *find_matching_computer(const struct divecomput
 static void copy_dive_computer(struct divecomputer *res, const struct divecomputer *a)
 {
 	*res = *a;
-	res->model = copy_string(a->model);
-	res->serial = copy_string(a->serial);
-	res->fw_version = copy_string(a->fw_version);
+	res->model = intern_string(a->model);
+	res->serial = intern_string(a->serial);
+	res->fw_version = intern_string(a->fw_version);
 	STRUCTURED_LIST_COPY(struct extra_data, a->extra_data, res->extra_data, copy_extra_data);
 	res->samples = res->alloc_samples = 0;
 	res->sample = NULL;
@@ -3673,7 +3719,8 @@ fraction_t best_he(depth_t depth, const struct dive *dive, bool o2narcotic, frac
 
 void invalidate_dive_cache(struct dive *dive)
 {
-	memset(dive->git_id, 0, 20);
+	invalidate_dive_data_cache(dive);
+	invalidate_plot_info(dive);
 }
 
 bool dive_cache_is_valid(const struct dive *dive)
@@ -3834,13 +3881,8 @@ struct divecomputer *get_dive_dc(struct dive *dive, int nr)
 
 struct dive *get_dive_by_uniq_id(int id)
 {
-	int i;
-	struct dive *dive = NULL;
+	struct dive *dive = get_by_id_in_dive_table(&dive_table, id);
 
-	for_each_dive (i, dive) {
-		if (dive->id == id)
-			break;
-	}
 #ifdef DEBUG
 	if (dive == NULL) {
 		fprintf(stderr, "Invalid id %x passed to get_dive_by_diveid, try to fix the code\n", id);
@@ -3852,20 +3894,16 @@ struct dive *get_dive_by_uniq_id(int id)
 
 int get_idx_by_uniq_id(int id)
 {
-	int i;
-	struct dive *dive = NULL;
+	struct dive *dive = get_by_id_in_dive_table(&dive_table, id);
 
-	for_each_dive (i, dive) {
-		if (dive->id == id)
-			break;
-	}
 #ifdef DEBUG
 	if (dive == NULL) {
 		fprintf(stderr, "Invalid id %x passed to get_dive_by_diveid, try to fix the code\n", id);
 		exit(1);
 	}
 #endif
-	return i;
+	/* like the linear search this replaces, return the number of dives if not found */
+	return dive ? get_divenr(dive) : dive_table.nr;
 }
 
 bool dive_site_has_gps_location(const struct dive_site *ds)
@@ -3927,7 +3965,11 @@ location_t dive_get_gps_location(const struct dive *d)
 	return res;
 }
 
-/* When evaluated at the time of a gasswitch, this returns the new gas */
+/* When evaluated at the time of a gasswitch, this returns the new gas.
+ * Like get_current_divemode(), this function is self-tracking: start with
+ * a NULL event and gasmix_invalid and pass the results of the previous call
+ * for increasing times. Once the last gas change has been passed, the event
+ * stays NULL and the gas is returned without walking the events again. */
 struct gasmix get_gasmix(const struct dive *dive, const struct divecomputer *dc, int time, const struct event **evp, struct gasmix gasmix)
 {
 	const struct event *ev = *evp;
@@ -3937,7 +3979,7 @@ struct gasmix get_gasmix(const struct dive *dive, const struct divecomputer *dc,
 	if (dive->cylinders.nr <= 0)
 		return gasmix_air;
 
-	if (!ev) {
+	if (gasmix_is_invalid(gasmix)) {
 		/* on first invocation, get initial gas mix and first event (if any) */
 		int cyl = explicit_first_cylinder(dive, dc);
 		res = get_cylinder(dive, cyl)->gasmix;
@@ -3959,6 +4001,6 @@ struct gasmix get_gasmix(const struct dive *dive, const struct divecomputer *dc,
 struct gasmix get_gasmix_at_time(const struct dive *d, const struct divecomputer *dc, duration_t time)
 {
 	const struct event *ev = NULL;
-	struct gasmix gasmix = gasmix_air;
+	struct gasmix gasmix = gasmix_invalid;
 	return get_gasmix(d, dc, time.seconds, &ev, gasmix);
 }
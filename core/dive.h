@@ -26,6 +26,18 @@ extern const char *cylinderuse_text[NUM_GAS_USE];
 extern const char *divemode_text_ui[];
 extern const char *divemode_text[];
 
+/*
+ * The names of the events that the profile and the deco code look up
+ * while walking a dive are interned into a kind when the event is created.
+ * get_next_event() then compares the kind instead of the name.
+ */
+enum event_kind {
+	EVENT_KIND_OTHER,
+	EVENT_KIND_GASCHANGE,	/* "gaschange" */
+	EVENT_KIND_MODECHANGE,	/* "modechange" */
+	EVENT_KIND_SETPOINT,	/* "SP change" */
+};
+
 /*
  * Events are currently based straight on what libdivecomputer gives us.
  *  We need to wrap these into our own events at some point to remove some of the limitations.
@@ -50,6 +62,7 @@ struct event {
 		} gas;
 	};
 	bool deleted;
+	uint8_t kind;	/* enum event_kind, derived from the name */
 	char name[];
 };
 
@@ -69,6 +82,11 @@ static inline int interpolate(int a, int b, int part, int whole)
 }
 
 #define MAX_SENSORS 2
+/*
+ * Samples make up most of the memory of a loaded log, so the members
+ * are ordered by alignment to avoid padding holes and the two flags
+ * share a byte. Keep it that way when adding members.
+ */
 struct sample                         // BASE TYPE BYTES  UNITS    RANGE               DESCRIPTION
 {                                     // --------- -----  -----    -----               -----------
 	duration_t time;                  // int32_t    4  seconds  (0-34 yrs)             elapsed dive time up to this sample
@@ -79,18 +97,19 @@ struct sample                         // BASE TYPE BYTES  UNITS    RANGE
 	depth_t depth;                    // int32_t    4    mm     (0-2000 km)            dive depth of this sample
 	depth_t stopdepth;                // int32_t    4    mm     (0-2000 km)            depth of next deco stop
 	temperature_t temperature;        // uint32_t   4    mK     (0-4 MK)               ambient temperature
-	pressure_t pressure[MAX_SENSORS]; // int32_t    4    mbar   (0-2 Mbar)             cylinder pressures (main and CCR o2)
+	pressure_t pressure[MAX_SENSORS]; // int32_t    8    mbar   (0-2 Mbar)             cylinder pressures (main and CCR o2)
+	volume_t sac;                     // int32_t    4  ml/min                          predefined SAC
 	o2pressure_t setpoint;            // uint16_t   2    mbar   (0-65 bar)             O2 partial pressure (will be setpoint)
 	o2pressure_t o2sensor[3];         // uint16_t   6    mbar   (0-65 bar)             Up to 3 PO2 sensor values (rebreather)
 	bearing_t bearing;                // int16_t    2  degrees  (-1 no val, 0-360 deg) compass bearing
-	uint8_t sensor[MAX_SENSORS];      // uint8_t    1  sensorID (0-255)                ID of cylinder pressure sensor
-	uint16_t cns;                     // uint16_t   1     %     (0-64k %)              cns% accumulated
+	uint16_t cns;                     // uint16_t   2     %     (0-64k %)              cns% accumulated
+	uint8_t sensor[MAX_SENSORS];      // uint8_t    2  sensorID (0-255)                ID of cylinder pressure sensor
 	uint8_t heartbeat;                // uint8_t    1  beats/m  (0-255)                heart rate measurement
-	volume_t sac;                     //            4  ml/min                          predefined SAC
-	bool in_deco;                     // bool       1    y/n      y/n                  this sample is part of deco
-	bool manually_entered;            // bool       1    y/n      y/n                  this sample was entered by the user,
+	bool in_deco : 1;                 // bool     1 bit  y/n      y/n                  this sample is part of deco
+	bool manually_entered : 1;        // bool     1 bit  y/n      y/n                  this sample was entered by the user,
 					  //                                               not calculated when planning a dive
-};	                                  // Total size of structure: 57 bytes, excluding padding at end
+					  // both flags share 1 byte, so there is no padding: 59 + 1 = 60 bytes
+};	                                  // Total size of structure: 60 bytes (64 before the reordering)
 
 struct extra_data {
 	const char *key;
@@ -166,6 +185,7 @@ struct dive {
 	bool selected;
 	bool hidden_by_filter;
 	struct full_text_cache *full_text; /* word cache for full text search */
+	struct deco_chain_cache *deco_chain; /* tissue loading and CNS at the end of the dive */
 	bool invalid;
 };
 
@@ -311,6 +331,7 @@ extern struct dive *move_dive(struct dive *s);
 
 extern void alloc_samples(struct divecomputer *dc, int num);
 extern void free_samples(struct divecomputer *dc);
+extern void trim_samples(struct divecomputer *dc);
 extern struct sample *prepare_sample(struct divecomputer *dc);
 extern void finish_sample(struct divecomputer *dc);
 extern struct sample *add_sample(const struct sample *sample, int time, struct divecomputer *dc);
@@ -382,6 +403,7 @@ extern bool has_planned(const struct dive *dive, bool planned);
 
 /* Since C doesn't have parameter-based overloading, two versions of get_next_event. */
 extern const struct event *get_next_event(const struct event *event, const char *name);
+extern enum event_kind get_event_kind(const char *name);
 extern struct event *get_next_event_mutable(struct event *event, const char *name);
 
 /* Get gasmixes at increasing timestamps.
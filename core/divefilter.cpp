@@ -142,7 +142,9 @@ void DiveFilter::setFilter(const FilterData &data)
 #include "desktop-widgets/divelistview.h"
 #include "core/trip.h"
 #include "core/divesite.h"
+#include "core/qthelper.h"
 #include "qt-models/filtermodels.h"
+#include <vector>
 
 ShownChange DiveFilter::update(const QVector<dive *> &dives) const
 {
@@ -152,10 +154,13 @@ ShownChange DiveFilter::update(const QVector<dive *> &dives) const
 	bool doDS = diveSiteMode();
 	bool doFullText = filterData.fullText.doit();
 	for (dive *d: dives) {
+		// The dive may have changed - recompute all criteria
+		FilterCache::Entry *cached = cache.reset(d);
+
 		// There are three modes: divesite, fulltext, normal
 		bool newStatus = doDS        ? dive_sites.contains(d->dive_site) :
-				 doFullText  ? fulltext_dive_matches(d, filterData.fullText, filterData.fulltextStringMode) && showDive(d) :
-					       showDive(d);
+				 doFullText  ? fulltext_dive_matches(d, filterData.fullText, filterData.fulltextStringMode) && showDive(d, cached) :
+					       showDive(d, cached);
 		updateDiveStatus(d, newStatus, res);
 	}
 	res.currentChanged = old_current != current_dive;
@@ -175,17 +180,36 @@ ShownChange DiveFilter::updateAll() const
 			bool newStatus = dive_sites.contains(d->dive_site);
 			updateDiveStatus(d, newStatus, res);
 		}
-	} else if (filterData.fullText.doit()) {
-		FullTextResult ft = fulltext_find_dives(filterData.fullText, filterData.fulltextStringMode);
-		for_each_dive(i, d) {
-			bool newStatus = ft.dive_matches(d) && showDive(d);
-			updateDiveStatus(d, newStatus, res);
-		}
 	} else {
-		for_each_dive(i, d) {
-			bool newStatus = showDive(d);
-			updateDiveStatus(d, newStatus, res);
-		}
+		// If we don't come from setFilter(), something else, such as the
+		// preferences, might have changed. Don't trust the cache in that case.
+		if (!keepCache)
+			cache.clear();
+		cache.sync();
+
+		// Compute the new status of all dives on the thread pool. Each thread
+		// only writes to the cache entry and status of its own dive.
+		struct FilterJob {
+			const DiveFilter *filter;
+			const FullTextResult *ft;
+			std::vector<char> status;
+		} job;
+		FullTextResult ft;
+		if (filterData.fullText.doit())
+			ft = fulltext_find_dives(filterData.fullText, filterData.fulltextStringMode);
+		job.filter = this;
+		job.ft = filterData.fullText.doit() ? &ft : nullptr;
+		job.status.resize(dive_table.nr);
+		run_in_parallel(dive_table.nr, [](int idx, void *data) {
+			FilterJob *job = static_cast<FilterJob *>(data);
+			const dive *d = get_dive(idx);
+			job->status[idx] = (!job->ft || job->ft->dive_matches(d)) &&
+					   job->filter->showDive(d, job->filter->cache.entry(idx));
+		}, &job);
+
+		// Changing the filter status has side effects (e.g. the current dive), do that serially.
+		for_each_dive(i, d)
+			updateDiveStatus(d, job.status[i], res);
 	}
 	res.currentChanged = old_current != current_dive;
 	return res;
@@ -287,11 +311,41 @@ DiveFilter *DiveFilter::instance()
 	return &self;
 }
 
-DiveFilter::DiveFilter() : diveSiteRefCount(0)
+DiveFilter::DiveFilter() : fromWhen(0), toWhen(0), checkFrom(false), checkTo(false), keepCache(false), diveSiteRefCount(0)
 {
 }
 
-bool DiveFilter::showDive(const struct dive *d) const
+bool DiveFilter::checkCriterion(FilterCache::Criterion criterion, const struct dive *d, FilterCache::Entry *cached) const
+{
+	bool res;
+	if (FilterCache::lookup(cached, criterion, res))
+		return res;
+
+	switch (criterion) {
+	case FilterCache::TAGS:
+	default:
+		res = hasTags(filterData.tags, d, filterData.tagsMode, filterData.tagsStringMode);
+		break;
+	case FilterCache::PEOPLE:
+		res = hasPersons(filterData.people, d, filterData.peopleMode, filterData.peopleStringMode);
+		break;
+	case FilterCache::LOCATION:
+		res = hasLocations(filterData.location, d, filterData.locationMode, filterData.locationStringMode);
+		break;
+	case FilterCache::SUIT:
+		res = hasSuits(filterData.suit, d, filterData.suitMode, filterData.suitStringMode);
+		break;
+	case FilterCache::NOTES:
+		res = hasNotes(filterData.dnotes, d, filterData.dnotesMode, filterData.dnotesStringMode);
+		break;
+	}
+
+	FilterCache::store(cached, criterion, res);
+	return res;
+}
+
+// If cached is non-null, the results of the string criteria are taken from and stored in that entry.
+bool DiveFilter::showDive(const struct dive *d, FilterCache::Entry *cached) const
 {
 	if (d->invalid && !prefs.display_invalid_dives)
 		return false;
@@ -314,51 +368,46 @@ bool DiveFilter::showDive(const struct dive *d) const
 	    (d->airtemp.mkelvin < (*temp_comp)(filterData.minAirTemp) || d->airtemp.mkelvin > (*temp_comp)(filterData.maxAirTemp)))
 		return false;
 
-	QDateTime t = filterData.fromDate;
-	t.setTime(filterData.fromTime);
-	if (filterData.fromDate.isValid() && filterData.fromTime.isValid() &&
-	    d->when < t.toMSecsSinceEpoch()/1000 + t.offsetFromUtc())
+	if (checkFrom && d->when < fromWhen)
 		return false;
 
-	t = filterData.toDate;
-	t.setTime(filterData.toTime);
-	if (filterData.toDate.isValid() && filterData.toTime.isValid() &&
-	    d->when > t.toMSecsSinceEpoch()/1000 + t.offsetFromUtc())
+	if (checkTo && d->when > toWhen)
 		return false;
 
+	// Planned/Logged
+	if (!filterData.logged && !has_planned(d, true))
+		return false;
+	if (!filterData.planned && !has_planned(d, false))
+		return false;
+
+	// Dive mode
+	if (filterData.diveMode >= 0 && d->dc.divemode != (divemode_t)filterData.diveMode)
+		return false;
+
+	// The string criteria are the expensive ones, therefore check them last.
 	// tags.
-	if (!hasTags(filterData.tags, d, filterData.tagsMode, filterData.tagsStringMode))
+	if (!checkCriterion(FilterCache::TAGS, d, cached))
 		return false;
 
 	// people
-	if (!hasPersons(filterData.people, d, filterData.peopleMode, filterData.peopleStringMode))
+	if (!checkCriterion(FilterCache::PEOPLE, d, cached))
 		return false;
 
 	// Location
-	if (!hasLocations(filterData.location, d, filterData.locationMode, filterData.locationStringMode))
+	if (!checkCriterion(FilterCache::LOCATION, d, cached))
 		return false;
 
 	// Suit
-	if (!hasSuits(filterData.suit, d, filterData.suitMode, filterData.suitStringMode))
+	if (!checkCriterion(FilterCache::SUIT, d, cached))
 		return false;
 
 	// Notes
-	if (!hasNotes(filterData.dnotes, d, filterData.dnotesMode, filterData.dnotesStringMode))
+	if (!checkCriterion(FilterCache::NOTES, d, cached))
 		return false;
 
 	if (!hasEquipment(filterData.equipment, d, filterData.equipmentMode, filterData.equipmentStringMode))
 		return false;
 
-	// Planned/Logged
-	if (!filterData.logged && !has_planned(d, true))
-		return false;
-	if (!filterData.planned && !has_planned(d, false))
-		return false;
-
-	// Dive mode
-	if (filterData.diveMode >= 0 && d->dc.divemode != (divemode_t)filterData.diveMode)
-		return false;
-
 	return true;
 }
 
@@ -412,7 +461,35 @@ bool DiveFilter::diveSiteMode() const
 
 void DiveFilter::setFilter(const FilterData &data)
 {
+	// Forget the cached results of the criteria that changed
+	uint8_t changed = 0;
+	if (data.tags != filterData.tags || data.tagsMode != filterData.tagsMode || data.tagsStringMode != filterData.tagsStringMode)
+		changed |= FilterCache::bit(FilterCache::TAGS);
+	if (data.people != filterData.people || data.peopleMode != filterData.peopleMode || data.peopleStringMode != filterData.peopleStringMode)
+		changed |= FilterCache::bit(FilterCache::PEOPLE);
+	if (data.location != filterData.location || data.locationMode != filterData.locationMode || data.locationStringMode != filterData.locationStringMode)
+		changed |= FilterCache::bit(FilterCache::LOCATION);
+	if (data.suit != filterData.suit || data.suitMode != filterData.suitMode || data.suitStringMode != filterData.suitStringMode)
+		changed |= FilterCache::bit(FilterCache::SUIT);
+	if (data.dnotes != filterData.dnotes || data.dnotesMode != filterData.dnotesMode || data.dnotesStringMode != filterData.dnotesStringMode)
+		changed |= FilterCache::bit(FilterCache::NOTES);
+	cache.invalidate(changed);
+
 	filterData = data;
+
+	// Convert the date range only once instead of for every dive
+	QDateTime t = filterData.fromDate;
+	t.setTime(filterData.fromTime);
+	checkFrom = filterData.fromDate.isValid() && filterData.fromTime.isValid();
+	fromWhen = t.toMSecsSinceEpoch()/1000 + t.offsetFromUtc();
+
+	t = filterData.toDate;
+	t.setTime(filterData.toTime);
+	checkTo = filterData.toDate.isValid() && filterData.toTime.isValid();
+	toWhen = t.toMSecsSinceEpoch()/1000 + t.offsetFromUtc();
+
+	keepCache = true;
 	emit diveListNotifier.filterReset();
+	keepCache = false;
 }
 #endif // SUBSURFACE_MOBILE
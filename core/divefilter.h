@@ -50,6 +50,8 @@ private:
 
 #else
 
+#include "filtercache.h"
+#include "units.h"
 #include <QDateTime>
 
 struct dive_trip;
@@ -118,10 +120,15 @@ public:
 	ShownChange updateAll() const; // Update filter status of all dives and return dives whose status changed
 private:
 	DiveFilter();
-	bool showDive(const struct dive *d) const; // Should that dive be shown?
+	bool showDive(const struct dive *d, FilterCache::Entry *cached = nullptr) const; // Should that dive be shown?
+	bool checkCriterion(FilterCache::Criterion criterion, const struct dive *d, FilterCache::Entry *cached) const;
 
 	QVector<dive_site *> dive_sites;
 	FilterData filterData;
+	timestamp_t fromWhen, toWhen; // Date range of filterData in dive time
+	bool checkFrom, checkTo;
+	mutable FilterCache cache; // The range criteria are cheap and always recomputed
+	bool keepCache; // Set by setFilter(): the next updateAll() may reuse cached results
 
 	// We use ref-counting for the dive site mode. The reason is that when switching
 	// between two tabs that both need dive site mode, the following course of
@@ -8,7 +8,9 @@
 #include "divesite.h"
 #include "dive.h"
 #include "fulltext.h"
+#include "idindex.h"
 #include "planner.h"
+#include "plotinfoservice.h"
 #include "qthelper.h"
 #include "gettext.h"
 #include "git-access.h"
@@ -79,10 +81,10 @@ int total_weight(const struct dive *dive)
 	return total_grams;
 }
 
-static int active_o2(const struct dive *dive, const struct divecomputer *dc, duration_t time)
+static int active_o2(const struct dive *dive, const struct divecomputer *dc, duration_t time, const struct event **evp, struct gasmix *gasmix)
 {
-	struct gasmix gas = get_gasmix_at_time(dive, dc, time);
-	return get_o2(gas);
+	*gasmix = get_gasmix(dive, dc, time.seconds, evp, *gasmix);
+	return get_o2(*gasmix);
 }
 
 /* Calculate OTU for a dive - this only takes the first divecomputer into account.
@@ -97,6 +99,8 @@ static int calculate_otu(const struct dive *dive)
 	int i;
 	double otu = 0.0;
 	const struct divecomputer *dc = &dive->dc;
+	const struct event *ev = NULL;
+	struct gasmix gasmix = gasmix_invalid;
 	for (i = 1; i < dc->samples; i++) {
 		int t;
 		int po2i, po2f;
@@ -112,7 +116,7 @@ static int calculate_otu(const struct dive *dive)
 				po2i = psample->setpoint.mbar;		// if CCR has no o2 sensors then use setpoint
 				po2f = sample->setpoint.mbar;
 			} else {						// For OC and rebreather without o2 sensor/setpoint
-				int o2 = active_o2(dive, dc, psample->time);	// 	... calculate po2 from depth and FiO2.
+				int o2 = active_o2(dive, dc, psample->time, &ev, &gasmix);	// 	... calculate po2 from depth and FiO2.
 				po2i = lrint(o2 * depth_to_atm(psample->depth.mm, dive));	// (initial) po2 at start of segment
 				po2f = lrint(o2 * depth_to_atm(sample->depth.mm, dive));	// (final) po2 at end of segment
 			}
@@ -150,6 +154,8 @@ static double calculate_cns_dive(const struct dive *dive)
 	const struct divecomputer *dc = &dive->dc;
 	double cns = 0.0;
 	double rate;
+	const struct event *ev = NULL;
+	struct gasmix gasmix = gasmix_invalid;
 	/* Calculate the CNS for each sample in this dive and sum them */
 	for (n = 1; n < dc->samples; n++) {
 		int t;
@@ -169,7 +175,7 @@ static double calculate_cns_dive(const struct dive *dive)
 			trueo2 = true;
 		}
 		if (!trueo2) {
-			int o2 = active_o2(dive, dc, psample->time);			// For OC and rebreather without o2 sensor:
+			int o2 = active_o2(dive, dc, psample->time, &ev, &gasmix);			// For OC and rebreather without o2 sensor:
 			po2i = lrint(o2 * depth_to_atm(psample->depth.mm, dive));	// (initial) po2 at start of segment
 			po2f = lrint(o2 * depth_to_atm(sample->depth.mm, dive));	// (final) po2 at end of segment
 		}
@@ -187,8 +193,9 @@ static double calculate_cns_dive(const struct dive *dive)
 
 /* this only gets called if dive->maxcns == 0 which means we know that
  * none of the divecomputers has tracked any CNS for us
- * so we calculated it "by hand" */
-static int calculate_cns(struct dive *dive)
+ * so we calculated it "by hand". Walks the dive list backwards: the
+ * common case is handled by the cached version, calculate_cns() */
+static int calculate_cns_walk(struct dive *dive)
 {
 	int i, divenr;
 	double cns = 0.0;
@@ -375,7 +382,7 @@ static int calculate_sac(const struct dive *dive)
 static void add_dive_to_deco(struct deco_state *ds, struct dive *dive)
 {
 	struct divecomputer *dc = &dive->dc;
-	struct gasmix gasmix = gasmix_air;
+	struct gasmix gasmix = gasmix_invalid;
 	int i;
 	const struct event *ev = NULL, *evd = NULL;
 	enum divemode_t current_divemode = UNDEF_COMP_TYPE;
@@ -399,17 +406,29 @@ static void add_dive_to_deco(struct deco_state *ds, struct dive *dive)
 	}
 }
 
+static int get_idx_in_dive_table(const struct dive_table *table, const struct dive *item);
+
+/* Dive tables are kept sorted, so the dive sits right before its insertion
+ * index - unless it was edited and the table wasn't resorted yet. */
+static int get_sorted_idx_in_dive_table(struct dive_table *table, struct dive *d)
+{
+	int idx = dive_table_get_insertion_index(table, d) - 1;
+	if (idx >= 0 && table->dives[idx] == d)
+		return idx;
+	return get_idx_in_dive_table(table, d);
+}
+
 int get_divenr(const struct dive *dive)
 {
-	int i;
-	const struct dive *d;
+	struct dive *d;
 	// tempting as it may be, don't die when called with dive=NULL
-	if (dive)
-		for_each_dive(i, d) {
-			if (d->id == dive->id) // don't compare pointers, we could be passing in a copy of the dive
-				return i;
-		}
-	return -1;
+	if (!dive)
+		return -1;
+	// don't compare pointers, we could be passing in a copy of the dive
+	d = get_by_id_in_dive_table(&dive_table, dive->id);
+	if (!d)
+		return -1;
+	return get_sorted_idx_in_dive_table(&dive_table, d);
 }
 
 static struct gasmix air = { .o2.permille = O2_IN_AIR, .he.permille = 0 };
@@ -419,7 +438,9 @@ static struct gasmix air = { .o2.permille = O2_IN_AIR, .he.permille = 0 };
 /* return negative surface time if dives are overlapping */
 /* The place you call this function is likely the place where you want
  * to create the deco_state */
-int init_decompression(struct deco_state *ds, struct dive *dive)
+/* This version walks the dive list backwards and is used where the cached
+ * version, init_decompression(), can't be used */
+int init_decompression_walk(struct deco_state *ds, struct dive *dive)
 {
 	int i, divenr = -1;
 	int surface_time = 48 * 60 * 60;
@@ -583,6 +604,299 @@ int init_decompression(struct deco_state *ds, struct dive *dive)
 	return surface_time;
 }
 
+/*
+ * Residual tissue loading and CNS of previous dives
+ *
+ * init_decompression() and calculate_cns() need the state at the end of
+ * the preceding dives. These form chains of dives that are separated by
+ * surface intervals of less than 48 h (tissues) or 12 h (CNS). If the dive
+ * is part of a trip, only dives of that trip are considered.
+ *
+ * The state at the end of each dive is cached in the dive and calculated
+ * from the state at the end of the previous dive in the chain. Each entry
+ * remembers which dive it was calculated from and a serial number of that
+ * entry, so that an entry is recalculated if its predecessor changed.
+ *
+ * Verifying an entry would mean walking back to the start of its chain.
+ * To avoid that, entries are marked as verified in the current "epoch",
+ * which is bumped whenever a dive is edited or the dive tables change.
+ */
+enum deco_chain_kind {
+	TISSUE_CHAIN,
+	CNS_CHAIN
+};
+
+static const int deco_chain_gap[] = { 48 * 60 * 60, 12 * 60 * 60 };
+
+struct deco_chain_entry {
+	bool valid;
+	int params;			/* deco parameters the entry was calculated with */
+	int prev_id;			/* previous dive in the chain, 0 for the first dive */
+	unsigned int serial, prev_serial;
+	unsigned int checked;		/* epoch in which the entry was last verified */
+};
+
+/* Index 0 are chains of all dives, index 1 chains of dives of the same trip */
+struct deco_chain_cache {
+	struct deco_chain_entry entries[2][2];	/* [kind][trip] */
+	struct deco_state ds[2];		/* tissues at the end of the dive */
+	int overlap[2];				/* negative surface interval if the chain has overlapping dives */
+	double cns[2];				/* CNS at the end of the dive */
+};
+
+static unsigned int deco_chain_epoch = 1, deco_chain_serial;
+
+static int deco_chain_params(enum deco_chain_kind kind)
+{
+	struct deco_params params;
+
+	if (kind != TISSUE_CHAIN)
+		return 0;
+	get_deco_params(&params);
+	return params.mode * 16 + params.vpmb_conservatism;
+}
+
+static struct deco_chain_entry *get_deco_chain_entry(struct dive *dive, enum deco_chain_kind kind, int trip)
+{
+	if (!dive->deco_chain)
+		dive->deco_chain = calloc(1, sizeof(struct deco_chain_cache));
+	return &dive->deco_chain->entries[kind][trip];
+}
+
+/* First index in the table of a dive that doesn't start before "when" */
+static int deco_chain_lower_bound(const struct dive_table *table, timestamp_t when)
+{
+	int lo = 0, hi = table->nr;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (table->dives[mid]->when < when)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* The dive before index idx, if it is in the same chain as a dive starting at "when" */
+static struct dive *deco_chain_prev(const struct dive_table *table, int idx, timestamp_t when, enum deco_chain_kind kind)
+{
+	struct dive *prev;
+
+	if (idx <= 0)
+		return NULL;
+	prev = table->dives[idx - 1];
+	return dive_endtime(prev) + deco_chain_gap[kind] < when ? NULL : prev;
+}
+
+static void calculate_deco_chain_entry(struct dive *dive, struct dive *prev, enum deco_chain_kind kind, int trip)
+{
+	struct deco_chain_cache *c = dive->deco_chain;
+	const struct deco_chain_cache *pc = prev ? prev->deco_chain : NULL;
+	struct deco_state *ds = &c->ds[trip];
+	double surface_pressure;
+
+	if (kind == CNS_CHAIN) {
+		double cns = 0.0;
+		/* CNS reduced with 90min halftime during surface interval */
+		if (prev) {
+			cns = pc->cns[trip];
+			cns /= pow(2, (dive->when - dive_endtime(prev)) / (90.0 * 60.0));
+		}
+		cns += calculate_cns_dive(dive);
+		c->cns[trip] = cns;
+		return;
+	}
+
+	c->overlap[trip] = 0;
+	if (prev && pc->overlap[trip] < 0) {
+		*ds = pc->ds[trip];
+		c->overlap[trip] = pc->overlap[trip];
+		return;
+	}
+	surface_pressure = get_surface_pressure_in_mbar(dive, true) / 1000.0;
+	if (prev) {
+		int surface_time = dive->when - dive_endtime(prev);
+		*ds = pc->ds[trip];
+		get_deco_params(&ds->params);
+		if (surface_time < 0) {
+			c->overlap[trip] = surface_time;
+			return;
+		}
+		/* Without a setpoint, only PSCR differs from OC. PSCR dives don't use the cache. */
+		add_segment(ds, surface_pressure, air, surface_time, 0, OC, prefs.decosac);
+	} else {
+		clear_deco(ds, surface_pressure);
+	}
+	add_dive_to_deco(ds, dive);
+	clear_vpmb_state(ds);
+}
+
+/* Bring the entries of the chain up to and including the dive at index idx up to date */
+static void update_deco_chain(const struct dive_table *table, int idx, enum deco_chain_kind kind, int trip)
+{
+	int i, first = idx;
+	int params = deco_chain_params(kind);
+
+	/* Walk back to the first entry that was already verified or the start of the chain.
+	 * If the predecessor of a verified entry has no valid entry (e.g. its cache was
+	 * dropped when the dive data was exchanged), the predecessor is recalculated first. */
+	for (;;) {
+		struct dive *d = table->dives[first];
+		struct dive *prev = deco_chain_prev(table, first, d->when, kind);
+		const struct deco_chain_entry *e, *pe;
+
+		if (!prev)
+			break;
+		e = get_deco_chain_entry(d, kind, trip);
+		pe = get_deco_chain_entry(prev, kind, trip);
+		if (e->valid && e->params == params && e->checked == deco_chain_epoch &&
+		    pe->valid && pe->params == params)
+			break;
+		first--;
+	}
+
+	for (i = first; i <= idx; i++) {
+		struct dive *d = table->dives[i];
+		struct dive *prev = deco_chain_prev(table, i, d->when, kind);
+		struct deco_chain_entry *e = get_deco_chain_entry(d, kind, trip);
+		const struct deco_chain_entry *pe = prev ? get_deco_chain_entry(prev, kind, trip) : NULL;
+
+		if (!e->valid || e->params != params || e->prev_id != (prev ? prev->id : 0) ||
+		    (pe && e->prev_serial != pe->serial)) {
+			calculate_deco_chain_entry(d, prev, kind, trip);
+			e->valid = true;
+			e->params = params;
+			e->prev_id = prev ? prev->id : 0;
+			e->prev_serial = pe ? pe->serial : 0;
+			e->serial = ++deco_chain_serial;
+		}
+		e->checked = deco_chain_epoch;
+	}
+}
+
+/* Can the cache be used for this dive? Not if the dive is an edited copy of a
+ * dive in the table which was moved to a later time, because then the original
+ * would have to be excluded from the chain. */
+static bool deco_chain_usable(const struct dive *dive)
+{
+	int i, divenr;
+	int idx = deco_chain_lower_bound(&dive_table, dive->when);
+
+	for (i = idx; i < dive_table.nr && dive_table.dives[i]->when == dive->when; i++) {
+		if (dive_table.dives[i] == dive)
+			return true;
+	}
+	divenr = get_divenr(dive);
+	return divenr < 0 || divenr >= idx;
+}
+
+/* Get the last dive of the chain preceding the dive, or NULL if there is none.
+ * The cache entry of the returned dive is up to date. Must be called with the
+ * deco chains locked. */
+static struct dive *get_deco_chain_prev(const struct dive *dive, enum deco_chain_kind kind, int *trip)
+{
+	const struct dive_table *table = dive->divetrip ? &dive->divetrip->dives : &dive_table;
+	int idx = deco_chain_lower_bound(table, dive->when);
+	struct dive *prev = deco_chain_prev(table, idx, dive->when, kind);
+
+	*trip = dive->divetrip ? 1 : 0;
+	if (prev)
+		update_deco_chain(table, idx - 1, kind, *trip);
+	return prev;
+}
+
+/* A dive was edited: recalculate its cache entries and those depending on it */
+void invalidate_deco_chain(struct dive *dive)
+{
+	if (!dive)
+		return;
+	/* Even if the dive has no cache, the entries of the following dives may depend on it */
+	lock_deco_chains();
+	if (dive->deco_chain)
+		memset(dive->deco_chain->entries, 0, sizeof(dive->deco_chain->entries));
+	deco_chain_epoch++;
+	unlock_deco_chains();
+}
+
+/* Dives were added to or removed from a dive table or their order changed */
+void invalidate_deco_chains(void)
+{
+	lock_deco_chains();
+	deco_chain_epoch++;
+	unlock_deco_chains();
+}
+
+void free_deco_chain(struct dive *dive)
+{
+	free(dive->deco_chain);
+	dive->deco_chain = NULL;
+}
+
+int init_decompression(struct deco_state *ds, struct dive *dive)
+{
+	int trip, surface_time = 48 * 60 * 60;
+	double surface_pressure;
+	struct dive *prev;
+
+	if (!dive)
+		return false;
+	/* The planner uses a different water vapor pressure for VPM-B. For PSCR dives, the
+	 * surface intervals depend on the dive mode of the current dive. */
+	if (in_planner() || dive->dc.divemode == PSCR || !deco_chain_usable(dive))
+		return init_decompression_walk(ds, dive);
+
+	surface_pressure = get_surface_pressure_in_mbar(dive, true) / 1000.0;
+	lock_deco_chains();
+	prev = get_deco_chain_prev(dive, TISSUE_CHAIN, &trip);
+	if (!prev) {
+		clear_deco(ds, surface_pressure);
+	} else {
+		const struct deco_chain_cache *pc = prev->deco_chain;
+		*ds = pc->ds[trip];
+		/* The cached state may have been calculated with other gradient factors */
+		get_deco_params(&ds->params);
+		surface_time = pc->overlap[trip] < 0 ? pc->overlap[trip] : dive->when - dive_endtime(prev);
+		if (surface_time < 0) {
+			unlock_deco_chains();
+			return surface_time;
+		}
+		add_segment(ds, surface_pressure, air, surface_time, 0, dive->dc.divemode, prefs.decosac);
+	}
+	unlock_deco_chains();
+
+	// I do not dare to remove this call. We don't need the result but it might have side effects. Bummer.
+	tissue_tolerance_calc(ds, dive, surface_pressure);
+	return surface_time;
+}
+
+static int calculate_cns(struct dive *dive)
+{
+	int trip;
+	double cns = 0.0;
+	struct dive *prev;
+
+	/* shortcut */
+	if (dive->cns)
+		return dive->cns;
+	if (!deco_chain_usable(dive))
+		return calculate_cns_walk(dive);
+
+	lock_deco_chains();
+	prev = get_deco_chain_prev(dive, CNS_CHAIN, &trip);
+	/* CNS reduced with 90min halftime during surface interval */
+	if (prev) {
+		cns = prev->deco_chain->cns[trip];
+		cns /= pow(2, (dive->when - dive_endtime(prev)) / (90.0 * 60.0));
+	}
+	unlock_deco_chains();
+	cns += calculate_cns_dive(dive);
+
+	/* save calculated cns in dive struct */
+	dive->cns = lrint(cns);
+	return dive->cns;
+}
+
 void update_cylinder_related_info(struct dive *dive)
 {
 	if (dive != NULL) {
@@ -693,21 +1007,46 @@ int comp_dives(const struct dive *a, const struct dive *b)
 	return 0; /* this should not happen for a != b */
 }
 
+/* Only the global dive table is looked up by id */
+static bool is_global_dive_table(const struct dive_table *table)
+{
+	return table == &dive_table;
+}
+
 /* Dive table functions */
 static MAKE_GROW_TABLE(dive_table, struct dive *, dives)
 MAKE_GET_INSERTION_INDEX(dive_table, struct dive *, dives, dive_less_than)
-MAKE_ADD_TO(dive_table, struct dive *, dives)
-static MAKE_REMOVE_FROM(dive_table, dives)
+MAKE_ID_INDEX(dive_table, dives, is_global_dive_table)
+MAKE_ADD_TO_INDEXED(dive_table, struct dive *, dives, id)
+static MAKE_REMOVE_FROM_INDEXED(dive_table, dives, id)
 static MAKE_GET_IDX(dive_table, struct dive *, dives)
 MAKE_SORT(dive_table, struct dive *, dives, comp_dives)
-MAKE_REMOVE(dive_table, struct dive *, dive)
-MAKE_CLEAR_TABLE(dive_table, dives, dive)
-MAKE_MOVE_TABLE(dive_table, dives)
+
+int remove_dive(const struct dive *dive, struct dive_table *table)
+{
+	int idx = get_sorted_idx_in_dive_table(table, (struct dive *)dive);
+	if (idx >= 0)
+		remove_from_dive_table(table, idx);
+	return idx;
+}
+MAKE_CLEAR_TABLE_INDEXED(dive_table, dives, dive)
+MAKE_MOVE_TABLE_INDEXED(dive_table, dives)
+MAKE_GET_BY_ID(dive_table, struct dive *, dives, id)
+static MAKE_MERGE_INTO_INDEXED(dive_table, struct dive *, dives, dive_less_than, id)
 
 void insert_dive(struct dive_table *table, struct dive *d)
 {
 	int idx = dive_table_get_insertion_index(table, d);
 	add_to_dive_table(table, idx, d);
+	invalidate_deco_chains();
+}
+
+/* Add a whole batch of dives in O(n log n), instead of shifting the
+ * table for every single dive. The dives table is sorted, but not emptied. */
+void insert_dives(struct dive_table *table, struct dive_table *dives)
+{
+	merge_into_dive_table(table, dives);
+	invalidate_deco_chains();
 }
 
 /*
@@ -742,8 +1081,10 @@ static void autogroup_dives(struct dive_table *table, struct trip_table *trip_ta
  * It simply shrinks the table and frees the trip */
 void delete_dive_from_table(struct dive_table *table, int idx)
 {
-	free_dive(table->dives[idx]);
+	struct dive *dive = table->dives[idx];
 	remove_from_dive_table(table, idx);
+	free_dive(dive);
+	invalidate_deco_chains();
 }
 
 struct dive *get_dive_from_table(int nr, const struct dive_table *dt)
@@ -766,6 +1107,7 @@ struct dive *unregister_dive(int idx)
 	 * we also have to unregister its fulltext cache. */
 	fulltext_unregister(dive);
 	remove_from_dive_table(&dive_table, idx);
+	invalidate_deco_chains();
 	if (dive->selected)
 		amount_selected--;
 	dive->selected = false;
@@ -872,8 +1214,9 @@ static void merge_imported_dives(struct dive_table *table)
 		}
 
 		/* Overwrite the first of the two dives and remove the second */
+		remove_from_dive_table(table, i - 1);
+		add_to_dive_table(table, i - 1, merged);
 		free_dive(prev);
-		table->dives[i - 1] = merged;
 		delete_dive_from_table(table, i);
 
 		/* Redo the new 'i'th dive */
@@ -1030,8 +1373,7 @@ void add_imported_dives(struct dive_table *import_table, struct trip_table *impo
 	dives_to_remove.nr = 0;
 
 	/* Add new dives */
-	for (i = 0; i < dives_to_add.nr; i++)
-		insert_dive(&dive_table, dives_to_add.dives[i]);
+	insert_dives(&dive_table, &dives_to_add);
 	dives_to_add.nr = 0;
 
 	/* Add new trips */
@@ -1086,6 +1428,20 @@ bool try_to_merge_trip(struct dive_trip *trip_import, struct dive_table *import_
 	return false;
 }
 
+/* Dive site to be replaced by an already existing one on import */
+struct site_replacement {
+	struct dive_site *from, *to;
+};
+
+/* Compare the dive site pointers at the start of two array elements.
+ * Works for arrays of pointers and arrays of struct site_replacement. */
+static int comp_site_ptrs(const void *_a, const void *_b)
+{
+	uintptr_t a = (uintptr_t)*(struct dive_site * const *)_a;
+	uintptr_t b = (uintptr_t)*(struct dive_site * const *)_b;
+	return a < b ? -1 : a > b ? 1 : 0;
+}
+
 /* Process imported dives: take a table of dives to be imported and
  * generate four lists:
  *	1) Dives to be added
@@ -1126,6 +1482,9 @@ void process_imported_dives(struct dive_table *import_table, struct trip_table *
 {
 	int i, j, nr, start_renumbering_at = 0;
 	struct dive_trip *trip_import, *new_trip;
+	struct dive_site **used_sites;
+	struct site_replacement *replacements;
+	int nr_replacements = 0;
 	int preexisting;
 	bool sequence_changed = false;
 	bool new_dive_has_number = false;
@@ -1178,23 +1537,29 @@ void process_imported_dives(struct dive_table *import_table, struct trip_table *
 
 	preexisting = dive_table.nr; /* Remember old size for renumbering */
 
-	/* If dive sites already exist, use the existing versions. */
+	/* If dive sites already exist, use the existing versions.
+	 * Instead of scanning all new dives for every site, collect the
+	 * sites of the new dives in a sorted array and the sites to be
+	 * replaced in another one. */
+	used_sites = malloc(import_table->nr * sizeof(*used_sites));
+	replacements = malloc(import_sites_table->nr * sizeof(*replacements));
+	if (!used_sites || (import_sites_table->nr && !replacements))
+		exit(1);
+	for (j = 0; j < import_table->nr; j++)
+		used_sites[j] = import_table->dives[j]->dive_site;
+	qsort(used_sites, import_table->nr, sizeof(*used_sites), comp_site_ptrs);
 	for (i = 0; i  < import_sites_table->nr; i++) {
 		struct dive_site *new_ds = import_sites_table->dive_sites[i];
-		struct dive_site *old_ds = get_same_dive_site(new_ds);
+		struct dive_site *old_ds;
 
 		/* Check if it dive site is actually used by new dives. */
-		for (j = 0; j < import_table->nr; j++) {
-			if (import_table->dives[j]->dive_site == new_ds)
-				break;
-		}
-
-		if (j == import_table->nr) {
+		if (!bsearch(&new_ds, used_sites, import_table->nr, sizeof(*used_sites), comp_site_ptrs)) {
 			/* Dive site not even used - free it and go to next. */
 			free_dive_site(new_ds);
 			continue;
 		}
 
+		old_ds = get_same_dive_site(new_ds);
 		if (!old_ds) {
 			/* Dive site doesn't exist. Add it to list of dive sites to be added. */
 			new_ds->dives.nr = 0; /* Caller is responsible for adding dives to site */
@@ -1202,13 +1567,23 @@ void process_imported_dives(struct dive_table *import_table, struct trip_table *
 			continue;
 		}
 		/* Dive site already exists - use the old and free the new. */
-		for (j = 0; j < import_table->nr; j++) {
-			if (import_table->dives[j]->dive_site == new_ds)
-				import_table->dives[j]->dive_site = old_ds;
-		}
-		free_dive_site(new_ds);
+		replacements[nr_replacements].from = new_ds;
+		replacements[nr_replacements].to = old_ds;
+		nr_replacements++;
+	}
+	qsort(replacements, nr_replacements, sizeof(*replacements), comp_site_ptrs);
+	for (j = 0; j < import_table->nr; j++) {
+		struct dive *d = import_table->dives[j];
+		struct site_replacement *r = bsearch(&d->dive_site, replacements, nr_replacements, sizeof(*replacements), comp_site_ptrs);
+		if (r)
+			d->dive_site = r->to;
 	}
+	for (i = 0; i < nr_replacements; i++)
+		free_dive_site(replacements[i].from);
+	free(replacements);
+	free(used_sites);
 	import_sites_table->nr = 0; /* All dive sites were consumed */
+	clear_dive_site_table(import_sites_table); /* Only frees the spatial index */
 
 	/* Merge overlapping trips. Since both trip tables are sorted, we
 	 * could be smarter here, but realistically not a whole lot of trips
@@ -1371,11 +1746,14 @@ void clear_dive_file_data()
 	if (trip_table.nr != 0) {
 		fprintf(stderr, "Warning: trip table not empty in clear_dive_file_data()!\n");
 		trip_table.nr = 0;
+		free_id_index(trip_table.index);
+		trip_table.index = NULL;
 	}
 
 	clear_dive(&displayed_dive);
 	clear_device_nodes();
 	clear_events();
+	clear_plot_info_cache();
 
 	reset_min_datafile_version();
 	clear_git_id();
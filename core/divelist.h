@@ -9,6 +9,7 @@ extern "C" {
 #endif
 
 struct dive;
+struct id_index;
 struct trip_table;
 struct dive_site_table;
 struct deco_state;
@@ -17,8 +18,9 @@ extern int shown_dives;
 struct dive_table {
 	int nr, allocated;
 	struct dive **dives;
+	struct id_index *index;	/* only for the global table, see table.h */
 };
-static const struct dive_table empty_dive_table = { 0, 0, (struct dive **)0 };
+static const struct dive_table empty_dive_table = { 0, 0, (struct dive **)0, (struct id_index *)0 };
 extern struct dive_table dive_table;
 
 /* this is used for both git and xml format */
@@ -28,6 +30,10 @@ extern void update_cylinder_related_info(struct dive *);
 extern void mark_divelist_changed(bool);
 extern int unsaved_changes(void);
 extern int init_decompression(struct deco_state *ds, struct dive *dive);
+extern int init_decompression_walk(struct deco_state *ds, struct dive *dive); /* without the cache, for testing */
+extern void invalidate_deco_chain(struct dive *dive);
+extern void invalidate_deco_chains(void);
+extern void free_deco_chain(struct dive *dive);
 
 /* divelist core logic functions */
 extern void process_loaded_dives();
@@ -46,7 +52,9 @@ extern char *get_dive_gas_string(const struct dive *dive);
 
 extern int dive_table_get_insertion_index(struct dive_table *table, struct dive *dive);
 extern void add_to_dive_table(struct dive_table *table, int idx, struct dive *dive);
+extern struct dive *get_by_id_in_dive_table(const struct dive_table *table, int id);
 extern void insert_dive(struct dive_table *table, struct dive *d);
+extern void insert_dives(struct dive_table *table, struct dive_table *dives);
 extern void get_dive_gas(const struct dive *dive, int *o2_p, int *he_p, int *o2low_p);
 extern int get_divenr(const struct dive *dive);
 extern int remove_dive(const struct dive *dive, struct dive_table *table);
@@ -25,17 +25,292 @@ int get_divesite_idx(const struct dive_site *ds, struct dive_site_table *ds_tabl
 	return -1;
 }
 
-// TODO: keep table sorted by UUID and do a binary search?
+/* the table is kept sorted by uuid, see add_dive_site_to_table() */
 struct dive_site *get_dive_site_by_uuid(uint32_t uuid, struct dive_site_table *ds_table)
 {
-	int i;
-	struct dive_site *ds;
-	for_each_dive_site (i, ds, ds_table)
-		if (ds->uuid == uuid)
-			return get_dive_site(i, ds_table);
+	int lo = 0, hi = ds_table->nr;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (ds_table->dive_sites[mid]->uuid < uuid)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < ds_table->nr && ds_table->dive_sites[lo]->uuid == uuid)
+		return ds_table->dive_sites[lo];
 	return NULL;
 }
 
+/*
+ * Spatial index of the dive sites of a table. The globe is divided into cells
+ * of GRID_CELL_UDEG micro-degrees and the sites are kept sorted by
+ * (row, column, uuid) of their cell. Thus, the sites in a range of columns of
+ * one row are contiguous and found by binary search. Among sites in the same
+ * cell, the order is that of the table, so that "the first site" of a query
+ * is the same as with a linear scan of the table.
+ *
+ * The grid is built on the first location query and kept up to date when
+ * sites are added to or removed from the table. Changing the location of a
+ * site that is in a table requires a call to invalidate_dive_site_grids().
+ */
+#define GRID_CELL_UDEG 100000	/* 0.1 degree, about 11 km */
+#define METERS_PER_DEGREE 111194.93	/* 2 * pi * 6371000 / 360, as in get_distance() */
+
+struct grid_entry {
+	int row, col;
+	struct dive_site *ds;
+};
+
+struct dive_site_grid {
+	int nr, allocated;
+	unsigned int serial;
+	struct grid_entry *entries;
+};
+
+static unsigned int grid_serial;
+
+void invalidate_dive_site_grids()
+{
+	grid_serial++;
+}
+
+static int floor_div(int a, int b)
+{
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static int normalize_lon(int udeg)
+{
+	udeg %= 360000000;
+	if (udeg >= 180000000)
+		udeg -= 360000000;
+	else if (udeg < -180000000)
+		udeg += 360000000;
+	return udeg;
+}
+
+static int clamp_lat(int udeg)
+{
+	return udeg > 90000000 ? 90000000 : udeg < -90000000 ? -90000000 : udeg;
+}
+
+static struct grid_entry grid_entry(struct dive_site *ds)
+{
+	struct grid_entry e;
+	e.row = floor_div(clamp_lat(ds->location.lat.udeg), GRID_CELL_UDEG);
+	e.col = floor_div(normalize_lon(ds->location.lon.udeg), GRID_CELL_UDEG);
+	e.ds = ds;
+	return e;
+}
+
+static bool grid_entry_less_than(const struct grid_entry *a, const struct grid_entry *b)
+{
+	if (a->row != b->row)
+		return a->row < b->row;
+	if (a->col != b->col)
+		return a->col < b->col;
+	return a->ds->uuid < b->ds->uuid;
+}
+
+static int grid_entry_cmp(const void *a, const void *b)
+{
+	return grid_entry_less_than(a, b) ? -1 : grid_entry_less_than(b, a) ? 1 : 0;
+}
+
+/* index of the first entry in cell (row, col) or later */
+static int grid_lower_bound(const struct dive_site_grid *grid, int row, int col)
+{
+	int lo = 0, hi = grid->nr;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		const struct grid_entry *e = grid->entries + mid;
+		if (e->row < row || (e->row == row && e->col < col))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static void free_grid(struct dive_site_table *ds_table)
+{
+	if (ds_table->grid) {
+		free(ds_table->grid->entries);
+		free(ds_table->grid);
+		ds_table->grid = NULL;
+	}
+}
+
+static struct dive_site_grid *get_grid(struct dive_site_table *ds_table)
+{
+	struct dive_site_grid *grid = ds_table->grid;
+
+	if (grid && grid->serial == grid_serial)
+		return grid;
+	if (!grid) {
+		grid = calloc(1, sizeof(*grid));
+		if (!grid)
+			exit(1);
+		ds_table->grid = grid;
+	}
+	if (grid->allocated < ds_table->nr) {
+		grid->allocated = ds_table->nr + 32;
+		grid->entries = realloc(grid->entries, grid->allocated * sizeof(*grid->entries));
+		if (!grid->entries)
+			exit(1);
+	}
+	for (int i = 0; i < ds_table->nr; i++)
+		grid->entries[i] = grid_entry(ds_table->dive_sites[i]);
+	grid->nr = ds_table->nr;
+	qsort(grid->entries, grid->nr, sizeof(*grid->entries), grid_entry_cmp);
+	grid->serial = grid_serial;
+	return grid;
+}
+
+static void grid_add(struct dive_site_table *ds_table, struct dive_site *ds)
+{
+	struct dive_site_grid *grid = ds_table->grid;
+	struct grid_entry e = grid_entry(ds);
+	int lo, hi;
+
+	if (!grid)
+		return;
+	if (grid->serial != grid_serial) {
+		free_grid(ds_table);	/* will be rebuilt on the next query */
+		return;
+	}
+	if (grid->nr >= grid->allocated) {
+		grid->allocated = (grid->nr + 32) * 3 / 2;
+		grid->entries = realloc(grid->entries, grid->allocated * sizeof(*grid->entries));
+		if (!grid->entries)
+			exit(1);
+	}
+	lo = 0;
+	hi = grid->nr;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (grid_entry_less_than(&e, grid->entries + mid))
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	memmove(grid->entries + lo + 1, grid->entries + lo, (grid->nr - lo) * sizeof(*grid->entries));
+	grid->entries[lo] = e;
+	grid->nr++;
+}
+
+static void grid_remove(struct dive_site_table *ds_table, struct dive_site *ds)
+{
+	struct dive_site_grid *grid = ds_table->grid;
+	struct grid_entry e = grid_entry(ds);
+	int i;
+
+	if (!grid)
+		return;
+	if (grid->serial == grid_serial) {
+		for (i = grid_lower_bound(grid, e.row, e.col); i < grid->nr; i++) {
+			if (grid->entries[i].row != e.row || grid->entries[i].col != e.col)
+				break;
+			if (grid->entries[i].ds == ds) {
+				memmove(grid->entries + i, grid->entries + i + 1, (grid->nr - i - 1) * sizeof(*grid->entries));
+				grid->nr--;
+				return;
+			}
+		}
+	}
+	free_grid(ds_table);
+}
+
+/* Call fn for all sites in the cells that intersect the given box. The box
+ * may wrap around the antimeridian (west > east). */
+static void for_each_grid_entry_in_box(struct dive_site_grid *grid, int south, int west, int north, int east,
+				       void (*fn)(struct dive_site *ds, void *data), void *data)
+{
+	int row0 = floor_div(clamp_lat(south), GRID_CELL_UDEG);
+	int row1 = floor_div(clamp_lat(north), GRID_CELL_UDEG);
+	int col0 = floor_div(normalize_lon(west), GRID_CELL_UDEG);
+	int col1 = floor_div(normalize_lon(east), GRID_CELL_UDEG);
+	int col_max = floor_div(180000000 - 1, GRID_CELL_UDEG);
+	int col_min = floor_div(-180000000, GRID_CELL_UDEG);
+
+	for (int row = row0; row <= row1; row++) {
+		/* either one range of columns, or two if the box wraps around */
+		for (int part = 0; part < 2; part++) {
+			int from, to, i;
+			if (col0 <= col1) {
+				if (part)
+					break;
+				from = col0;
+				to = col1;
+			} else {
+				from = part ? col_min : col0;
+				to = part ? col1 : col_max;
+			}
+			for (i = grid_lower_bound(grid, row, from); i < grid->nr; i++) {
+				const struct grid_entry *e = grid->entries + i;
+				if (e->row != row || e->col > to)
+					break;
+				fn(e->ds, data);
+			}
+		}
+	}
+}
+
+/* Call fn for all sites in the cells that may contain sites no more than
+ * distance meters away from loc. */
+static void for_each_grid_entry_near(struct dive_site_grid *grid, const location_t *loc, unsigned int distance,
+				     void (*fn)(struct dive_site *ds, void *data), void *data)
+{
+	/* angular radius of the circle, plus a cell of margin */
+	double dlat = distance / METERS_PER_DEGREE * 1000000.0 + GRID_CELL_UDEG;
+	double lat = clamp_lat(loc->lat.udeg);
+	double south = lat - dlat, north = lat + dlat;
+	double r = distance / 6371000.0, dlon;
+
+	if (south <= -90000000.0 || north >= 90000000.0 || r >= M_PI_2) {
+		/* a pole is within reach: all longitudes */
+		for_each_grid_entry_in_box(grid, lrint(south > -90000000.0 ? south : -90000000.0), -180000000,
+					   lrint(north < 90000000.0 ? north : 90000000.0), 180000000 - 1, fn, data);
+		return;
+	}
+	/* widest longitude offset of the circle, see "Finding Points Within a
+	 * Distance of a Latitude/Longitude Using Bounding Coordinates" by Jan Matuschek */
+	dlon = asin(sin(r) / cos(udeg_to_radians(lrint(lat)))) * 180.0 / M_PI * 1000000.0 + GRID_CELL_UDEG;
+	if (dlon >= 180000000.0) {
+		for_each_grid_entry_in_box(grid, lrint(south), -180000000, lrint(north), 180000000 - 1, fn, data);
+		return;
+	}
+	for_each_grid_entry_in_box(grid, lrint(south), lrint(loc->lon.udeg - dlon),
+				   lrint(north), lrint(loc->lon.udeg + dlon), fn, data);
+}
+
+struct same_location_data {
+	const location_t *loc;
+	const char *name;
+	bool check_name;
+	const struct dive_site *site;
+	struct dive_site *res;
+};
+
+static void check_same_location(struct dive_site *ds, void *_data)
+{
+	struct same_location_data *data = _data;
+	if (!same_location(data->loc, &ds->location))
+		return;
+	if (data->check_name && !same_string(ds->name, data->name))
+		return;
+	if (!data->res || ds->uuid < data->res->uuid)
+		data->res = ds;
+}
+
+static struct dive_site *find_same_location(const location_t *loc, const char *name, bool check_name, struct dive_site_table *ds_table)
+{
+	struct dive_site_grid *grid = get_grid(ds_table);
+	struct same_location_data data = { loc, name, check_name, NULL, NULL };
+	for_each_grid_entry_in_box(grid, loc->lat.udeg, loc->lon.udeg, loc->lat.udeg, loc->lon.udeg, check_same_location, &data);
+	return data.res;
+}
+
 /* there could be multiple sites of the same name - return the first one */
 struct dive_site *get_dive_site_by_name(const char *name, struct dive_site_table *ds_table)
 {
@@ -51,13 +326,7 @@ struct dive_site *get_dive_site_by_name(const char *name, struct dive_site_table
 /* there could be multiple sites at the same GPS fix - return the first one */
 struct dive_site *get_dive_site_by_gps(const location_t *loc, struct dive_site_table *ds_table)
 {
-	int i;
-	struct dive_site *ds;
-	for_each_dive_site (i, ds, ds_table) {
-		if (same_location(loc, &ds->location))
-			return ds;
-	}
-	return NULL;
+	return find_same_location(loc, NULL, false, ds_table);
 }
 
 /* to avoid a bug where we have two dive sites with different name and the same GPS coordinates
@@ -65,13 +334,7 @@ struct dive_site *get_dive_site_by_gps(const location_t *loc, struct dive_site_t
  * this function allows us to verify if a very specific name/GPS combination already exists */
 struct dive_site *get_dive_site_by_gps_and_name(char *name, const location_t *loc, struct dive_site_table *ds_table)
 {
-	int i;
-	struct dive_site *ds;
-	for_each_dive_site (i, ds, ds_table) {
-		if (same_location(loc, &ds->location) && same_string(ds->name, name))
-			return ds;
-	}
-	return NULL;
+	return find_same_location(loc, name, true, ds_table);
 }
 
 // Calculate the distance in meters between two coordinates.
@@ -92,20 +355,91 @@ unsigned int get_distance(const location_t *loc1, const location_t *loc2)
 	return lrint(6371000 * c);
 }
 
+struct proximity_data {
+	const location_t *loc;
+	unsigned int min_distance;
+	struct dive_site *res;
+};
+
+static void check_proximity(struct dive_site *ds, void *_data)
+{
+	struct proximity_data *data = _data;
+	unsigned int cur_distance;
+
+	if (!dive_site_has_gps_location(ds))
+		return;
+	cur_distance = get_distance(&ds->location, data->loc);
+	if (cur_distance < data->min_distance ||
+	    (data->res && cur_distance == data->min_distance && ds->uuid < data->res->uuid)) {
+		data->min_distance = cur_distance;
+		data->res = ds;
+	}
+}
+
 /* find the closest one, no more than distance meters away - if more than one at same distance, pick the first */
 struct dive_site *get_dive_site_by_gps_proximity(const location_t *loc, int distance, struct dive_site_table *ds_table)
 {
-	int i;
-	struct dive_site *ds, *res = NULL;
-	unsigned int cur_distance, min_distance = distance;
-	for_each_dive_site (i, ds, ds_table) {
-		if (dive_site_has_gps_location(ds) &&
-		    (cur_distance = get_distance(&ds->location, loc)) < min_distance) {
-			min_distance = cur_distance;
-			res = ds;
-		}
+	struct dive_site_grid *grid = get_grid(ds_table);
+	struct proximity_data data = { loc, distance, NULL };
+	unsigned int radius = GRID_CELL_UDEG / 1000000.0 * METERS_PER_DEGREE;
+
+	/* Search in growing circles: once a site was found within the current
+	 * radius, no site outside of the circle can be closer. */
+	while (radius < data.min_distance) {
+		for_each_grid_entry_near(grid, loc, radius, check_proximity, &data);
+		if (data.res && data.min_distance < radius)
+			return data.res;
+		radius = radius < data.min_distance / 4 ? radius * 4 : data.min_distance;
 	}
-	return res;
+	for_each_grid_entry_near(grid, loc, data.min_distance, check_proximity, &data);
+	return data.res;
+}
+
+struct site_fn_data {
+	const location_t *loc;
+	unsigned int distance;
+	dive_site_fn fn;
+	void *data;
+};
+
+static void check_radius(struct dive_site *ds, void *_data)
+{
+	struct site_fn_data *data = _data;
+	if (dive_site_has_gps_location(ds) && get_distance(&ds->location, data->loc) < data->distance)
+		data->fn(ds, data->data);
+}
+
+/* call fn for all sites with a location less than distance meters away from loc */
+void for_each_dive_site_in_radius(const location_t *loc, int distance, struct dive_site_table *ds_table, dive_site_fn fn, void *data)
+{
+	struct site_fn_data fn_data = { loc, distance, fn, data };
+	for_each_grid_entry_near(get_grid(ds_table), loc, distance, check_radius, &fn_data);
+}
+
+static void check_box(struct dive_site *ds, void *_data)
+{
+	struct site_fn_data *data = _data;
+	const location_t *sw = data->loc, *ne = data->loc + 1;
+	int lon = normalize_lon(ds->location.lon.udeg);
+	int west = normalize_lon(sw->lon.udeg), east = normalize_lon(ne->lon.udeg);
+
+	if (!dive_site_has_gps_location(ds))
+		return;
+	if (ds->location.lat.udeg < sw->lat.udeg || ds->location.lat.udeg > ne->lat.udeg)
+		return;
+	if (west <= east ? lon < west || lon > east : lon < west && lon > east)
+		return;
+	data->fn(ds, data->data);
+}
+
+/* call fn for all sites with a location in the box given by its south-west and
+ * north-east corners. If the west longitude is greater than the east one, the
+ * box wraps around the antimeridian. */
+void for_each_dive_site_in_box(const location_t *sw, const location_t *ne, struct dive_site_table *ds_table, dive_site_fn fn, void *data)
+{
+	location_t corners[2] = { *sw, *ne };
+	struct site_fn_data fn_data = { corners, 0, fn, data };
+	for_each_grid_entry_in_box(get_grid(ds_table), sw->lat.udeg, sw->lon.udeg, ne->lat.udeg, ne->lon.udeg, check_box, &fn_data);
 }
 
 int register_dive_site(struct dive_site *ds)
@@ -129,9 +463,37 @@ static MAKE_ADD_TO(dive_site_table, struct dive_site *, dive_sites)
 static MAKE_REMOVE_FROM(dive_site_table, dive_sites)
 static MAKE_GET_IDX(dive_site_table, struct dive_site *, dive_sites)
 MAKE_SORT(dive_site_table, struct dive_site *, dive_sites, compare_sites)
-static MAKE_REMOVE(dive_site_table, struct dive_site *, dive_site)
-MAKE_CLEAR_TABLE(dive_site_table, dive_sites, dive_site)
-MAKE_MOVE_TABLE(dive_site_table, dive_sites)
+
+/* The remove, clear and move functions also have to care about the grid,
+ * therefore they are not generated by the table.h macros. */
+static int remove_dive_site(struct dive_site *ds, struct dive_site_table *ds_table)
+{
+	int idx = get_idx_in_dive_site_table(ds_table, ds);
+	if (idx >= 0) {
+		grid_remove(ds_table, ds);
+		remove_from_dive_site_table(ds_table, idx);
+	}
+	return idx;
+}
+
+void clear_dive_site_table(struct dive_site_table *ds_table)
+{
+	for (int i = 0; i < ds_table->nr; i++)
+		free_dive_site(ds_table->dive_sites[i]);
+	ds_table->nr = 0;
+	free_grid(ds_table);
+}
+
+/* Move data of one table to the other - source table is empty after call. */
+void move_dive_site_table(struct dive_site_table *src, struct dive_site_table *dst)
+{
+	clear_dive_site_table(dst);
+	free(dst->dive_sites);
+	*dst = *src;
+	src->nr = src->allocated = 0;
+	src->dive_sites = NULL;
+	src->grid = NULL;
+}
 
 int add_dive_site_to_table(struct dive_site *ds, struct dive_site_table *ds_table)
 {
@@ -159,6 +521,7 @@ int add_dive_site_to_table(struct dive_site *ds, struct dive_site_table *ds_tabl
 
 	int idx = dive_site_table_get_insertion_index(ds_table, ds);
 	add_to_dive_site_table(ds_table, idx, ds);
+	grid_add(ds_table, ds);
 	return idx;
 }
 
@@ -276,6 +639,7 @@ void copy_dive_site(struct dive_site *orig, struct dive_site *copy)
 	free(copy->description);
 
 	copy->location = orig->location;
+	invalidate_dive_site_grids();
 	copy->name = copy_string(orig->name);
 	copy->notes = copy_string(orig->notes);
 	copy->description = copy_string(orig->description);
@@ -315,19 +679,28 @@ static bool same_dive_site(const struct dive_site *a, const struct dive_site *b)
 	    && same_string(a->notes, b->notes);
 }
 
+static void check_same_dive_site(struct dive_site *ds, void *_data)
+{
+	struct same_location_data *data = _data;
+	if (same_dive_site(ds, data->site) && (!data->res || ds->uuid < data->res->uuid))
+		data->res = ds;
+}
+
 struct dive_site *get_same_dive_site(const struct dive_site *site)
 {
-	int i;
-	struct dive_site *ds;
-	for_each_dive_site (i, ds, &dive_site_table)
-		if (same_dive_site(ds, site))
-			return ds;
-	return NULL;
+	struct dive_site_grid *grid = get_grid(&dive_site_table);
+	const location_t *loc = &site->location;
+	struct same_location_data data = { loc, NULL, false, site, NULL };
+	for_each_grid_entry_in_box(grid, loc->lat.udeg, loc->lon.udeg, loc->lat.udeg, loc->lon.udeg, check_same_dive_site, &data);
+	return data.res;
 }
 
 void merge_dive_site(struct dive_site *a, struct dive_site *b)
 {
-	if (!has_location(&a->location)) a->location = b->location;
+	if (!has_location(&a->location)) {
+		a->location = b->location;
+		invalidate_dive_site_grids();
+	}
 	merge_string(&a->name, &b->name);
 	merge_string(&a->notes, &b->notes);
 	merge_string(&a->description, &b->description);
@@ -26,12 +26,15 @@ struct dive_site
 	struct taxonomy_data taxonomy;
 };
 
+struct dive_site_grid;
+
 typedef struct dive_site_table {
 	int nr, allocated;
 	struct dive_site **dive_sites;
+	struct dive_site_grid *grid;	/* spatial index, built on the first location query */
 } dive_site_table_t;
 
-static const dive_site_table_t empty_dive_site_table = { 0, 0, (struct dive_site **)0 };
+static const dive_site_table_t empty_dive_site_table = { 0, 0, (struct dive_site **)0, (struct dive_site_grid *)0 };
 
 extern struct dive_site_table dive_site_table;
 
@@ -66,6 +69,10 @@ struct dive_site *get_dive_site_by_name(const char *name, struct dive_site_table
 struct dive_site *get_dive_site_by_gps(const location_t *, struct dive_site_table *ds_table);
 struct dive_site *get_dive_site_by_gps_and_name(char *name, const location_t *, struct dive_site_table *ds_table);
 struct dive_site *get_dive_site_by_gps_proximity(const location_t *, int distance, struct dive_site_table *ds_table);
+typedef void (*dive_site_fn)(struct dive_site *ds, void *data);
+void for_each_dive_site_in_radius(const location_t *, int distance, struct dive_site_table *ds_table, dive_site_fn fn, void *data);
+void for_each_dive_site_in_box(const location_t *sw, const location_t *ne, struct dive_site_table *ds_table, dive_site_fn fn, void *data);
+void invalidate_dive_site_grids(); /* call after changing the location of a site in a table */
 struct dive_site *get_same_dive_site(const struct dive_site *);
 bool dive_site_is_empty(struct dive_site *ds);
 void copy_dive_site_taxonomy(struct dive_site *orig, struct dive_site *copy);
@@ -4,8 +4,11 @@
 #pragma clang diagnostic ignored "-Wmissing-field-initializers"
 #endif
 #include <stdarg.h>
+#include <stdbool.h>
+#include <stdlib.h>
 #include "errorhelper.h"
 #include "membuffer.h"
+#include "qthelper.h"
 
 #define VA_BUF(b, fmt) do { va_list args; va_start(args, fmt); put_vformat(b, fmt, args); va_end(args); } while (0)
 
@@ -13,20 +16,81 @@ int verbose;
 
 static void (*error_cb)(char *) = NULL;
 
+/* Errors reported between hold_errors() and release_errors(), protected by lock_errors() */
+static bool errors_held = false;
+static int nr_held_errors, allocated_held_errors;
+static char **held_errors;
+
+static bool hold_error(char *err)
+{
+	bool held;
+
+	lock_errors();
+	held = errors_held;
+	if (held) {
+		if (nr_held_errors >= allocated_held_errors) {
+			allocated_held_errors = (nr_held_errors + 8) * 3 / 2;
+			held_errors = realloc(held_errors, allocated_held_errors * sizeof(*held_errors));
+			if (!held_errors)
+				exit(1);
+		}
+		held_errors[nr_held_errors++] = err;
+	}
+	unlock_errors();
+	return held;
+}
+
 int report_error(const char *fmt, ...)
 {
 	struct membuffer buf = { 0 };
+	char *err;
 
 	/* if there is no error callback registered, don't produce errors */
 	if (!error_cb)
 		return -1;
 
 	VA_BUF(&buf, fmt);
-	error_cb(detach_cstring(&buf));
+	err = detach_cstring(&buf);
+	if (!hold_error(err))
+		error_cb(err);
 
 	return -1;
 }
 
+/*
+ * The error callbacks must only be called from the main thread.
+ * Code that runs on worker threads holds the errors and releases
+ * them when the workers are finished.
+ */
+void hold_errors(void)
+{
+	lock_errors();
+	errors_held = true;
+	unlock_errors();
+}
+
+void release_errors(void)
+{
+	char **errors;
+	int nr;
+
+	lock_errors();
+	errors_held = false;
+	errors = held_errors;
+	nr = nr_held_errors;
+	held_errors = NULL;
+	nr_held_errors = allocated_held_errors = 0;
+	unlock_errors();
+
+	for (int i = 0; i < nr; i++) {
+		if (error_cb)
+			error_cb(errors[i]);
+		else
+			free(errors[i]);
+	}
+	free(errors);
+}
+
 void set_error_cb(void(*cb)(char *))
 {
 	error_cb = cb;
@@ -11,6 +11,8 @@ extern "C" {
 extern int verbose;
 extern int report_error(const char *fmt, ...);
 extern void set_error_cb(void(*cb)(char *));	// Callback takes ownership of passed string
+extern void hold_errors(void);			// Collect errors instead of reporting them, e.g. while running on worker threads
+extern void release_errors(void);		// Report the collected errors on the calling thread
 
 #ifdef __cplusplus
 }
@@ -9,6 +9,9 @@
 #include "gettext.h"
 #include <zip.h>
 #include <time.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 
 #include "dive.h"
 #include "subsurface-string.h"
@@ -38,6 +41,7 @@ int readfile(const char *filename, struct memblock *mem)
 
 	mem->buffer = NULL;
 	mem->size = 0;
+	mem->mapped = false;
 
 	fd = subsurface_open(filename, O_RDONLY | O_BINARY, 0);
 	if (fd < 0)
@@ -75,6 +79,62 @@ out:
 	return ret;
 }
 
+/*
+ * Like readfile(), but map the file instead of copying it, so that the
+ * parsers work on the page cache directly. The parsers rely on a NUL byte
+ * after the data: mmap() fills the rest of the last page with zeroes, so
+ * we only map files whose size isn't a multiple of the page size. These,
+ * pipes and anything that can't be mapped fall back to readfile(). The
+ * mapping is private and writable, so the buffer can be modified in place,
+ * but not reallocated. Release with free_memblock().
+ */
+int mapfile(const char *filename, struct memblock *mem)
+{
+#ifndef _WIN32
+	int fd;
+	struct stat st;
+	long pagesize = sysconf(_SC_PAGESIZE);
+	void *buf;
+
+	mem->buffer = NULL;
+	mem->size = 0;
+	mem->mapped = false;
+
+	fd = subsurface_open(filename, O_RDONLY | O_BINARY, 0);
+	if (fd < 0)
+		return fd;
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || !st.st_size ||
+	    pagesize <= 0 || st.st_size % pagesize == 0) {
+		close(fd);
+		return readfile(filename, mem);
+	}
+	buf = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (buf == MAP_FAILED)
+		return readfile(filename, mem);
+	madvise(buf, st.st_size, MADV_SEQUENTIAL);
+	mem->buffer = buf;
+	mem->size = st.st_size;
+	mem->mapped = true;
+	return (int)mem->size; // as in readfile(), the size will never be that big
+#else
+	return readfile(filename, mem);
+#endif
+}
+
+void free_memblock(struct memblock *mem)
+{
+#ifndef _WIN32
+	if (mem->mapped)
+		munmap(mem->buffer, mem->size);
+	else
+#endif
+		free(mem->buffer);
+	mem->buffer = NULL;
+	mem->size = 0;
+	mem->mapped = false;
+}
+
 
 static void zip_read(struct zip_file *file, const char *filename, struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites)
 {
@@ -311,7 +371,7 @@ int parse_file(const char *filename, struct dive_table *table, struct trip_table
 	if (git)
 		return git_load_dives(git, branch, table, trips, sites);
 
-	if ((ret = readfile(filename, &mem)) < 0) {
+	if ((ret = mapfile(filename, &mem)) < 0) {
 		/* we don't want to display an error if this was the default file  */
 		if (same_string(filename, prefs.default_filename))
 			return 0;
@@ -324,7 +384,7 @@ int parse_file(const char *filename, struct dive_table *table, struct trip_table
 	fmt = strrchr(filename, '.');
 	if (fmt && (!strcasecmp(fmt + 1, "DB") || !strcasecmp(fmt + 1, "BAK") || !strcasecmp(fmt + 1, "SQL"))) {
 		if (!try_to_open_db(filename, &mem, table, trips, sites)) {
-			free(mem.buffer);
+			free_memblock(&mem);
 			return 0;
 		}
 	}
@@ -332,25 +392,25 @@ int parse_file(const char *filename, struct dive_table *table, struct trip_table
 	/* Divesoft Freedom */
 	if (fmt && (!strcasecmp(fmt + 1, "DLF"))) {
 		ret = parse_dlf_buffer(mem.buffer, mem.size, table, trips, sites);
-		free(mem.buffer);
+		free_memblock(&mem);
 		return ret;
 	}
 
 	/* DataTrak/Wlog */
 	if (fmt && !strcasecmp(fmt + 1, "LOG")) {
 		ret = datatrak_import(&mem, table, trips, sites);
-		free(mem.buffer);
+		free_memblock(&mem);
 		return ret;
 	}
 
 	/* OSTCtools */
 	if (fmt && (!strcasecmp(fmt + 1, "DIVE"))) {
-		free(mem.buffer);
+		free_memblock(&mem);
 		ostctools_import(filename, table, trips, sites);
 		return 0;
 	}
 
 	ret = parse_file_buffer(filename, &mem, table, trips, sites);
-	free(mem.buffer);
+	free_memblock(&mem);
 	return ret;
 }
@@ -4,10 +4,12 @@
 
 #include <sys/stat.h>
 #include <stdio.h>
+#include <stdbool.h>
 
 struct memblock {
 	void *buffer;
 	size_t size;
+	bool mapped;	/* set by mapfile() - use free_memblock() */
 };
 
 struct trip_table;
@@ -24,6 +26,8 @@ extern int datatrak_import(struct memblock *mem, struct dive_table *table, struc
 extern void ostctools_import(const char *file, struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites);
 
 extern int readfile(const char *filename, struct memblock *mem);
+extern int mapfile(const char *filename, struct memblock *mem);
+extern void free_memblock(struct memblock *mem);
 extern int parse_file(const char *filename, struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites);
 extern int try_to_open_zip(const char *filename, struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites);
 
@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "filtercache.h"
+#include "dive.h"
+#include "divelist.h"
+
+uint8_t FilterCache::bit(Criterion criterion)
+{
+	return 1 << criterion;
+}
+
+void FilterCache::clear()
+{
+	entries.clear();
+}
+
+void FilterCache::sync()
+{
+	int i;
+	struct dive *d;
+
+	entries.resize(dive_table.nr, { 0, 0, 0 });
+	for_each_dive(i, d) {
+		// Dives might have been added or removed, so the entry might belong to a different dive
+		if (entries[i].id != d->id)
+			entries[i] = { d->id, 0, 0 };
+	}
+}
+
+void FilterCache::invalidate(uint8_t criteria)
+{
+	for (Entry &e: entries)
+		e.valid &= ~criteria;
+}
+
+FilterCache::Entry *FilterCache::entry(int idx)
+{
+	return idx >= 0 && idx < (int)entries.size() ? &entries[idx] : nullptr;
+}
+
+FilterCache::Entry *FilterCache::reset(const struct dive *d)
+{
+	Entry *e = entry(get_divenr(d));
+	if (e)
+		*e = { d->id, 0, 0 };
+	return e;
+}
+
+bool FilterCache::lookup(const Entry *e, Criterion criterion, bool &res)
+{
+	if (!e || !(e->valid & bit(criterion)))
+		return false;
+	res = e->match & bit(criterion);
+	return true;
+}
+
+void FilterCache::store(Entry *e, Criterion criterion, bool res)
+{
+	// The location depends on the trip and the dive site. Those are edited
+	// without the filter of their dives being updated, so it is never cached.
+	if (!e || criterion == LOCATION)
+		return;
+	e->valid |= bit(criterion);
+	if (res)
+		e->match |= bit(criterion);
+	else
+		e->match &= ~bit(criterion);
+}
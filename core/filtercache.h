@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: GPL-2.0
+// A per-dive cache of the results of the string criteria of the dive filter
+// (tags, people, suit and notes), so that changing one criterion, for example
+// dragging a range slider, doesn't recompute all the others. The entries are
+// indexed by the position of the dive in the dive table and remember the id of
+// the dive they belong to.
+#ifndef FILTERCACHE_H
+#define FILTERCACHE_H
+
+#include <cstdint>
+#include <vector>
+
+struct dive;
+
+class FilterCache {
+public:
+	enum Criterion {
+		TAGS,
+		PEOPLE,
+		LOCATION,
+		SUIT,
+		NOTES
+	};
+
+	struct Entry {
+		int id;		// id of the dive this entry belongs to
+		uint8_t valid;	// bit field of the criteria that were computed
+		uint8_t match;	// bit field of the criteria that matched
+	};
+
+	static uint8_t bit(Criterion criterion);
+
+	void clear();				// Forget all results
+	void sync();				// Adapt to the dive table. Entries that belong to a different dive are reset.
+	void invalidate(uint8_t criteria);	// Forget the results of the given criteria of all dives
+	Entry *entry(int idx);			// Entry of the dive at the given index. Call sync() first.
+	Entry *reset(const struct dive *d);	// Forget the results of a dive, returns nullptr if not in the table
+
+	// Returns false if the result isn't cached. Entry may be null.
+	static bool lookup(const Entry *e, Criterion criterion, bool &res);
+	static void store(Entry *e, Criterion criterion, bool res);
+private:
+	std::vector<Entry> entries;
+};
+
+#endif
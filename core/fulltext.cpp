@@ -7,7 +7,9 @@
 #include "trip.h"
 #include "qthelper.h"
 #include <QLocale>
+#include <algorithm>
 #include <map>
+#include <unordered_map>
 
 // This class caches each dives words, so that we can unregister a dive from the full text search
 struct full_text_cache {
@@ -16,7 +18,12 @@ struct full_text_cache {
 
 // The FullText-search class
 class FullText {
-	std::map<QString, std::vector<dive *>> words; // Dives that belong to each word
+	typedef std::map<QString, std::vector<dive *>> WordMap;
+	WordMap words; // Dives that belong to each word, sorted by address
+	// To find words that contain a substring without looking at all words, we
+	// keep an index from each trigram (three consecutive characters) to the words
+	// containing it. The map entries are stable, so we can store pointers to them.
+	std::unordered_map<uint64_t, std::vector<const WordMap::value_type *>> trigrams;
 public:
 
 	void populate(); // Rebuild from current dive_table
@@ -27,6 +34,8 @@ public:
 private:
 	void registerWords(struct dive *d, const std::vector<QString> &w);
 	void unregisterWords(struct dive *d, const std::vector<QString> &w);
+	void addTrigrams(const WordMap::value_type &entry);
+	void removeTrigrams(const WordMap::value_type &entry);
 	std::vector<dive *> findDives(const QString &s, StringFilterMode mode) const; // Find dives matching a given word.
 };
 
@@ -144,15 +153,46 @@ static std::vector<QString> getWords(const dive *d)
 	return res;
 }
 
+// The trigrams of a word, identified by the three UTF-16 code units packed into an integer.
+static uint64_t trigram(const QString &s, int pos)
+{
+	return ((uint64_t)s[pos].unicode() << 32) | ((uint64_t)s[pos + 1].unicode() << 16) | (uint64_t)s[pos + 2].unicode();
+}
+
+static std::vector<uint64_t> getTrigrams(const QString &s)
+{
+	std::vector<uint64_t> res;
+	for (int pos = 0; pos + 3 <= s.size(); ++pos)
+		res.push_back(trigram(s, pos));
+	std::sort(res.begin(), res.end());
+	res.erase(std::unique(res.begin(), res.end()), res.end());
+	return res;
+}
+
 void FullText::populate()
 {
 	// we want this to be two calls as the second text is overwritten below by the lines starting with "\r"
 	uiNotification(QObject::tr("Create full text index"));
 	uiNotification(QObject::tr("start processing"));
+
+	// Tokenizing is the expensive part and only reads the dives, so do it
+	// on the global thread pool. The index itself is filled in one go afterwards.
+	std::vector<std::vector<QString>> diveWords(dive_table.nr);
+	run_in_parallel(dive_table.nr, [](int idx, void *data) {
+		(*static_cast<std::vector<std::vector<QString>> *>(data))[idx] = getWords(get_dive(idx));
+	}, &diveWords);
+
 	int i;
 	dive *d;
-	for_each_dive(i, d)
-		registerDive(d);
+	for_each_dive(i, d) {
+		if (d->full_text) {
+			unregisterWords(d, d->full_text->words);
+		} else {
+			d->full_text = new full_text_cache;
+		}
+		d->full_text->words = std::move(diveWords[i]);
+		registerWords(d, d->full_text->words);
+	}
 	uiNotification(QObject::tr("%1 dives processed").arg(dive_table.nr));
 }
 
@@ -185,15 +225,22 @@ void FullText::unregisterAll()
 		d->full_text = nullptr;
 	}
 	words.clear();
+	trigrams.clear();
 }
 
 // Register words of a dive.
 void FullText::registerWords(struct dive *d, const std::vector<QString> &w)
 {
 	for (const QString &word: w) {
-		std::vector<dive *> &entry = words[word];
-		if (std::find(entry.begin(), entry.end(), d) == entry.end())
-			entry.push_back(d);
+		auto it = words.find(word);
+		if (it == words.end()) {
+			it = words.emplace(word, std::vector<dive *>()).first;
+			addTrigrams(*it);
+		}
+		std::vector<dive *> &entry = it->second;
+		auto pos = std::lower_bound(entry.begin(), entry.end(), d);
+		if (pos == entry.end() || *pos != d)
+			entry.insert(pos, d);
 	}
 }
 
@@ -207,21 +254,53 @@ void FullText::unregisterWords(struct dive *d, const std::vector<QString> &w)
 			continue;
 		}
 		std::vector<dive *> &entry = it->second;
-		entry.erase(std::remove(entry.begin(), entry.end(), d));
-		if (entry.empty())
+		auto pos = std::lower_bound(entry.begin(), entry.end(), d);
+		if (pos != entry.end() && *pos == d)
+			entry.erase(pos);
+		if (entry.empty()) {
+			removeTrigrams(*it);
 			words.erase(it);
+		}
 	}
 }
 
-// Add dives from second array to first, if not yet there
-void combineDives(std::vector<dive *> &to, const std::vector<dive *> &from)
+void FullText::addTrigrams(const WordMap::value_type &entry)
 {
-	for (dive *d: from) {
-		if (std::find(to.begin(), to.end(), d) == to.end())
-			to.push_back(d);
+	for (uint64_t t: getTrigrams(entry.first))
+		trigrams[t].push_back(&entry);
+}
+
+void FullText::removeTrigrams(const WordMap::value_type &entry)
+{
+	for (uint64_t t: getTrigrams(entry.first)) {
+		auto it = trigrams.find(t);
+		if (it == trigrams.end())
+			continue;
+		std::vector<const WordMap::value_type *> &v = it->second;
+		auto pos = std::find(v.begin(), v.end(), &entry);
+		if (pos != v.end()) {
+			// Order doesn't matter - replace by the last entry
+			*pos = v.back();
+			v.pop_back();
+		}
+		if (v.empty())
+			trigrams.erase(it);
 	}
 }
 
+// Merge a number of sorted arrays of dives into one sorted array without duplicates
+static std::vector<dive *> combineDives(const std::vector<const std::vector<dive *> *> &from)
+{
+	if (from.size() == 1)
+		return *from[0];
+	std::vector<dive *> res;
+	for (const std::vector<dive *> *v: from)
+		res.insert(res.end(), v->begin(), v->end());
+	std::sort(res.begin(), res.end());
+	res.erase(std::unique(res.begin(), res.end()), res.end());
+	return res;
+}
+
 std::vector<dive *> FullText::findDives(const QString &s, StringFilterMode mode) const
 {
 	switch (mode) {
@@ -237,25 +316,36 @@ std::vector<dive *> FullText::findDives(const QString &s, StringFilterMode mode)
 		// Find all words that start with a substring. We use the fact
 		// that these words must form a contiguous block, since the words are
 		// ordered lexicographically.
-		auto it = words.lower_bound(s);
-		if (it == words.end() || !it->first.startsWith(s))
-			return {};
-		std::vector<dive *> res = it->second;
-		++it;
-		while (it != words.end() && it->first.startsWith(s)) {
-			combineDives(res, it->second);
-			++it;
-		}
-		return res;
+		std::vector<const std::vector<dive *> *> matches;
+		for (auto it = words.lower_bound(s); it != words.end() && it->first.startsWith(s); ++it)
+			matches.push_back(&it->second);
+		return combineDives(matches);
 	}
 	case StringFilterMode::SUBSTRING: {
-		// Find all words that contain a substring. Here, we have to check all words!
-		std::vector<dive *> res;
-		for (auto it = words.begin(); it != words.end(); ++it) {
-			if (it->first.contains(s))
-				combineDives(res, it->second);
+		// Find all words that contain a substring. If the substring has at least
+		// three characters, only the words that contain its rarest trigram are
+		// candidates. For shorter substrings we have to check all words.
+		std::vector<const std::vector<dive *> *> matches;
+		if (s.size() < 3) {
+			for (auto it = words.begin(); it != words.end(); ++it) {
+				if (it->first.contains(s))
+					matches.push_back(&it->second);
+			}
+		} else {
+			const std::vector<const WordMap::value_type *> *candidates = nullptr;
+			for (uint64_t t: getTrigrams(s)) {
+				auto it = trigrams.find(t);
+				if (it == trigrams.end())
+					return {};
+				if (!candidates || it->second.size() < candidates->size())
+					candidates = &it->second;
+			}
+			for (const WordMap::value_type *entry: *candidates) {
+				if (entry->first.contains(s))
+					matches.push_back(&entry->second);
+			}
 		}
-		return res;
+		return combineDives(matches);
 	}
 	}
 }
@@ -266,11 +356,13 @@ FullTextResult FullText::find(const FullTextQuery &q, StringFilterMode mode) con
 		return FullTextResult();
 
 	std::vector<dive *> res = findDives(q.words[0], mode);
-	for (size_t i = 1; i < q.words.size(); ++i) {
+	for (size_t i = 1; i < q.words.size() && !res.empty(); ++i) {
+		// Keep only dives that are also in the result for the next word.
+		// Both arrays are sorted, so this is a linear merge.
 		std::vector<dive *> res2 = findDives(q.words[i], mode);
-		// Remove dives from res that are not in res2
-		res.erase(std::remove_if(res.begin(), res.end(),
-				[&res2] (dive *d) { return std::find(res2.begin(), res2.end(), d) == res2.end(); }), res.end());
+		std::vector<dive *> both;
+		std::set_intersection(res.begin(), res.end(), res2.begin(), res2.end(), std::back_inserter(both));
+		res = std::move(both);
 	}
 
 	return { res };
@@ -290,5 +382,5 @@ bool FullTextQuery::doit() const
 
 bool FullTextResult::dive_matches(const struct dive *d) const
 {
-	return std::find(dives.begin(), dives.end(), d) != dives.end();
+	return std::binary_search(dives.begin(), dives.end(), d);
 }
@@ -51,7 +51,7 @@ struct FullTextQuery {
 
 // Describes the result of a fulltext search
 struct FullTextResult {
-	std::vector<dive *> dives;
+	std::vector<dive *> dives; // sorted by address
 	bool dive_matches(const struct dive *d) const;
 };
 
@@ -41,6 +41,11 @@ static inline int get_he(struct gasmix mix)
 	return mix.he.permille;
 }
 
+static inline bool gasmix_is_invalid(struct gasmix mix)
+{
+	return mix.o2.permille < 0;
+}
+
 struct gas_pressures {
 	double o2, n2, he;
 };
@@ -11,19 +11,22 @@
  *                                  -> fill_missing_tank_pressures() -> fill_missing_segment_pressures()
  *                                                                   -> get_pr_interpolate_data()
  *
- *  The pr_track_t related functions below implement a linked list that is used by
- *  the majority of the functions below. The linked list covers a part of the dive profile
- *  for which there are no cylinder pressure data. Each element in the linked list
- *  represents a segment between two consecutive points on the dive profile.
- *  pr_track_t is defined in gaspressures.h
+ *  All cylinders are handled together, in one pass over the plot entries for finding
+ *  the segments and one pass for filling in the missing pressures. The pressures of
+ *  each cylinder are tracked in an array of pr_track_t structures. Each of them covers
+ *  a part of the dive profile for which there are no cylinder pressure data, i.e. a
+ *  segment between two consecutive points on the dive profile with pressure data.
  */
 
+#include <stdint.h>
+
 #include "ssrf.h"
 #include "dive.h"
 #include "display.h"
 #include "profile.h"
 #include "gaspressures.h"
 #include "pref.h"
+#include "subsurface-string.h"
 
 /*
  * simple structure to track the beginning and end tank pressure as
@@ -36,7 +39,6 @@ struct pr_track_struct {
 	int t_start;
 	int t_end;
 	int pressure_time;
-	pr_track_t *next;
 };
 
 typedef struct pr_interpolate_struct pr_interpolate_t;
@@ -49,61 +51,62 @@ struct pr_interpolate_struct {
 
 enum interpolation_strategy {SAC, TIME, CONSTANT};
 
-static pr_track_t *pr_track_alloc(int start, int t_start)
+/*
+ * The pressure tracking of one cylinder. The segments are sorted by time.
+ *
+ * The pressure-time of an entry is only stored in the plot entry once a
+ * segment covers it. The interpolation of a cylinder has always picked up
+ * the pressure-time of the entries covered by the segments of this and
+ * the previous cylinders, so we keep the running sums of exactly those.
+ */
+struct pr_cylinder {
+	bool active;
+	bool gaschange;			/* does this cylinder have gas change events? */
+	int first, last;		/* range of the entries with sensor pressure data */
+	pr_track_t *track;
+	int nr_track, allocated_track;
+	int current;			/* segment that is being tracked or -1 */
+	bool dense;
+	bool missing_pr;
+	int64_t *pressure_time;		/* sum of the pressure-times of the entries before idx */
+
+	/* State of fill_missing_tank_pressures() */
+	bool filled;
+	int segment, last_segment;
+	int cur_pr;
+	pr_interpolate_t interpolate;
+};
+
+static int pr_track_add(struct pr_cylinder *c, int start, int t_start)
 {
-	pr_track_t *pt = malloc(sizeof(pr_track_t));
+	pr_track_t *pt;
+
+	if (c->nr_track >= c->allocated_track) {
+		c->allocated_track = c->allocated_track ? c->allocated_track * 2 : 16;
+		c->track = realloc(c->track, c->allocated_track * sizeof(pr_track_t));
+	}
+	pt = c->track + c->nr_track;
 	pt->start = start;
 	pt->end = 0;
 	pt->t_start = pt->t_end = t_start;
 	pt->pressure_time = 0;
-	pt->next = NULL;
-	return pt;
-}
-
-/* poor man's linked list */
-static pr_track_t *list_last(pr_track_t *list)
-{
-	pr_track_t *tail = list;
-	if (!tail)
-		return NULL;
-	while (tail->next) {
-		tail = tail->next;
-	}
-	return tail;
-}
-
-static pr_track_t *list_add(pr_track_t *list, pr_track_t *element)
-{
-	pr_track_t *tail = list_last(list);
-	if (!tail)
-		return element;
-	tail->next = element;
-	return list;
-}
-
-static void list_free(pr_track_t *list)
-{
-	if (!list)
-		return;
-	list_free(list->next);
-	free(list);
+	return c->nr_track++;
 }
 
 #ifdef DEBUG_PR_TRACK
-static void dump_pr_track(int cyl, pr_track_t *track_pr)
+static void dump_pr_track(int cyl, const pr_track_t *track_pr, int nr)
 {
-	pr_track_t *list;
+	int i;
 
 	printf("cyl%d:\n", cyl);
-	list = track_pr;
-	while (list) {
+	for (i = 0; i < nr; i++) {
+		const pr_track_t *list = track_pr + i;
 		printf("   start %d end %d t_start %d:%02d t_end %d:%02d pt %d\n",
 		       mbar_to_PSI(list->start),
 		       mbar_to_PSI(list->end),
 		       FRACTION(list->t_start, 60),
 		       FRACTION(list->t_end, 60),
 		       list->pressure_time);
-		list = list->next;
 	}
 }
 #endif
@@ -126,24 +129,26 @@ static void dump_pr_track(int cyl, pr_track_t *track_pr)
  * segments according to how big of a time_pressure area
  * they have.
  */
-static void fill_missing_segment_pressures(pr_track_t *list, enum interpolation_strategy strategy)
+static void fill_missing_segment_pressures(pr_track_t *track, int nr, enum interpolation_strategy strategy)
 {
 	double magic;
+	int i = 0;
 
-	while (list) {
+	while (i < nr) {
+		pr_track_t *list = track + i;
 		int start = list->start, end;
-		pr_track_t *tmp = list;
+		int j = i;
 		int pt_sum = 0, pt = 0;
 
 		for (;;) {
-			pt_sum += tmp->pressure_time;
-			end = tmp->end;
+			pt_sum += track[j].pressure_time;
+			end = track[j].end;
 			if (end)
 				break;
 			end = start;
-			if (!tmp->next)
+			if (j + 1 >= nr)
 				break;
-			tmp = tmp->next;
+			j++;
 		}
 
 		if (!start)
@@ -151,32 +156,32 @@ static void fill_missing_segment_pressures(pr_track_t *list, enum interpolation_
 
 		/*
 		 * Now 'start' and 'end' contain the pressure values
-		 * for the set of segments described by 'list'..'tmp'.
+		 * for the set of segments described by i..j.
 		 * pt_sum is the sum of all the pressure-times of the
 		 * segments.
 		 *
 		 * Now dole out the pressures relative to pressure-time.
 		 */
 		list->start = start;
-		tmp->end = end;
+		track[j].end = end;
 		switch (strategy) {
 		case SAC:
 			for (;;) {
 				int pressure;
-				pt += list->pressure_time;
+				pt += track[i].pressure_time;
 				pressure = start;
 				if (pt_sum)
 					pressure -= lrint((start - end) * (double)pt / pt_sum);
-				list->end = pressure;
-				if (list == tmp)
+				track[i].end = pressure;
+				if (i == j)
 					break;
-				list = list->next;
-				list->start = pressure;
+				i++;
+				track[i].start = pressure;
 			}
 			break;
 		case TIME:
-			if (list->t_end && (tmp->t_start - tmp->t_end)) {
-				magic = (list->t_start - tmp->t_end) / (tmp->t_start - tmp->t_end);
+			if (list->t_end && (track[j].t_start - track[j].t_end)) {
+				magic = (list->t_start - track[j].t_end) / (track[j].t_start - track[j].t_end);
 				list->end = lrint(start - (start - end) * magic);
 			} else {
 				list->end = start;
@@ -187,7 +192,7 @@ static void fill_missing_segment_pressures(pr_track_t *list, enum interpolation_
 		}
 
 		/* Ok, we've done that set of segments */
-		list = list->next;
+		i++;
 	}
 }
 
@@ -199,125 +204,109 @@ void dump_pr_interpolate(int i, pr_interpolate_t interpolate_pr)
 }
 #endif
 
+/* Index of the first plot entry at or after 'time', or pi->nr if there is none */
+static int first_entry_at(const struct plot_info *pi, int time)
+{
+	int low = 0, high = pi->nr;
+
+	while (low < high) {
+		int mid = low + (high - low) / 2;
+		if (pi->entry[mid].sec < time)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return low;
+}
 
-static struct pr_interpolate_struct get_pr_interpolate_data(pr_track_t *segment, struct plot_info *pi, int cur)
+static struct pr_interpolate_struct get_pr_interpolate_data(const struct pr_cylinder *c, const pr_track_t *segment, struct plot_info *pi, int cur)
 { // cur = index to pi->entry corresponding to t_end of segment;
 	struct pr_interpolate_struct interpolate;
-	int i;
-	struct plot_data *entry;
+	int first, last;
 
 	interpolate.start = segment->start;
 	interpolate.end = segment->end;
-	interpolate.acc_pressure_time = 0;
-	interpolate.pressure_time = 0;
-
-	for (i = 0; i < pi->nr; i++) {
-		entry = pi->entry + i;
 
-		if (entry->sec < segment->t_start)
-			continue;
-		interpolate.pressure_time += entry->pressure_time;
-		if (entry->sec >= segment->t_end)
-			break;
-		if (i <= cur)
-			interpolate.acc_pressure_time += entry->pressure_time;
-	}
+	/* The entries from t_start up to and including the first one at t_end */
+	first = first_entry_at(pi, segment->t_start);
+	last = first_entry_at(pi, segment->t_end);
+	interpolate.pressure_time = (int)(c->pressure_time[MIN(last + 1, pi->nr)] - c->pressure_time[first]);
+	last = MIN(last - 1, cur);
+	interpolate.acc_pressure_time = last >= first ? (int)(c->pressure_time[last + 1] - c->pressure_time[first]) : 0;
 	return interpolate;
 }
 
-static void fill_missing_tank_pressures(struct dive *dive, struct plot_info *pi, pr_track_t *track_pr, int cyl)
+/*
+ * Transfer interpolated cylinder pressures from the pr_track_t strucktures of the
+ * cylinder to the plot entry 'i'. This is called for each entry, in order. Align them
+ * with the start & end times of each profile segment represented by a pr_track_t
+ * structure. Get the accumulated pressure_depths from the pr_track_t structures and
+ * then interpolate the pressure where these do not exist in the plot_info pressure
+ * variables. Pressure values are transferred from the pr_track_t structures
+ * to the plot_info structure, allowing us to plot the tank pressure.
+ */
+static void fill_missing_tank_pressures(struct dive *dive, struct plot_info *pi, struct pr_cylinder *c, int cyl, int i)
 {
-	int i;
-	struct plot_data *entry;
-	pr_interpolate_t interpolate = { 0, 0, 0, 0 };
-	pr_track_t *last_segment = NULL;
-	int cur_pr;
-	enum interpolation_strategy strategy;
-
-	/* no segment where this cylinder is used */
-	if (!track_pr)
-		return;
-
-	if (get_cylinder(dive, cyl)->cylinder_use == OC_GAS)
-		strategy = SAC;
-	else
-		strategy = TIME;
-	fill_missing_segment_pressures(track_pr, strategy); // Interpolate the missing tank pressure values ..
-	cur_pr = track_pr->start;			       // in the pr_track_t lists of structures
-							       // and keep the starting pressure for each cylinder.
-#ifdef DEBUG_PR_TRACK
-	dump_pr_track(cyl, track_pr);
-#endif
-
-	/* Transfer interpolated cylinder pressures from pr_track strucktures to plotdata
-	 * Go down the list of tank pressures in plot_info. Align them with the start &
-	 * end times of each profile segment represented by a pr_track_t structure. Get
-	 * the accumulated pressure_depths from the pr_track_t structures and then
-	 * interpolate the pressure where these do not exist in the plot_info pressure
-	 * variables. Pressure values are transferred from the pr_track_t structures
-	 * to the plot_info structure, allowing us to plot the tank pressure.
-	 *
-	 * The first two pi structures are "fillers", but in case we don't have a sample
-	 * at time 0 we need to process the second of them here, therefore i=1 */
-	for (i = 1; i < pi->nr; i++) { // For each point on the profile:
-		double magic;
-		pr_track_t *segment;
-		int pressure;
-
-		entry = pi->entry + i;
+	struct plot_data *entry = pi->entry + i;
+	pr_track_t *segment;
+	double magic;
+	int pressure;
 
-		pressure = get_plot_pressure(pi, i, cyl);
+	pressure = get_plot_pressure(pi, i, cyl);
 
-		if (pressure) {			// If there is a valid pressure value,
-			last_segment = NULL;	// get rid of interpolation data,
-			cur_pr = pressure; // set current pressure
-			continue;		// and skip to next point.
-		}
-		// If there is NO valid pressure value..
-		// Find the pressure segment corresponding to this entry..
-		segment = track_pr;
-		while (segment && segment->t_end < entry->sec) // Find the track_pr with end time..
-			segment = segment->next;	       // ..that matches the plot_info time (entry->sec)
-
-		// After last segment? All done.
-		if (!segment)
-			break;
+	if (pressure) {			// If there is a valid pressure value,
+		c->last_segment = -1;	// get rid of interpolation data,
+		c->cur_pr = pressure;	// set current pressure
+		return;			// and skip to next point.
+	}
+	// If there is NO valid pressure value..
+	// Find the pressure segment corresponding to this entry..
+	if (entry->sec < entry[-1].sec)
+		c->segment = 0;
+	while (c->segment < c->nr_track && c->track[c->segment].t_end < entry->sec) // Find the track_pr with end time..
+		c->segment++;								  // ..that matches the plot_info time (entry->sec)
+
+	// After last segment? All done.
+	if (c->segment >= c->nr_track) {
+		c->filled = true;
+		return;
+	}
+	segment = c->track + c->segment;
 
-		// Before first segment, or between segments.. Go on, no interpolation.
-		if (segment->t_start > entry->sec)
-			continue;
+	// Before first segment, or between segments.. Go on, no interpolation.
+	if (segment->t_start > entry->sec)
+		return;
 
-		if (!segment->pressure_time) {		// Empty segment?
-			set_plot_pressure_data(pi, i, SENSOR_PR, cyl, cur_pr);
-							// Just use our current pressure
-			continue;			// and skip to next point.
-		}
+	if (!segment->pressure_time) {		// Empty segment?
+		set_plot_pressure_data(pi, i, SENSOR_PR, cyl, c->cur_pr);
+						// Just use our current pressure
+		return;				// and skip to next point.
+	}
 
-		// If there is a valid segment but no tank pressure ..
-		if (segment == last_segment) {
-			interpolate.acc_pressure_time += entry->pressure_time;
-		} else {
-			// Set up an interpolation structure
-			interpolate = get_pr_interpolate_data(segment, pi, i);
-			last_segment = segment;
-		}
+	// If there is a valid segment but no tank pressure ..
+	if (c->segment == c->last_segment) {
+		c->interpolate.acc_pressure_time += (int)(c->pressure_time[i + 1] - c->pressure_time[i]);
+	} else {
+		// Set up an interpolation structure
+		c->interpolate = get_pr_interpolate_data(c, segment, pi, i);
+		c->last_segment = c->segment;
+	}
 
-		if(get_cylinder(dive, cyl)->cylinder_use == OC_GAS) {
+	if(get_cylinder(dive, cyl)->cylinder_use == OC_GAS) {
 
-			/* if this segment has pressure_time, then calculate a new interpolated pressure */
-			if (interpolate.pressure_time) {
-				/* Overall pressure change over total pressure-time for this segment*/
-				magic = (interpolate.end - interpolate.start) / (double)interpolate.pressure_time;
+		/* if this segment has pressure_time, then calculate a new interpolated pressure */
+		if (c->interpolate.pressure_time) {
+			/* Overall pressure change over total pressure-time for this segment*/
+			magic = (c->interpolate.end - c->interpolate.start) / (double)c->interpolate.pressure_time;
 
-				/* Use that overall pressure change to update the current pressure */
-				cur_pr = lrint(interpolate.start + magic * interpolate.acc_pressure_time);
-			}
-		} else {
-			magic = (interpolate.end - interpolate.start) /  (segment->t_end - segment->t_start);
-			cur_pr = lrint(segment->start + magic * (entry->sec - segment->t_start));
+			/* Use that overall pressure change to update the current pressure */
+			c->cur_pr = lrint(c->interpolate.start + magic * c->interpolate.acc_pressure_time);
 		}
-		set_plot_pressure_data(pi, i, INTERPOLATED_PR, cyl, cur_pr); // and store the interpolated data in plot_info
+	} else {
+		magic = (c->interpolate.end - c->interpolate.start) /  (segment->t_end - segment->t_start);
+		c->cur_pr = lrint(segment->start + magic * (entry->sec - segment->t_start));
 	}
+	set_plot_pressure_data(pi, i, INTERPOLATED_PR, cyl, c->cur_pr); // and store the interpolated data in plot_info
 }
 
 
@@ -353,134 +342,220 @@ static void debug_print_pressures(struct plot_info *pi)
 }
 #endif
 
+/*
+ * Track the pressure of cylinder 'sensor' at plot entry 'i'. 'cyl' is the cylinder
+ * in use at that time. Returns true if the entry is covered by a pressure track
+ * entry, i.e. its pressure-time is needed.
+ */
+static bool track_pressure(struct plot_info *pi, struct pr_cylinder *c, int sensor, int cyl, int i, int pressure_time)
+{
+	struct plot_data *entry = pi->entry + i;
+	int pressure = get_plot_sensor_pressure(pi, i, sensor);
+	bool covered = false;
+
+	if (c->current >= 0) { // add the pressure-time, taking into account the dive mode for this specific segment.
+		pr_track_t *current = c->track + c->current;
+		current->pressure_time += pressure_time;
+		current->t_end = entry->sec;
+		if (pressure)
+			current->end = pressure;
+		covered = true;
+	}
+
+	// We have a final pressure for 'current'
+	// If a gas switch has occurred, finish the
+	// current pressure track entry and continue
+	// until we get back to this cylinder.
+	if (cyl != sensor) {
+		c->current = -1;
+		set_plot_pressure_data(pi, i, SENSOR_PR, sensor, 0);
+		return covered;
+	}
+
+	// If we have no pressure information, we will need to
+	// continue with or without a tracking entry. Mark any
+	// existing tracking entry as non-dense, and remember
+	// to fill in interpolated data.
+	if (c->current >= 0 && !pressure) {
+		c->missing_pr = true;
+		c->dense = false;
+		return covered;
+	}
+
+	// If we already have a pressure tracking entry, and
+	// it has not had any missing samples, just continue
+	// using it - there's nothing to interpolate yet.
+	if (c->current >= 0 && c->dense)
+		return covered;
+
+	// We need to start a new tracking entry, either
+	// because the previous was interrupted by a gas
+	// switch event, or because the previous one has
+	// missing entries that need to be interpolated.
+	// Or maybe we didn't have a previous one at all,
+	// and this is the first pressure entry.
+	c->current = pr_track_add(c, pressure, entry->sec);
+	c->dense = true;
+	return covered;
+}
+
 /* This function goes through the list of tank pressures, of structure plot_info for the dive profile where each
  * item in the list corresponds to one point (node) of the profile. It finds values for which there are no tank
- * pressures (pressure==0). For each missing item (node) of tank pressure it creates a pr_track_alloc structure
- * that represents a segment on the dive profile and that contains tank pressures. There is a linked list of
- * pr_track_alloc structures for each cylinder. These pr_track_alloc structures ultimately allow for filling
+ * pressures (pressure==0). For each missing item (node) of tank pressure it creates a pr_track_t structure
+ * that represents a segment on the dive profile and that contains tank pressures. There is an array of
+ * pr_track_t structures for each cylinder. These pr_track_t structures ultimately allow for filling
  * the missing tank pressure values on the dive profile using the depth_pressure of the dive. To do this, it
- * calculates the summed pressure-time value for the duration of the dive and stores these * in the pr_track_alloc
+ * calculates the summed pressure-time value for the duration of the dive and stores these * in the pr_track_t
  * structures. This function is called by create_plot_info_new() in profile.c
  */
-void populate_pressure_information(struct dive *dive, struct divecomputer *dc, struct plot_info *pi, int sensor)
+void populate_pressure_information(struct dive *dive, struct divecomputer *dc, struct plot_info *pi)
 {
-	UNUSED(dc);
-	int first, last, cyl;
-	cylinder_t *cylinder = get_cylinder(dive, sensor);
-	pr_track_t *track = NULL;
-	pr_track_t *current = NULL;
+	int i, sensor, nr_cylinders = pi->nr_cylinders;
+	int gas_cyl = -1;
+	struct pr_cylinder *cylinders;
 	const struct event *ev, *b_ev;
-	int missing_pr = 0, dense = 1;
+	bool any_active = false;
 	enum divemode_t dmode = dc->divemode;
 	const double gasfactor[5] = {1.0, 0.0, prefs.pscr_ratio/1000.0, 1.0, 1.0 };
 
-	if (sensor < 0 || sensor >= dive->cylinders.nr)
+	if (nr_cylinders > dive->cylinders.nr)
+		nr_cylinders = dive->cylinders.nr;
+	if (nr_cylinders <= 0)
 		return;
-
-	/* if we have no pressure data whatsoever, this is pointless, so let's just return */
-	if (!cylinder->start.mbar && !cylinder->end.mbar &&
-	    !cylinder->sample_start.mbar && !cylinder->sample_end.mbar)
+	cylinders = calloc(nr_cylinders, sizeof(*cylinders));
+	if (!cylinders)
 		return;
 
-	/* Get a rough range of where we have any pressures at all */
-	first = last = -1;
-	for (int i = 0; i < pi->nr; i++) {
-		int pressure = get_plot_sensor_pressure(pi, i, sensor);
+	for (sensor = 0; sensor < nr_cylinders; sensor++) {
+		cylinder_t *cylinder = get_cylinder(dive, sensor);
+		struct pr_cylinder *c = cylinders + sensor;
 
-		if (!pressure)
+		c->first = c->last = -1;
+		c->current = -1;
+
+		/* if we have no pressure data whatsoever, this is pointless, so let's just skip it */
+		if (!cylinder->start.mbar && !cylinder->end.mbar &&
+		    !cylinder->sample_start.mbar && !cylinder->sample_end.mbar)
 			continue;
-		if (first < 0)
-			first = i;
-		last = i;
+		c->active = true;
+		c->gaschange = has_gaschange_event(dive, dc, sensor);
 	}
 
-	/* No sensor data at all? */
-	if (first == last)
-		return;
+	/* Get a rough range of where we have any pressures at all */
+	for (sensor = 0; sensor < nr_cylinders; sensor++) {
+		struct pr_cylinder *c = cylinders + sensor;
+
+		if (!c->active)
+			continue;
+		for (i = 0; i < pi->nr; i++) {
+			if (!get_plot_sensor_pressure(pi, i, sensor))
+				continue;
+			if (c->first < 0)
+				c->first = i;
+			c->last = i;
+		}
+
+		/* No sensor data at all? */
+		if (c->first == c->last) {
+			c->active = false;
+			continue;
+		}
+		c->pressure_time = calloc(pi->nr + 1, sizeof(*c->pressure_time));
+		if (!c->pressure_time) {
+			c->active = false;
+			continue;
+		}
+		any_active = true;
+	}
+	if (!any_active)
+		goto out;
 
 	/*
-	 * Split the range:
+	 * Split the ranges:
 	 *  - missing pressure data
 	 *  - gas change events to other cylinders
 	 *
 	 * Note that we only look at gas switches if this cylinder
 	 * itself has a gas change event.
 	 */
-	cyl = sensor;
-	ev = NULL;
-	if (has_gaschange_event(dive, dc, sensor))
-		ev = get_next_event(dc->events, "gaschange");
+	ev = get_next_event(dc->events, "gaschange");
 	b_ev = get_next_event(dc->events, "modechange");
 
-	for (int i = first; i <= last; i++) {
+	for (i = 0; i < pi->nr; i++) {
 		struct plot_data *entry = pi->entry + i;
-		int pressure = get_plot_sensor_pressure(pi, i, sensor);
 		int time = entry->sec;
+		int pressure_time = -1;
+		bool covered = false;
 
-		while (ev && ev->time.seconds <= time) {   // Find 1st gaschange event after 
-			cyl = get_cylinder_index(dive, ev); // the current gas change.
-			if (cyl < 0)
-				cyl = sensor;
+		while (ev && ev->time.seconds <= time) {   // Find 1st gaschange event after
+			gas_cyl = get_cylinder_index(dive, ev); // the current gas change.
 			ev = get_next_event(ev->next, "gaschange");
 		}
 
 		while (b_ev && b_ev->time.seconds <= time) { // Keep existing divemode, then
-			dmode = b_ev->value; // find 1st divemode change event after the current 
+			dmode = b_ev->value; // find 1st divemode change event after the current
 			b_ev = get_next_event(b_ev->next, "modechange"); // divemode change.
 		}
 
-		if (current) { // calculate pressure-time, taking into account the dive mode for this specific segment.
-			entry->pressure_time = (int)(calc_pressure_time(dive, entry - 1, entry) * gasfactor[dmode] + 0.5);
-			current->pressure_time += entry->pressure_time;
-			current->t_end = entry->sec;
-			if (pressure)
-				current->end = pressure;
-		}
-
-		// We have a final pressure for 'current'
-		// If a gas switch has occurred, finish the
-		// current pressure track entry and continue
-		// until we get back to this cylinder.
-		if (cyl != sensor) {
-			current = NULL;
-			set_plot_pressure_data(pi, i, SENSOR_PR, sensor, 0);
-			continue;
+		for (sensor = 0; sensor < nr_cylinders; sensor++) {
+			struct pr_cylinder *c = cylinders + sensor;
+			int cyl = sensor;
+
+			if (!c->active)
+				continue;
+			if (i >= c->first && i <= c->last) {
+				if (gas_cyl >= 0 && c->gaschange)
+					cyl = gas_cyl;
+				if (c->current >= 0 && pressure_time < 0)
+					pressure_time = (int)(calc_pressure_time(dive, entry - 1, entry) * gasfactor[dmode] + 0.5);
+				covered |= track_pressure(pi, c, sensor, cyl, i, pressure_time);
+			}
+			c->pressure_time[i + 1] = c->pressure_time[i] + (covered ? pressure_time : 0);
 		}
+		if (covered)
+			entry->pressure_time = pressure_time;
+	}
 
-		// If we have no pressure information, we will need to
-		// continue with or without a tracking entry. Mark any
-		// existing tracking entry as non-dense, and remember
-		// to fill in interpolated data.
-		if (current && !pressure) {
-			missing_pr = 1;
-			dense = 0;
-			continue;
-		}
+	/* Interpolate the missing tank pressure values in the pr_track_t arrays of structures
+	 * and keep the starting pressure for each cylinder. */
+	any_active = false;
+	for (sensor = 0; sensor < nr_cylinders; sensor++) {
+		struct pr_cylinder *c = cylinders + sensor;
 
-		// If we already have a pressure tracking entry, and
-		// it has not had any missing samples, just continue
-		// using it - there's nothing to interpolate yet.
-		if (current && dense)
+		if (!c->active || !c->missing_pr || !c->nr_track)
 			continue;
-
-		// We need to start a new tracking entry, either
-		// because the previous was interrupted by a gas
-		// switch event, or because the previous one has
-		// missing entries that need to be interpolated.
-		// Or maybe we didn't have a previous one at all,
-		// and this is the first pressure entry.
-		current = pr_track_alloc(pressure, entry->sec);
-		track = list_add(track, current);
-		dense = 1;
+		fill_missing_segment_pressures(c->track, c->nr_track,
+					       get_cylinder(dive, sensor)->cylinder_use == OC_GAS ? SAC : TIME);
+		c->cur_pr = c->track[0].start;
+		c->last_segment = -1;
+		any_active = true;
+#ifdef DEBUG_PR_TRACK
+		dump_pr_track(sensor, c->track, c->nr_track);
+#endif
 	}
 
-	if (missing_pr) {
-		fill_missing_tank_pressures(dive, pi, track, sensor);
+	/* The first two pi structures are "fillers", but in case we don't have a sample
+	 * at time 0 we need to process the second of them here, therefore i=1 */
+	for (i = 1; any_active && i < pi->nr; i++) { // For each point on the profile:
+		any_active = false;
+		for (sensor = 0; sensor < nr_cylinders; sensor++) {
+			struct pr_cylinder *c = cylinders + sensor;
+
+			if (!c->active || !c->missing_pr || !c->nr_track || c->filled)
+				continue;
+			fill_missing_tank_pressures(dive, pi, c, sensor, i);
+			any_active = true;
+		}
 	}
 
 #ifdef PRINT_PRESSURES_DEBUG
 	debug_print_pressures(pi);
 #endif
 
-	list_free(track);
+out:
+	for (sensor = 0; sensor < nr_cylinders; sensor++) {
+		free(cylinders[sensor].track);
+		free(cylinders[sensor].pressure_time);
+	}
+	free(cylinders);
 }
@@ -24,6 +24,7 @@ extern const char *get_sha(git_repository *repo, const char *branch);
 extern int do_git_save(git_repository *repo, const char *branch, const char *remote, bool select_only, bool create_empty);
 extern const char *saved_git_id;
 extern bool git_local_only;
+extern bool git_load_sequential;	// parse the dives on the calling thread, for testing
 extern void clear_git_id(void);
 extern void set_git_id(const struct git_oid *);
 extern enum remote_transport url_to_remote_transport(const char *remote);
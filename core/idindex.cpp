@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "idindex.h"
+
+#include <unordered_map>
+
+struct id_index {
+	std::unordered_multimap<int, void *> items;
+};
+
+extern "C" struct id_index *alloc_id_index()
+{
+	return new id_index;
+}
+
+extern "C" void free_id_index(struct id_index *index)
+{
+	delete index;
+}
+
+extern "C" void id_index_add(struct id_index *index, int id, void *item)
+{
+	index->items.emplace(id, item);
+}
+
+extern "C" void id_index_remove(struct id_index *index, int id, const void *item)
+{
+	auto range = index->items.equal_range(id);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second == item) {
+			index->items.erase(it);
+			return;
+		}
+	}
+}
+
+extern "C" void *id_index_get(const struct id_index *index, int id)
+{
+	auto it = index->items.find(id);
+	return it != index->items.end() ? it->second : nullptr;
+}
@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: GPL-2.0
+// A hash index from the unique id of dives and trips to the object. It is
+// used by the tables generated with the *_INDEXED macros of table.h, so that
+// lookups by id don't have to scan the whole table.
+
+#ifndef IDINDEX_H
+#define IDINDEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct id_index;
+
+extern struct id_index *alloc_id_index(void);
+extern void free_id_index(struct id_index *index);
+
+// Multiple objects with the same id may be added. A lookup of such an id
+// returns any of them.
+extern void id_index_add(struct id_index *index, int id, void *item);
+extern void id_index_remove(struct id_index *index, int id, const void *item);
+extern void *id_index_get(const struct id_index *index, int id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IDINDEX_H
@@ -115,7 +115,7 @@ static int parse_dan_format(const char *filename, char **params, int pnr, struct
 	char *NL = NULL;
 	char *iter = NULL;
 
-	if (readfile(filename, &mem) < 0)
+	if (mapfile(filename, &mem) < 0)
 		return report_error(translate("gettextFromC", "Failed to read '%s'"), filename);
 
 	/* Determine NL (new line) character and the start of CSV data */
@@ -276,7 +276,7 @@ static int parse_dan_format(const char *filename, char **params, int pnr, struct
 		free(mem_csv.buffer);
 	}
 
-	free(mem.buffer);
+	free_memblock(&mem);
 	for (i = 0; params[i]; i += 2)
 		free(params[i + 1]);
 
@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "keyword.h"
+
+/*
+ * The index is a power-of-two sized array of slots, containing the entry
+ * index + 1 or 0 for an empty slot. We search for a seed of the hash
+ * function that maps every keyword to its own slot, growing the array
+ * if no seed is found. For the few dozen keywords of a parser table this
+ * ends up with at most a few hundred bytes.
+ */
+#define SEEDS_PER_SIZE 64
+#define MAX_KEYWORD_LEN 255
+
+struct keyword_index {
+	unsigned int seed;
+	unsigned int mask;
+	int max_len;
+	unsigned char *len;		/* per entry */
+	unsigned char *extended;	/* per entry, see set_extended() */
+	unsigned char slot[];
+};
+
+static inline unsigned int hash_start(unsigned int seed)
+{
+	return 2166136261u ^ (seed * 0x9e3779b9u);
+}
+
+/* Cheap enough to be calculated for every character of a node name */
+static inline unsigned int hash_char(unsigned int hash, char c)
+{
+	return ((hash << 5) + hash) ^ (unsigned char)c;
+}
+
+static inline unsigned int hash_end(unsigned int hash)
+{
+	hash *= 0x9e3779b1u;
+	return hash ^ (hash >> 16);
+}
+
+static const char *get_keyword(const struct keyword_table *table, int idx)
+{
+	return *(const char * const *)((const char *)table->entries + idx * table->entry_size);
+}
+
+static unsigned int hash_keyword(const char *keyword, unsigned int seed)
+{
+	unsigned int hash = hash_start(seed);
+
+	while (*keyword)
+		hash = hash_char(hash, *keyword++);
+	return hash_end(hash);
+}
+
+/*
+ * An entry is "extended" if a keyword of higher precedence starts with the
+ * keyword of the entry followed by a dot ("max.depth" extends "max"). Only
+ * then match_keyword() has to look for longer matches after finding the entry.
+ */
+static void set_extended(const struct keyword_table *table, unsigned char *extended)
+{
+	for (int i = 0; i < table->nr; i++) {
+		const char *keyword = get_keyword(table, i);
+		int len = strlen(keyword);
+		for (int j = 0; j < i; j++) {
+			const char *other = get_keyword(table, j);
+			if (!strncmp(keyword, other, len) && other[len] == '.')
+				extended[i] = 1;
+		}
+	}
+}
+
+/*
+ * Two equal keywords can never get their own slots, so the search
+ * for a seed would grow the index forever. That's a bug in the table.
+ */
+static void check_duplicates(const struct keyword_table *table)
+{
+	for (int i = 0; i < table->nr; i++) {
+		const char *keyword = get_keyword(table, i);
+		for (int j = 0; j < i; j++) {
+			if (!strcmp(keyword, get_keyword(table, j))) {
+				fprintf(stderr, "duplicate keyword \"%s\" in keyword table\n", keyword);
+				abort();
+			}
+		}
+	}
+}
+
+static struct keyword_index *build_index(const struct keyword_table *table)
+{
+	unsigned int size = 16;
+
+	/* The slots store the index + 1 in an unsigned char */
+	if (table->nr >= 255)
+		abort();
+	check_duplicates(table);
+	while (size < 2 * (unsigned int)table->nr)
+		size *= 2;
+	for (;; size *= 2) {
+		struct keyword_index *index = calloc(1, sizeof(*index) + size + 2 * table->nr);
+		if (!index)
+			abort();
+		index->mask = size - 1;
+		index->len = index->slot + size;
+		index->extended = index->len + table->nr;
+		for (int i = 0; i < table->nr; i++) {
+			int len = strlen(get_keyword(table, i));
+			if (len > MAX_KEYWORD_LEN)
+				abort();
+			index->len[i] = len;
+			if (len > index->max_len)
+				index->max_len = len;
+		}
+		for (unsigned int seed = 0; seed < SEEDS_PER_SIZE; seed++) {
+			int i;
+
+			memset(index->slot, 0, size);
+			index->seed = seed;
+			for (i = 0; i < table->nr; i++) {
+				unsigned int slot = hash_keyword(get_keyword(table, i), seed) & index->mask;
+				if (index->slot[slot])
+					break;
+				index->slot[slot] = i + 1;
+			}
+			if (i == table->nr) {
+				set_extended(table, index->extended);
+				return index;
+			}
+		}
+		free(index);
+	}
+}
+
+/*
+ * Build the index on first use. If two threads race, both build the
+ * same index and the loser frees its copy.
+ */
+static const struct keyword_index *get_index(struct keyword_table *table)
+{
+	struct keyword_index *index = __atomic_load_n(&table->index, __ATOMIC_ACQUIRE);
+	struct keyword_index *expected = NULL;
+
+	if (index)
+		return index;
+	index = build_index(table);
+	if (!__atomic_compare_exchange_n(&table->index, &expected, index, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		free(index);
+		index = expected;
+	}
+	return index;
+}
+
+/* Index of the entry whose keyword equals keyword[0..len) if it sits in the slot of hash */
+static int check_slot(const struct keyword_table *table, const struct keyword_index *index,
+		      unsigned int hash, const char *keyword, int len)
+{
+	int idx = index->slot[hash_end(hash) & index->mask] - 1;
+
+	if (idx < 0 || index->len[idx] != len || memcmp(get_keyword(table, idx), keyword, len))
+		return -1;
+	return idx;
+}
+
+int lookup_keyword(struct keyword_table *table, const char *keyword, int len)
+{
+	const struct keyword_index *index = get_index(table);
+	unsigned int hash = hash_start(index->seed);
+
+	if (len > index->max_len)
+		return -1;
+	for (int i = 0; i < len; i++)
+		hash = hash_char(hash, keyword[i]);
+	return check_slot(table, index, hash, keyword, len);
+}
+
+int match_keyword(struct keyword_table *table, const char *name)
+{
+	const struct keyword_index *index = get_index(table);
+	unsigned int hash = hash_start(index->seed);
+	int res = -1;
+
+	/* No keyword is longer than max_len - we can stop there */
+	for (int len = 0; len <= index->max_len; len++) {
+		char c = name[len];
+		if (c == '.' || !c) {
+			int idx = check_slot(table, index, hash, name, len);
+			if (idx >= 0 && (res < 0 || idx < res)) {
+				res = idx;
+				if (!index->extended[idx])
+					break;
+			}
+			if (!c)
+				break;
+		}
+		hash = hash_char(hash, c);
+	}
+	return res;
+}
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef KEYWORD_H
+#define KEYWORD_H
+
+/*
+ * Keyword dispatch for the parsers
+ *
+ * A keyword table wraps a static array of structs whose first member
+ * is the "const char *" keyword. On first use, a perfect hash over the
+ * keywords is built, so that a lookup is one hash calculation and one
+ * string comparison, independent of the number of keywords.
+ *
+ *     static struct keyword_action dive_action[] = { { "buddy", ... }, ... };
+ *     static struct keyword_table dive_keywords = KEYWORD_TABLE(dive_action);
+ *
+ *     int idx = lookup_keyword(&dive_keywords, word, len);
+ *     if (idx >= 0)
+ *             dive_action[idx].fn(...);
+ *
+ * The tables may be used from multiple threads.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct keyword_index;
+
+struct keyword_table {
+	const void *entries;
+	int nr;
+	size_t entry_size;
+	struct keyword_index *index;	/* built on first use */
+};
+
+#define KEYWORD_TABLE(array) { array, sizeof(array) / sizeof(array[0]), sizeof(array[0]), NULL }
+
+/* Index of the entry with exactly the given keyword or -1 */
+extern int lookup_keyword(struct keyword_table *table, const char *keyword, int len);
+
+/*
+ * Index of the first entry whose keyword matches the XML node name or -1.
+ * A keyword matches if it equals the name or the part of the name before
+ * one of its dots, i.e. "o2" matches "o2" and "o2.cylinder".
+ */
+extern int match_keyword(struct keyword_table *table, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
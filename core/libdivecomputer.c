@@ -22,6 +22,7 @@
 #include "sha1.h"
 #include "subsurface-time.h"
 #include "timer.h"
+#include "stringpool.h"
 
 #include <libdivecomputer/version.h>
 #include <libdivecomputer/usbhid.h>
@@ -577,7 +578,7 @@ static void dc_match_serial(void *_dc, const char *model, uint32_t deviceid, con
  */
 static void set_dc_serial(struct divecomputer *dc, const char *serial)
 {
-	dc->serial = serial;
+	dc->serial = intern_string(serial);
 	call_for_each_dc(dc, dc_match_serial, false);
 	if (!dc->deviceid)
 		dc->deviceid = calculate_string_hash(serial);
@@ -597,7 +598,7 @@ static void parse_string_field(device_data_t *devdata, struct dive *dive, dc_fie
 		return;
 	}
 	if (!strcmp(str->desc, "FW Version")) {
-		dive->dc.fw_version = strdup(str->value);
+		dive->dc.fw_version = intern_string(str->value);
 		return;
 	}
 	/* GPS data? */
@@ -796,7 +797,7 @@ static int dive_cb(const unsigned char *data, unsigned int size,
 	dive = alloc_dive();
 
 	// Fill in basic fields
-	dive->dc.model = strdup(devdata->model);
+	dive->dc.model = intern_string(devdata->model);
 	dive->dc.diveid = calculate_diveid(fingerprint, fsize);
 
 	/* Should we add it to the cached fingerprint file? */
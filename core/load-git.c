@@ -22,12 +22,57 @@
 #include "device.h"
 #include "membuffer.h"
 #include "git-access.h"
+#include "keyword.h"
 #include "picture.h"
 #include "qthelper.h"
 #include "tag.h"
+#include "stringpool.h"
 #include "subsurface-time.h"
 
 const char *saved_git_id = NULL;
+bool git_load_sequential = false;
+
+/*
+ * Loading happens in two phases: the tree walk creates the dives, trips
+ * and sites and collects the blobs belonging to each dive. Then the
+ * dive blobs are parsed on a thread pool, one dive per job. libgit2
+ * doesn't allow concurrent lookups in a repository, therefore the
+ * blobs of a batch of dives are read into memory on the calling thread
+ * first. Errors of the workers are held and reported afterwards.
+ *
+ * Actions of the dive parser that touch global data (dive sites, tags)
+ * are deferred and run in dive order on the calling thread, when the
+ * dives are added to the dive table.
+ */
+enum dive_blob_type {
+	DIVE_BLOB,
+	DIVECOMPUTER_BLOB,
+	PICTURE_BLOB
+};
+
+struct dive_blob {
+	enum dive_blob_type type;
+	git_oid id;
+	int offset;		/* of pictures */
+	char *content;		/* NULL if the blob couldn't be read */
+	unsigned int size;
+};
+
+struct git_parser_state;
+
+struct deferred_action {
+	void (*fn)(char *, struct membuffer *, struct git_parser_state *);
+	char *line;
+	struct membuffer str;
+};
+
+struct dive_job {
+	struct dive *dive;
+	int nr_blobs, allocated_blobs;
+	struct dive_blob *blobs;
+	int nr_deferred, allocated_deferred;
+	struct deferred_action *deferred;
+};
 
 struct git_parser_state {
 	git_repository *repo;
@@ -40,13 +85,15 @@ struct git_parser_state {
 	struct trip_table *trips;
 	struct dive_site_table *sites;
 	int o2pressure_sensor;
+	int nr_jobs, allocated_jobs;
+	struct dive_job *jobs;
+	struct dive_job *active_job;	/* only set on worker threads */
 };
 
 struct keyword_action {
 	const char *keyword;
 	void (*fn)(char *, struct membuffer *, struct git_parser_state *);
 };
-#define ARRAY_SIZE(array) (sizeof(array)/sizeof(array[0]))
 
 static git_blob *git_tree_entry_blob(git_repository *repo, const git_tree_entry *entry);
 
@@ -156,12 +203,37 @@ static int get_index(const char *line)
 static int get_hex(const char *line)
 { return strtoul(line, NULL, 16); }
 
+/* On worker threads, remember the action to run it later on the calling thread */
+static bool defer_action(void (*fn)(char *, struct membuffer *, struct git_parser_state *),
+			 char *line, struct membuffer *str, struct git_parser_state *state)
+{
+	struct dive_job *job = state->active_job;
+	struct deferred_action *action;
+
+	if (!job)
+		return false;
+	if (job->nr_deferred >= job->allocated_deferred) {
+		job->allocated_deferred = (job->nr_deferred + 4) * 3 / 2;
+		job->deferred = realloc(job->deferred, job->allocated_deferred * sizeof(*job->deferred));
+		if (!job->deferred)
+			exit(1);
+	}
+	action = &job->deferred[job->nr_deferred++];
+	memset(action, 0, sizeof(*action));
+	action->fn = fn;
+	action->line = strdup(line);
+	put_bytes(&action->str, str->buffer, str->len);
+	return true;
+}
+
 static void parse_dive_gps(char *line, struct membuffer *str, struct git_parser_state *state)
 {
-	UNUSED(str);
 	location_t location;
-	struct dive_site *ds = get_dive_site_for_dive(state->active_dive);
+	struct dive_site *ds;
 
+	if (defer_action(parse_dive_gps, line, str, state))
+		return;
+	ds = get_dive_site_for_dive(state->active_dive);
 	parse_location(line, &location);
 	if (!ds) {
 		ds = get_dive_site_by_gps(&location, state->sites);
@@ -176,15 +248,20 @@ static void parse_dive_gps(char *line, struct membuffer *str, struct git_parser_
 			free(coords);
 		}
 		ds->location = location;
+		invalidate_dive_site_grids();
 	}
 
 }
 
 static void parse_dive_location(char *line, struct membuffer *str, struct git_parser_state *state)
 {
-	UNUSED(line);
-	char *name = detach_cstring(str);
-	struct dive_site *ds = get_dive_site_for_dive(state->active_dive);
+	char *name;
+	struct dive_site *ds;
+
+	if (defer_action(parse_dive_location, line, str, state))
+		return;
+	name = detach_cstring(str);
+	ds = get_dive_site_for_dive(state->active_dive);
 	if (!ds) {
 		ds = get_dive_site_by_name(name, &dive_site_table);
 		if (!ds)
@@ -216,7 +293,11 @@ static void parse_dive_notes(char *line, struct membuffer *str, struct git_parse
 { UNUSED(line); state->active_dive->notes = detach_cstring(str); }
 
 static void parse_dive_divesiteid(char *line, struct membuffer *str, struct git_parser_state *state)
-{ UNUSED(str); add_dive_to_dive_site(state->active_dive, get_dive_site_by_uuid(get_hex(line), &dive_site_table)); }
+{
+	if (defer_action(parse_dive_divesiteid, line, str, state))
+		return;
+	add_dive_to_dive_site(state->active_dive, get_dive_site_by_uuid(get_hex(line), &dive_site_table));
+}
 
 /*
  * We can have multiple tags in the membuffer. They are separated by
@@ -224,12 +305,13 @@ static void parse_dive_divesiteid(char *line, struct membuffer *str, struct git_
  */
 static void parse_dive_tags(char *line, struct membuffer *str, struct git_parser_state *state)
 {
-	UNUSED(line);
 	const char *tag;
 	int len = str->len;
 
 	if (!len)
 		return;
+	if (defer_action(parse_dive_tags, line, str, state))
+		return;
 
 	/* Make sure there is a NUL at the end too */
 	tag = mb_cstring(str);
@@ -305,6 +387,7 @@ static void parse_site_gps(char *line, struct membuffer *str, struct git_parser_
 {
 	UNUSED(str);
 	parse_location(line, &state->active_site->location);
+	invalidate_dive_site_grids();
 }
 
 static void parse_site_geo(char *line, struct membuffer *str, struct git_parser_state *state)
@@ -486,10 +569,11 @@ static void parse_dive_weightsystem(char *line, struct membuffer *str, struct gi
 }
 
 static int match_action(char *line, struct membuffer *str, void *data,
-	struct keyword_action *action, unsigned nr_action)
+	struct keyword_table *table)
 {
 	char *p = line, c;
-	unsigned low, high;
+	const struct keyword_action *a;
+	int idx;
 
 	while ((c = *p) >= 'a' && c <= 'z') // skip over 1st word
 		p++;	// Extract the second word from the line:
@@ -505,24 +589,14 @@ static int match_action(char *line, struct membuffer *str, void *data,
 		return -1;
 	}
 
-	/* Standard binary search in a table */
-	low = 0;
-	high = nr_action;
-	while (low < high) {
-		unsigned mid = (low + high)/2;
-		struct keyword_action *a = action + mid;
-		int cmp = strcmp(line, a->keyword);
-		if (!cmp) {	// attribute found:
-			a->fn(p, str, data);	// Execute appropriate function,
-			return 0;		// .. passing 2n word from above
-		}				// (p) as a function argument.
-		if (cmp < 0)
-			high = mid;
-		else
-			low = mid + 1;
+	idx = lookup_keyword(table, line, strlen(line));
+	if (idx < 0) {
+		report_error("Unmatched action '%s'", line);
+		return -1;
 	}
-report_error("Unmatched action '%s'", line);
-	return -1;
+	a = (const struct keyword_action *)table->entries + idx;
+	a->fn(p, str, data);	// Execute appropriate function, passing 2nd word
+	return 0;		// from above (p) as a function argument.
 }
 
 /* FIXME! We should do the array thing here too. */
@@ -729,7 +803,7 @@ static void parse_dc_meandepth(char *line, struct membuffer *str, struct git_par
 { UNUSED(str); state->active_dc->meandepth = get_depth(line); }
 
 static void parse_dc_model(char *line, struct membuffer *str, struct git_parser_state *state)
-{ UNUSED(line); state->active_dc->model = detach_cstring(str); }
+{ UNUSED(line); state->active_dc->model = intern_string(mb_cstring(str)); }
 
 static void parse_dc_numberofoxygensensors(char *line, struct membuffer *str, struct git_parser_state *state)
 { UNUSED(str); state->active_dc->no_o2sensors = get_index(line); }
@@ -848,7 +922,10 @@ static void parse_dc_event(char *line, struct membuffer *str, struct git_parser_
 	if (p.has_divemode && strcmp(p.name, "modechange"))
 		p.name = "modechange";
 
-	ev = add_event(state->active_dc, p.ev.time.seconds, p.ev.type, p.ev.flags, p.ev.value, p.name);
+	/* The names of the events are remembered on the calling thread, see record_dive_job() */
+	ev = create_event(p.ev.time.seconds, p.ev.type, p.ev.flags, p.ev.value, p.name);
+	if (ev)
+		add_event_to_dc(state->active_dc, ev);
 
 	/*
 	 * Older logs might mark the dive to be CCR by having an "SP change" event at time 0:00.
@@ -1021,7 +1098,6 @@ static void parse_picture_hash(char *line, struct membuffer *str, struct git_par
 	UNUSED(str);
 }
 
-/* These need to be sorted! */
 struct keyword_action dc_action[] = {
 #undef D
 #define D(x) { #x, parse_dc_ ## x }
@@ -1029,6 +1105,7 @@ struct keyword_action dc_action[] = {
 	D(event), D(keyvalue), D(lastmanualtime), D(maxdepth), D(meandepth), D(model), D(numberofoxygensensors),
 	D(salinity), D(surfacepressure), D(surfacetime), D(time), D(watertemp)
 };
+static struct keyword_table dc_keywords = KEYWORD_TABLE(dc_action);
 
 /* Sample lines start with a space or a number */
 static void divecomputer_parser(char *line, struct membuffer *str, struct git_parser_state *state)
@@ -1036,10 +1113,9 @@ static void divecomputer_parser(char *line, struct membuffer *str, struct git_pa
 	char c = *line;
 	if (c < 'a' || c > 'z')
 		sample_parser(line, state);
-	match_action(line, str, state, dc_action, ARRAY_SIZE(dc_action));
+	match_action(line, str, state, &dc_keywords);
 }
 
-/* These need to be sorted! */
 struct keyword_action dive_action[] = {
 #undef D
 #define D(x) { #x, parse_dive_ ## x }
@@ -1047,58 +1123,59 @@ struct keyword_action dive_action[] = {
 	D(gps), D(invalid), D(location), D(notes), D(notrip), D(rating), D(suit), D(surge),
 	D(tags), D(visibility), D(watersalinity), D(watertemp), D(wavesize), D(weightsystem)
 };
+static struct keyword_table dive_keywords = KEYWORD_TABLE(dive_action);
 
 static void dive_parser(char *line, struct membuffer *str, struct git_parser_state *state)
 {
-	match_action(line, str, state, dive_action, ARRAY_SIZE(dive_action));
+	match_action(line, str, state, &dive_keywords);
 }
 
-/* These need to be sorted! */
 struct keyword_action site_action[] = {
 #undef D
 #define D(x) { #x, parse_site_ ## x }
 	D(description), D(geo), D(gps), D(name), D(notes)
 };
+static struct keyword_table site_keywords = KEYWORD_TABLE(site_action);
 
 static void site_parser(char *line, struct membuffer *str, struct git_parser_state *state)
 {
-	match_action(line, str, state, site_action, ARRAY_SIZE(site_action));
+	match_action(line, str, state, &site_keywords);
 }
 
-/* These need to be sorted! */
 struct keyword_action trip_action[] = {
 #undef D
 #define D(x) { #x, parse_trip_ ## x }
 	D(date), D(location), D(notes), D(time),
 };
+static struct keyword_table trip_keywords = KEYWORD_TABLE(trip_action);
 
 static void trip_parser(char *line, struct membuffer *str, struct git_parser_state *state)
 {
-	match_action(line, str, state, trip_action, ARRAY_SIZE(trip_action));
+	match_action(line, str, state, &trip_keywords);
 }
 
-/* These need to be sorted! */
 static struct keyword_action settings_action[] = {
 #undef D
 #define D(x) { #x, parse_settings_ ## x }
 	D(autogroup), D(divecomputerid), D(prefs), D(subsurface), D(units), D(userid), D(version)
 };
+static struct keyword_table settings_keywords = KEYWORD_TABLE(settings_action);
 
 static void settings_parser(char *line, struct membuffer *str, struct git_parser_state *state)
 {
-	match_action(line, str, state, settings_action, ARRAY_SIZE(settings_action));
+	match_action(line, str, state, &settings_keywords);
 }
 
-/* These need to be sorted! */
 static struct keyword_action picture_action[] = {
 #undef D
 #define D(x) { #x, parse_picture_ ## x }
 	D(filename), D(gps), D(hash)
 };
+static struct keyword_table picture_keywords = KEYWORD_TABLE(picture_action);
 
 static void picture_parser(char *line, struct membuffer *str, struct git_parser_state *state)
 {
-	match_action(line, str, state, picture_action, ARRAY_SIZE(picture_action));
+	match_action(line, str, state, &picture_keywords);
 }
 
 /*
@@ -1207,10 +1284,8 @@ static unsigned parse_one_line(const char *buf, unsigned size, line_fn_t *fn, st
  * strings, but the callback function can "steal" it by
  * saving its value and just clear the original.
  */
-static void for_each_line(git_blob *blob, line_fn_t *fn, struct git_parser_state *state)
+static void for_each_line_in_buffer(const char *content, unsigned int size, line_fn_t *fn, struct git_parser_state *state)
 {
-	const char *content = git_blob_rawcontent(blob);
-	unsigned int size = git_blob_rawsize(blob);
 	struct membuffer str = { 0 };
 
 	while (size) {
@@ -1224,6 +1299,11 @@ static void for_each_line(git_blob *blob, line_fn_t *fn, struct git_parser_state
 	free_buffer(&str);
 }
 
+static void for_each_line(git_blob *blob, line_fn_t *fn, struct git_parser_state *state)
+{
+	for_each_line_in_buffer(git_blob_rawcontent(blob), git_blob_rawsize(blob), fn, state);
+}
+
 #define GIT_WALK_OK   0
 #define GIT_WALK_SKIP 1
 
@@ -1239,17 +1319,23 @@ static void finish_active_trip(struct git_parser_state *state)
 
 static void finish_active_dive(struct git_parser_state *state)
 {
-	struct dive *dive = state->active_dive;
-
-	if (dive) {
-		state->active_dive = NULL;
-		record_dive_to_table(dive, state->table);
-	}
+	state->active_dive = NULL;
 }
 
 static void create_new_dive(timestamp_t when, struct git_parser_state *state)
 {
+	struct dive_job *job;
+
 	state->active_dive = alloc_dive();
+	if (state->nr_jobs >= state->allocated_jobs) {
+		state->allocated_jobs = (state->nr_jobs + 32) * 3 / 2;
+		state->jobs = realloc(state->jobs, state->allocated_jobs * sizeof(*state->jobs));
+		if (!state->jobs)
+			exit(1);
+	}
+	job = &state->jobs[state->nr_jobs++];
+	memset(job, 0, sizeof(*job));
+	job->dive = state->active_dive;
 
 	/* We'll fill in more data from the dive file */
 	state->active_dive->when = when;
@@ -1511,24 +1597,30 @@ static struct divecomputer *create_new_dc(struct dive *dive)
 	return dc;
 }
 
-/*
- * We should *really* try to delay the dive computer data parsing
- * until necessary, in order to reduce load-time. The parsing is
- * cheap, but the loading of the git blob into memory can be pretty
- * costly.
- */
-static int parse_divecomputer_entry(struct git_parser_state *state, const git_tree_entry *entry, const char *suffix)
+/* Remember a blob of the active dive, to be parsed by parse_dive_job() */
+static void add_dive_blob(struct git_parser_state *state, enum dive_blob_type type, const git_tree_entry *entry, int offset)
 {
-	UNUSED(suffix);
-	git_blob *blob = git_tree_entry_blob(state->repo, entry);
+	struct dive_job *job = &state->jobs[state->nr_jobs - 1];
+	struct dive_blob *blob;
 
-	if (!blob)
-		return report_error("Unable to read divecomputer file");
+	if (job->nr_blobs >= job->allocated_blobs) {
+		job->allocated_blobs = (job->nr_blobs + 4) * 3 / 2;
+		job->blobs = realloc(job->blobs, job->allocated_blobs * sizeof(*job->blobs));
+		if (!job->blobs)
+			exit(1);
+	}
+	blob = &job->blobs[job->nr_blobs++];
+	blob->type = type;
+	git_oid_cpy(&blob->id, git_tree_entry_id(entry));
+	blob->offset = offset;
+	blob->content = NULL;
+	blob->size = 0;
+}
 
-	state->active_dc = create_new_dc(state->active_dive);
-	for_each_line(blob, divecomputer_parser, state);
-	git_blob_free(blob);
-	state->active_dc = NULL;
+static int parse_divecomputer_entry(struct git_parser_state *state, const git_tree_entry *entry, const char *suffix)
+{
+	UNUSED(suffix);
+	add_dive_blob(state, DIVECOMPUTER_BLOB, entry, 0);
 	return 0;
 }
 
@@ -1540,16 +1632,9 @@ static int parse_divecomputer_entry(struct git_parser_state *state, const git_tr
  */
 static int parse_dive_entry(struct git_parser_state *state, const git_tree_entry *entry, const char *suffix)
 {
-	struct dive *dive = state->active_dive;
-	git_blob *blob = git_tree_entry_blob(state->repo, entry);
-	if (!blob)
-		return report_error("Unable to read dive file");
 	if (*suffix)
-		dive->number = atoi(suffix + 1);
-	clear_weightsystem_table(&state->active_dive->weightsystems);
-	state->o2pressure_sensor = 1;
-	for_each_line(blob, dive_parser, state);
-	git_blob_free(blob);
+		state->active_dive->number = atoi(suffix + 1);
+	add_dive_blob(state, DIVE_BLOB, entry, 0);
 	return 0;
 }
 
@@ -1590,7 +1675,6 @@ static int parse_settings_entry(struct git_parser_state *state, const git_tree_e
 
 static int parse_picture_entry(struct git_parser_state *state, const git_tree_entry *entry, const char *name)
 {
-	git_blob *blob;
 	int hh, mm, ss, offset;
 	char sign;
 
@@ -1607,20 +1691,149 @@ static int parse_picture_entry(struct git_parser_state *state, const git_tree_en
 	if (sign == '-')
 		offset = -offset;
 
-	blob = git_tree_entry_blob(state->repo, entry);
-	if (!blob)
-		return report_error("Unable to read picture file");
+	add_dive_blob(state, PICTURE_BLOB, entry, offset);
+	return 0;
+}
+
+/*
+ * We should *really* try to delay the dive computer data parsing
+ * until necessary, in order to reduce load-time. The parsing is
+ * cheap, but the loading of the git blob into memory can be pretty
+ * costly.
+ *
+ * Runs on the calling thread: libgit2 objects must not be looked up
+ * concurrently, so the content is copied for the worker threads.
+ */
+static void read_dive_blob(git_repository *repo, struct dive_blob *b)
+{
+	git_blob *blob;
 
-	state->active_pic.offset.seconds = offset;
+	if (git_blob_lookup(&blob, repo, &b->id)) {
+		switch (b->type) {
+		case DIVE_BLOB:
+			report_error("Unable to read dive file");
+			break;
+		case DIVECOMPUTER_BLOB:
+			report_error("Unable to read divecomputer file");
+			break;
+		case PICTURE_BLOB:
+			report_error("Unable to read picture file");
+			break;
+		}
+		return;
+	}
 
-	for_each_line(blob, picture_parser, state);
-	add_picture(&state->active_dive->pictures, state->active_pic);
+	b->size = git_blob_rawsize(blob);
+	b->content = malloc(b->size + 1);
+	if (!b->content)
+		exit(1);
+	memcpy(b->content, git_blob_rawcontent(blob), b->size);
+	b->content[b->size] = 0;
 	git_blob_free(blob);
+}
 
-	/* add_picture took ownership of the data -
-	 * clear out our copy just to be sure. */
-	state->active_pic = empty_picture;
-	return 0;
+static void parse_dive_blob(struct git_parser_state *state, struct dive_blob *b)
+{
+	struct dive *dive = state->active_dive;
+
+	if (!b->content)
+		return;
+
+	switch (b->type) {
+	case DIVE_BLOB:
+		clear_weightsystem_table(&dive->weightsystems);
+		state->o2pressure_sensor = 1;
+		for_each_line_in_buffer(b->content, b->size, dive_parser, state);
+		break;
+	case DIVECOMPUTER_BLOB:
+		state->active_dc = create_new_dc(dive);
+		for_each_line_in_buffer(b->content, b->size, divecomputer_parser, state);
+		state->active_dc = NULL;
+		break;
+	case PICTURE_BLOB:
+		state->active_pic.offset.seconds = b->offset;
+		for_each_line_in_buffer(b->content, b->size, picture_parser, state);
+		add_picture(&dive->pictures, state->active_pic);
+
+		/* add_picture took ownership of the data -
+		 * clear out our copy just to be sure. */
+		state->active_pic = empty_picture;
+		break;
+	}
+	free(b->content);
+	b->content = NULL;
+}
+
+/* Runs on a worker thread: parse all blobs of a dive with a private parser state */
+static void parse_dive_job(int idx, void *data)
+{
+	const struct git_parser_state *main_state = data;
+	struct dive_job *job = &main_state->jobs[idx];
+	struct git_parser_state state = { 0 };
+
+	/* No access to the repository, see read_dive_blob() */
+	state.table = main_state->table;
+	state.trips = main_state->trips;
+	state.sites = main_state->sites;
+	state.active_dive = job->dive;
+	state.active_job = job;
+	for (int i = 0; i < job->nr_blobs; i++)
+		parse_dive_blob(&state, &job->blobs[i]);
+}
+
+/* Runs on the calling thread in the order of the dives */
+static void record_dive_job(struct git_parser_state *state, struct dive_job *job)
+{
+	struct dive *dive = job->dive;
+	const struct divecomputer *dc;
+	const struct event *ev;
+
+	state->active_dive = dive;
+	for (int i = 0; i < job->nr_deferred; i++) {
+		struct deferred_action *action = &job->deferred[i];
+		action->fn(action->line, &action->str, state);
+		free(action->line);
+		free_buffer(&action->str);
+	}
+	state->active_dive = NULL;
+	for_each_dc(dive, dc) {
+		for (ev = dc->events; ev; ev = ev->next)
+			remember_event(ev->name);
+	}
+	free(job->deferred);
+	free(job->blobs);
+	record_dive_to_table(dive, state->table);
+}
+
+/*
+ * Read the blobs of a batch of dives and parse them in parallel. The
+ * batches limit the amount of blob data that is kept in memory.
+ */
+#define DIVE_JOB_BATCH 256
+
+static void parse_dive_jobs(struct git_parser_state *state)
+{
+	hold_errors();
+	for (int first = 0; first < state->nr_jobs; first += DIVE_JOB_BATCH) {
+		int nr = MIN(state->nr_jobs - first, DIVE_JOB_BATCH);
+		struct git_parser_state batch = *state;
+
+		for (int i = first; i < first + nr; i++) {
+			struct dive_job *job = &state->jobs[i];
+			for (int j = 0; j < job->nr_blobs; j++)
+				read_dive_blob(state->repo, &job->blobs[j]);
+		}
+
+		batch.jobs = state->jobs + first;
+		batch.nr_jobs = nr;
+		if (git_load_sequential) {
+			for (int i = 0; i < nr; i++)
+				parse_dive_job(i, &batch);
+		} else {
+			run_in_parallel(nr, parse_dive_job, &batch);
+		}
+	}
+	release_errors();
 }
 
 static int walk_tree_file(const char *root, const git_tree_entry *entry, struct git_parser_state *state)
@@ -1672,6 +1885,14 @@ static int walk_tree_cb(const char *root, const git_tree_entry *entry, void *pay
 static int load_dives_from_tree(git_repository *repo, git_tree *tree, struct git_parser_state *state)
 {
 	git_tree_walk(tree, GIT_TREEWALK_PRE, walk_tree_cb, state);
+	finish_active_dive(state);
+
+	parse_dive_jobs(state);
+	for (int i = 0; i < state->nr_jobs; i++)
+		record_dive_job(state, &state->jobs[i]);
+	free(state->jobs);
+	state->jobs = NULL;
+	state->nr_jobs = state->allocated_jobs = 0;
 	return 0;
 }
 
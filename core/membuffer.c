@@ -41,6 +41,14 @@ void flush_buffer(struct membuffer *b, FILE *f)
 	}
 }
 
+void flush_chunk(struct membuffer *b, FILE *f, unsigned int size)
+{
+	if (f && b->len > size) {
+		fwrite(b->buffer, 1, b->len, f);
+		b->len = 0;
+	}
+}
+
 void strip_mb(struct membuffer *b)
 {
 	while (b->len && isspace(b->buffer[b->len - 1]))
@@ -156,30 +164,76 @@ void put_format_loc(struct membuffer *b, const char *fmt, ...)
 	va_end(args);
 }
 
+/*
+ * The number formatting below is done by hand, since going
+ * through vsnprintf() for every value of every sample is
+ * what dominates saving a dive log.
+ *
+ * Write the digits of "value", padded with spaces to "width",
+ * backwards from "end" and return the start.
+ */
+static char *format_uint(char *end, unsigned int value, int width)
+{
+	char *p = end;
+
+	do {
+		*--p = '0' + value % 10;
+		value /= 10;
+	} while (value);
+	while (end - p < width)
+		*--p = ' ';
+	return p;
+}
+
+void put_uint(struct membuffer *b, unsigned int value, int width)
+{
+	char buf[32], *end = buf + sizeof(buf);
+	char *p = format_uint(end, value, width < 16 ? width : 16);
+
+	put_bytes(b, p, end - p);
+}
+
+void put_min_sec(struct membuffer *b, const char *pre, unsigned int seconds, int width, const char *post)
+{
+	char buf[32], *end = buf + sizeof(buf);
+	char *p = end;
+	unsigned int sec = seconds % 60;
+
+	*--p = '0' + sec % 10;
+	*--p = '0' + sec / 10;
+	*--p = ':';
+	p = format_uint(p, seconds / 60, width < 16 ? width : 16);
+	put_string(b, pre);
+	put_bytes(b, p, end - p);
+	put_string(b, post);
+}
+
 void put_milli(struct membuffer *b, const char *pre, int value, const char *post)
 {
-	int i;
-	char buf[4];
-	const char *sign = "";
-	unsigned v;
+	char buf[32], *end = buf + sizeof(buf);
+	char *p = end;
+	unsigned v, frac;
 
 	v = value;
-	if (value < 0) {
-		sign = "-";
+	if (value < 0)
 		v = -value;
-	}
-	for (i = 2; i >= 0; i--) {
-		buf[i] = (v % 10) + '0';
-		v /= 10;
-	}
-	buf[3] = 0;
-	if (buf[2] == '0') {
-		buf[2] = 0;
-		if (buf[1] == '0')
-			buf[1] = 0;
-	}
 
-	put_format(b, "%s%s%u.%s%s", pre, sign, v, buf, post);
+	/* At least one decimal, but no trailing zeroes */
+	frac = v % 1000;
+	if (frac % 100) {
+		if (frac % 10)
+			*--p = '0' + frac % 10;
+		*--p = '0' + frac / 10 % 10;
+	}
+	*--p = '0' + frac / 100;
+	*--p = '.';
+	p = format_uint(p, v / 1000, 0);
+	if (value < 0)
+		*--p = '-';
+
+	put_string(b, pre);
+	put_bytes(b, p, end - p);
+	put_string(b, post);
 }
 
 void put_temperature(struct membuffer *b, temperature_t temp, const char *pre, const char *post)
@@ -197,7 +251,7 @@ void put_depth(struct membuffer *b, depth_t depth, const char *pre, const char *
 void put_duration(struct membuffer *b, duration_t duration, const char *pre, const char *post)
 {
 	if (duration.seconds)
-		put_format(b, "%s%u:%02u%s", pre, FRACTION(duration.seconds, 60), post);
+		put_min_sec(b, pre, duration.seconds, 0, post);
 }
 
 void put_pressure(struct membuffer *b, pressure_t pressure, const char *pre, const char *post)
@@ -214,14 +268,26 @@ void put_salinity(struct membuffer *b, int salinity, const char *pre, const char
 
 void put_degrees(struct membuffer *b, degrees_t value, const char *pre, const char *post)
 {
-	int udeg = value.udeg;
-	const char *sign = "";
+	char buf[32], *end = buf + sizeof(buf);
+	char *p = end;
+	unsigned int udeg;
+	int i;
 
-	if (udeg < 0) {
-		udeg = -udeg;
-		sign = "-";
+	udeg = value.udeg;
+	if (value.udeg < 0)
+		udeg = -value.udeg;
+	for (i = 0; i < 6; i++) {
+		*--p = '0' + udeg % 10;
+		udeg /= 10;
 	}
-	put_format(b, "%s%s%u.%06u%s", pre, sign, FRACTION(udeg, 1000000), post);
+	*--p = '.';
+	p = format_uint(p, udeg, 0);
+	if (value.udeg < 0)
+		*--p = '-';
+
+	put_string(b, pre);
+	put_bytes(b, p, end - p);
+	put_string(b, post);
 }
 
 void put_location(struct membuffer *b, const location_t *loc, const char *pre, const char *post)
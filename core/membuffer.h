@@ -60,6 +60,8 @@ extern char *detach_cstring(struct membuffer *b);
 extern void free_buffer(struct membuffer *);
 extern void make_room(struct membuffer *b, unsigned int size);
 extern void flush_buffer(struct membuffer *, FILE *);
+/* Write out the buffer once it holds more than the given size, but keep its memory */
+extern void flush_chunk(struct membuffer *, FILE *, unsigned int);
 extern void put_bytes(struct membuffer *, const char *, int);
 extern void put_string(struct membuffer *, const char *);
 extern void put_quoted(struct membuffer *, const char *, int, int);
@@ -77,6 +79,14 @@ extern __printf(1, 0) char *vformat_string(const char *, va_list);
 extern __printf(1, 2) char *format_string(const char *, ...);
 
 
+/*
+ * Fast output of unsigned numbers and of "min:sec" times, for the
+ * common cases of "%u" and "%u:%02u". The width pads the number (of
+ * minutes) with spaces, like "%3u" does.
+ */
+extern void put_uint(struct membuffer *, unsigned int, int width);
+extern void put_min_sec(struct membuffer *, const char *, unsigned int, int width, const char *);
+
 /* Output one of our "milli" values with type and pre/post data */
 extern void put_milli(struct membuffer *, const char *, int, const char *);
 
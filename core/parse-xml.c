@@ -16,6 +16,7 @@
 #include <libxml/parser.h>
 #include <libxml/parserInternals.h>
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 #include <libxslt/transform.h>
 #include <libdivecomputer/parser.h>
 
@@ -24,6 +25,7 @@
 #include "divesite.h"
 #include "errorhelper.h"
 #include "subsurface-string.h"
+#include "keyword.h"
 #include "parse.h"
 #include "subsurface-time.h"
 #include "trip.h"
@@ -37,6 +39,7 @@ int quit, force_root;
 int last_xml_version = -1;
 
 static xmlDoc *test_xslt_transforms(xmlDoc *doc, const char **params);
+static bool needs_xslt_transform(xmlNode *root_element);
 
 const struct units SI_units = SI_UNITS;
 const struct units IMPERIAL_units = IMPERIAL_UNITS;
@@ -741,199 +744,300 @@ static void try_to_fill_dc_settings(const char *name, char *buf, struct parser_s
 	nonmatch("divecomputerid", name, buf);
 }
 
+/*
+ * The keywords of the event, divecomputer, sample and dive nodes are
+ * looked up with a perfect hash (see keyword.h). The entries of a table
+ * are in order of precedence: if several keywords match a node name,
+ * e.g. "weight.weightsystem" and "weight", the first one wins.
+ */
+enum xml_keyword_id {
+	EVENT_NAME, EVENT_TIME, EVENT_TYPE, EVENT_FLAGS, EVENT_VALUE, EVENT_DIVEMODE,
+	EVENT_CYLINDER, EVENT_O2, EVENT_HE,
+
+	DC_DATE, DC_TIME, DC_MODEL, DC_DEVICEID, DC_DIVEID, DC_DCTYPE, DC_NO_O2SENSORS,
+
+	DC_MAXDEPTH, DC_MEANDEPTH, DC_DURATION, DC_LAST_MANUAL_TIME, DC_SURFACETIME,
+	DC_AIRTEMP, DC_WATERTEMP, DC_SURFACE_PRESSURE, DC_SALINITY, DC_EXTRADATA_KEY,
+	DC_EXTRADATA_VALUE, DC_DIVEMODE,
+
+	SAMPLE_PRESSURE, SAMPLE_O2PRESSURE, SAMPLE_PRESSURE0, SAMPLE_PRESSURE1,
+	SAMPLE_PRESSURE2, SAMPLE_PRESSURE3, SAMPLE_PRESSURE4, SAMPLE_CYLINDERINDEX,
+	SAMPLE_SENSOR, SAMPLE_DEPTH, SAMPLE_TEMPERATURE, SAMPLE_TIME, SAMPLE_NDL,
+	SAMPLE_TTS, SAMPLE_IN_DECO, SAMPLE_STOPTIME, SAMPLE_STOPDEPTH, SAMPLE_CNS,
+	SAMPLE_RBT, SAMPLE_SENSOR1, SAMPLE_SENSOR2, SAMPLE_SENSOR3, SAMPLE_SETPOINT,
+	SAMPLE_HEARTBEAT, SAMPLE_BEARING, SAMPLE_PPO2, SAMPLE_DECO,
+
+	DIVE_DIVESITEID, DIVE_NUMBER, DIVE_TAGS, DIVE_TRIPFLAG, DIVE_DATE, DIVE_TIME,
+	DIVE_DATETIME, DIVE_PICTURE_FILENAME, DIVE_PICTURE_OFFSET, DIVE_PICTURE_GPS,
+	DIVE_PICTURE_HASH, DIVE_CYLINDER_START, DIVE_CYLINDER_END, DIVE_GPS, DIVE_LAT,
+	DIVE_LONG, DIVE_LOCATION, DIVE_SUIT, DIVE_NOTES, DIVE_DIVEMASTER, DIVE_BUDDY,
+	DIVE_WATERSALINITY, DIVE_RATING, DIVE_VISIBILITY, DIVE_WAVESIZE, DIVE_CURRENT,
+	DIVE_SURGE, DIVE_CHILL, DIVE_AIRPRESSURE, DIVE_WEIGHT_DESCRIPTION, DIVE_WEIGHT,
+	DIVE_AIRTEMP, DIVE_WATERTEMP, DIVE_INVALID,
+
+	CYL_SIZE, CYL_WORKPRESSURE, CYL_DESCRIPTION, CYL_START, CYL_END, CYL_USE,
+	CYL_DEPTH, CYL_O2, CYL_N2, CYL_HE
+};
+
+struct xml_keyword {
+	const char *name;
+	enum xml_keyword_id id;
+};
+
+/* The id of the first keyword matching the node name or -1 */
+static int find_xml_keyword(struct keyword_table *table, const char *name)
+{
+	int idx = match_keyword(table, name);
+
+	return idx >= 0 ? (int)((const struct xml_keyword *)table->entries)[idx].id : -1;
+}
+
+static struct xml_keyword event_keyword[] = {
+	{ "event", EVENT_NAME }, { "name", EVENT_NAME }, { "time", EVENT_TIME }, { "type", EVENT_TYPE },
+	{ "flags", EVENT_FLAGS }, { "value", EVENT_VALUE }, { "divemode", EVENT_DIVEMODE },
+	{ "cylinder", EVENT_CYLINDER }, { "o2", EVENT_O2 }, { "he", EVENT_HE }
+};
+static struct keyword_table event_keywords = KEYWORD_TABLE(event_keyword);
+
 static void try_to_fill_event(const char *name, char *buf, struct parser_state *state)
 {
 	start_match("event", name, buf);
-	if (MATCH("event", event_name, state->cur_event.name))
-		return;
-	if (MATCH("name", event_name, state->cur_event.name))
+	switch (find_xml_keyword(&event_keywords, name)) {
+	case EVENT_NAME:
+		event_name(buf, state->cur_event.name);
 		return;
-	if (MATCH_STATE("time", eventtime, &state->cur_event.time))
+	case EVENT_TIME:
+		eventtime(buf, &state->cur_event.time, state);
 		return;
-	if (MATCH("type", get_index, &state->cur_event.type))
+	case EVENT_TYPE:
+		get_index(buf, &state->cur_event.type);
 		return;
-	if (MATCH("flags", get_index, &state->cur_event.flags))
+	case EVENT_FLAGS:
+		get_index(buf, &state->cur_event.flags);
 		return;
-	if (MATCH("value", get_index, &state->cur_event.value))
+	case EVENT_VALUE:
+		get_index(buf, &state->cur_event.value);
 		return;
-	if (MATCH("divemode", event_divemode, &state->cur_event.value))
+	case EVENT_DIVEMODE:
+		event_divemode(buf, &state->cur_event.value);
 		return;
-	if (MATCH("cylinder", get_index, &state->cur_event.gas.index)) {
+	case EVENT_CYLINDER:
+		get_index(buf, &state->cur_event.gas.index);
 		/* We add one to indicate that we got an actual cylinder index value */
 		state->cur_event.gas.index++;
 		return;
-	}
-	if (MATCH("o2", percent, &state->cur_event.gas.mix.o2))
+	case EVENT_O2:
+		percent(buf, &state->cur_event.gas.mix.o2);
 		return;
-	if (MATCH("he", percent, &state->cur_event.gas.mix.he))
+	case EVENT_HE:
+		percent(buf, &state->cur_event.gas.mix.he);
 		return;
+	}
 	nonmatch("event", name, buf);
 }
 
-static int match_dc_data_fields(struct divecomputer *dc, const char *name, char *buf, struct parser_state *state)
+/* The fields shared by the divecomputer and (legacy) dive nodes */
+#define DC_DATA_KEYWORDS \
+	{ "maxdepth", DC_MAXDEPTH }, { "meandepth", DC_MEANDEPTH }, { "max.depth", DC_MAXDEPTH }, \
+	{ "mean.depth", DC_MEANDEPTH }, { "duration", DC_DURATION }, { "divetime", DC_DURATION }, \
+	{ "divetimesec", DC_DURATION }, { "last-manual-time", DC_LAST_MANUAL_TIME }, \
+	{ "surfacetime", DC_SURFACETIME }, { "airtemp", DC_AIRTEMP }, { "watertemp", DC_WATERTEMP }, \
+	{ "air.temperature", DC_AIRTEMP }, { "water.temperature", DC_WATERTEMP }, \
+	{ "pressure.surface", DC_SURFACE_PRESSURE }, { "salinity.water", DC_SALINITY }, \
+	{ "key.extradata", DC_EXTRADATA_KEY }, { "value.extradata", DC_EXTRADATA_VALUE }, \
+	{ "divemode", DC_DIVEMODE }, { "salinity", DC_SALINITY }, { "atmospheric", DC_SURFACE_PRESSURE }
+
+static int fill_dc_data_field(struct divecomputer *dc, int id, char *buf, struct parser_state *state)
 {
-	if (MATCH_STATE("maxdepth", depth, &dc->maxdepth))
-		return 1;
-	if (MATCH_STATE("meandepth", depth, &dc->meandepth))
-		return 1;
-	if (MATCH_STATE("max.depth", depth, &dc->maxdepth))
-		return 1;
-	if (MATCH_STATE("mean.depth", depth, &dc->meandepth))
-		return 1;
-	if (MATCH("duration", duration, &dc->duration))
-		return 1;
-	if (MATCH("divetime", duration, &dc->duration))
-		return 1;
-	if (MATCH("divetimesec", duration, &dc->duration))
-		return 1;
-	if (MATCH("last-manual-time", duration, &dc->last_manual_time))
+	switch (id) {
+	case DC_MAXDEPTH:
+		depth(buf, &dc->maxdepth, state);
 		return 1;
-	if (MATCH("surfacetime", duration, &dc->surfacetime))
+	case DC_MEANDEPTH:
+		depth(buf, &dc->meandepth, state);
 		return 1;
-	if (MATCH_STATE("airtemp", temperature, &dc->airtemp))
+	case DC_DURATION:
+		duration(buf, &dc->duration);
 		return 1;
-	if (MATCH_STATE("watertemp", temperature, &dc->watertemp))
+	case DC_LAST_MANUAL_TIME:
+		duration(buf, &dc->last_manual_time);
 		return 1;
-	if (MATCH_STATE("air.temperature", temperature, &dc->airtemp))
+	case DC_SURFACETIME:
+		duration(buf, &dc->surfacetime);
 		return 1;
-	if (MATCH_STATE("water.temperature", temperature, &dc->watertemp))
+	case DC_AIRTEMP:
+		temperature(buf, &dc->airtemp, state);
 		return 1;
-	if (MATCH_STATE("pressure.surface", pressure, &dc->surface_pressure))
+	case DC_WATERTEMP:
+		temperature(buf, &dc->watertemp, state);
 		return 1;
-	if (MATCH("salinity.water", salinity, &dc->salinity))
+	case DC_SURFACE_PRESSURE:
+		pressure(buf, &dc->surface_pressure, state);
 		return 1;
-	if (MATCH("key.extradata", utf8_string, &state->cur_extra_data.key))
+	case DC_SALINITY:
+		salinity(buf, &dc->salinity);
 		return 1;
-	if (MATCH("value.extradata", utf8_string, &state->cur_extra_data.value))
+	case DC_EXTRADATA_KEY:
+		utf8_string(buf, &state->cur_extra_data.key);
 		return 1;
-	if (MATCH("divemode", get_dc_type, &dc->divemode))
+	case DC_EXTRADATA_VALUE:
+		utf8_string(buf, &state->cur_extra_data.value);
 		return 1;
-	if (MATCH("salinity", salinity, &dc->salinity))
-		return 1;
-	if (MATCH_STATE("atmospheric", pressure, &dc->surface_pressure))
+	case DC_DIVEMODE:
+		get_dc_type(buf, &dc->divemode);
 		return 1;
+	}
 	return 0;
 }
 
+static struct xml_keyword dc_keyword[] = {
+	{ "date", DC_DATE }, { "time", DC_TIME }, { "model", DC_MODEL }, { "deviceid", DC_DEVICEID },
+	{ "diveid", DC_DIVEID }, { "dctype", DC_DCTYPE }, { "no_o2sensors", DC_NO_O2SENSORS },
+	DC_DATA_KEYWORDS
+};
+static struct keyword_table dc_keywords = KEYWORD_TABLE(dc_keyword);
+
 /* We're in the top-level dive xml. Try to convert whatever value to a dive value */
 static void try_to_fill_dc(struct divecomputer *dc, const char *name, char *buf, struct parser_state *state)
 {
 	unsigned int deviceid;
+	int id;
 
 	start_match("divecomputer", name, buf);
 
-	if (MATCH_STATE("date", divedate, &dc->when))
+	switch (id = find_xml_keyword(&dc_keywords, name)) {
+	case DC_DATE:
+		divedate(buf, &dc->when, state);
 		return;
-	if (MATCH_STATE("time", divetime, &dc->when))
+	case DC_TIME:
+		divetime(buf, &dc->when, state);
 		return;
-	if (MATCH("model", utf8_string, &dc->model))
+	case DC_MODEL:
+		utf8_string(buf, &dc->model);
 		return;
-	if (MATCH("deviceid", hex_value, &deviceid)) {
+	case DC_DEVICEID:
+		hex_value(buf, &deviceid);
 		set_dc_deviceid(dc, deviceid);
 		return;
-	}
-	if (MATCH("diveid", hex_value, &dc->diveid))
-		return;
-	if (MATCH("dctype", get_dc_type, &dc->divemode))
+	case DC_DIVEID:
+		hex_value(buf, &dc->diveid);
 		return;
-	if (MATCH("no_o2sensors", get_sensor, &dc->no_o2sensors))
+	case DC_DCTYPE:
+		get_dc_type(buf, &dc->divemode);
 		return;
-	if (match_dc_data_fields(dc, name, buf, state))
+	case DC_NO_O2SENSORS:
+		get_sensor(buf, &dc->no_o2sensors);
 		return;
+	default:
+		if (fill_dc_data_field(dc, id, buf, state))
+			return;
+	}
 
 	nonmatch("divecomputer", name, buf);
 }
 
+static struct xml_keyword sample_keyword[] = {
+	{ "pressure.sample", SAMPLE_PRESSURE }, { "cylpress.sample", SAMPLE_PRESSURE },
+	{ "pdiluent.sample", SAMPLE_PRESSURE }, { "o2pressure.sample", SAMPLE_O2PRESSURE },
+	{ "pressure0.sample", SAMPLE_PRESSURE0 }, { "pressure1.sample", SAMPLE_PRESSURE1 },
+	{ "pressure2.sample", SAMPLE_PRESSURE2 }, { "pressure3.sample", SAMPLE_PRESSURE3 },
+	{ "pressure4.sample", SAMPLE_PRESSURE4 }, { "cylinderindex.sample", SAMPLE_CYLINDERINDEX },
+	{ "sensor.sample", SAMPLE_SENSOR }, { "depth.sample", SAMPLE_DEPTH },
+	{ "temp.sample", SAMPLE_TEMPERATURE }, { "temperature.sample", SAMPLE_TEMPERATURE },
+	{ "sampletime.sample", SAMPLE_TIME }, { "time.sample", SAMPLE_TIME }, { "ndl.sample", SAMPLE_NDL },
+	{ "tts.sample", SAMPLE_TTS }, { "in_deco.sample", SAMPLE_IN_DECO },
+	{ "stoptime.sample", SAMPLE_STOPTIME }, { "stopdepth.sample", SAMPLE_STOPDEPTH },
+	{ "cns.sample", SAMPLE_CNS }, { "rbt.sample", SAMPLE_RBT }, { "sensor1.sample", SAMPLE_SENSOR1 },
+	{ "sensor2.sample", SAMPLE_SENSOR2 }, { "sensor3.sample", SAMPLE_SENSOR3 },
+	{ "po2.sample", SAMPLE_SETPOINT }, { "heartbeat", SAMPLE_HEARTBEAT }, { "bearing", SAMPLE_BEARING },
+	{ "setpoint.sample", SAMPLE_SETPOINT }, { "ppo2.sample", SAMPLE_PPO2 }, { "deco.sample", SAMPLE_DECO },
+	{ "time.deco", SAMPLE_STOPTIME }, { "depth.deco", SAMPLE_STOPDEPTH }
+};
+static struct keyword_table sample_keywords = KEYWORD_TABLE(sample_keyword);
+
 /* We're in samples - try to convert the random xml value to something useful */
 static void try_to_fill_sample(struct sample *sample, const char *name, char *buf, struct parser_state *state)
 {
 	int in_deco;
 	pressure_t p;
+	int id;
 
 	start_match("sample", name, buf);
-	if (MATCH_STATE("pressure.sample", pressure, &sample->pressure[0]))
-		return;
-	if (MATCH_STATE("cylpress.sample", pressure, &sample->pressure[0]))
+	switch (id = find_xml_keyword(&sample_keywords, name)) {
+	case SAMPLE_PRESSURE:
+		pressure(buf, &sample->pressure[0], state);
 		return;
-	if (MATCH_STATE("pdiluent.sample", pressure, &sample->pressure[0]))
-		return;
-	if (MATCH_STATE("o2pressure.sample", pressure, &sample->pressure[1]))
+	case SAMPLE_O2PRESSURE:
+		pressure(buf, &sample->pressure[1], state);
 		return;
 	/* Christ, this is ugly */
-	if (MATCH_STATE("pressure0.sample", pressure, &p)) {
-		add_sample_pressure(sample, 0, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("pressure1.sample", pressure, &p)) {
-		add_sample_pressure(sample, 1, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("pressure2.sample", pressure, &p)) {
-		add_sample_pressure(sample, 2, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("pressure3.sample", pressure, &p)) {
-		add_sample_pressure(sample, 3, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("pressure4.sample", pressure, &p)) {
-		add_sample_pressure(sample, 4, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("cylinderindex.sample", get_cylinderindex, &sample->sensor[0]))
-		return;
-	if (MATCH("sensor.sample", get_sensor, &sample->sensor[0]))
+	case SAMPLE_PRESSURE0:
+	case SAMPLE_PRESSURE1:
+	case SAMPLE_PRESSURE2:
+	case SAMPLE_PRESSURE3:
+	case SAMPLE_PRESSURE4:
+		pressure(buf, &p, state);
+		add_sample_pressure(sample, id - SAMPLE_PRESSURE0, p.mbar);
 		return;
-	if (MATCH_STATE("depth.sample", depth, &sample->depth))
+	case SAMPLE_CYLINDERINDEX:
+		get_cylinderindex(buf, &sample->sensor[0], state);
 		return;
-	if (MATCH_STATE("temp.sample", temperature, &sample->temperature))
+	case SAMPLE_SENSOR:
+		get_sensor(buf, &sample->sensor[0]);
 		return;
-	if (MATCH_STATE("temperature.sample", temperature, &sample->temperature))
+	case SAMPLE_DEPTH:
+		depth(buf, &sample->depth, state);
 		return;
-	if (MATCH("sampletime.sample", sampletime, &sample->time))
+	case SAMPLE_TEMPERATURE:
+		temperature(buf, &sample->temperature, state);
 		return;
-	if (MATCH("time.sample", sampletime, &sample->time))
+	case SAMPLE_TIME:
+		sampletime(buf, &sample->time);
 		return;
-	if (MATCH("ndl.sample", sampletime, &sample->ndl))
+	case SAMPLE_NDL:
+		sampletime(buf, &sample->ndl);
 		return;
-	if (MATCH("tts.sample", sampletime, &sample->tts))
+	case SAMPLE_TTS:
+		sampletime(buf, &sample->tts);
 		return;
-	if (MATCH("in_deco.sample", get_index, &in_deco)) {
+	case SAMPLE_IN_DECO:
+		get_index(buf, &in_deco);
 		sample->in_deco = (in_deco == 1);
 		return;
-	}
-	if (MATCH("stoptime.sample", sampletime, &sample->stoptime))
-		return;
-	if (MATCH_STATE("stopdepth.sample", depth, &sample->stopdepth))
-		return;
-	if (MATCH("cns.sample", get_uint16, &sample->cns))
+	case SAMPLE_STOPTIME:
+		sampletime(buf, &sample->stoptime);
 		return;
-	if (MATCH("rbt.sample", sampletime, &sample->rbt))
+	case SAMPLE_STOPDEPTH:
+		depth(buf, &sample->stopdepth, state);
 		return;
-	if (MATCH("sensor1.sample", double_to_o2pressure, &sample->o2sensor[0])) // CCR O2 sensor data
+	case SAMPLE_CNS:
+		get_uint16(buf, &sample->cns);
 		return;
-	if (MATCH("sensor2.sample", double_to_o2pressure, &sample->o2sensor[1]))
+	case SAMPLE_RBT:
+		sampletime(buf, &sample->rbt);
 		return;
-	if (MATCH("sensor3.sample", double_to_o2pressure, &sample->o2sensor[2])) // up to 3 CCR sensors
+	case SAMPLE_SENSOR1: // CCR O2 sensor data
+	case SAMPLE_SENSOR2:
+	case SAMPLE_SENSOR3: // up to 3 CCR sensors
+		double_to_o2pressure(buf, &sample->o2sensor[id - SAMPLE_SENSOR1]);
 		return;
-	if (MATCH("po2.sample", double_to_o2pressure, &sample->setpoint))
+	case SAMPLE_SETPOINT:
+		double_to_o2pressure(buf, &sample->setpoint);
 		return;
-	if (MATCH("heartbeat", get_uint8, &sample->heartbeat))
+	case SAMPLE_HEARTBEAT:
+		get_uint8(buf, &sample->heartbeat);
 		return;
-	if (MATCH("bearing", get_bearing, &sample->bearing))
+	case SAMPLE_BEARING:
+		get_bearing(buf, &sample->bearing);
 		return;
-	if (MATCH("setpoint.sample", double_to_o2pressure, &sample->setpoint))
-		return;
-	if (MATCH("ppo2.sample", double_to_o2pressure, &sample->o2sensor[state->next_o2_sensor])) {
+	case SAMPLE_PPO2:
+		double_to_o2pressure(buf, &sample->o2sensor[state->next_o2_sensor]);
 		state->next_o2_sensor++;
 		return;
-	}
-	if (MATCH("deco.sample", parse_libdc_deco, sample))
-		return;
-	if (MATCH("time.deco", sampletime, &sample->stoptime))
-		return;
-	if (MATCH_STATE("depth.deco", depth, &sample->stopdepth))
+	case SAMPLE_DECO:
+		parse_libdc_deco(buf, sample);
 		return;
+	}
 
 	switch (state->import_source) {
 	case DIVINGLOG:
@@ -1143,6 +1247,7 @@ static void gps_lat(char *buffer, struct dive *dive, struct parser_state *state)
 		if (ds->location.lat.udeg && ds->location.lat.udeg != location.lat.udeg)
 			fprintf(stderr, "Oops, changing the latitude of existing dive site id %8x name %s; not good\n", ds->uuid, ds->name ?: "(unknown)");
 		ds->location.lat = location.lat;
+		invalidate_dive_site_grids();
 	}
 }
 
@@ -1159,6 +1264,7 @@ static void gps_long(char *buffer, struct dive *dive, struct parser_state *state
 		if (ds->location.lon.udeg && ds->location.lon.udeg != location.lon.udeg)
 			fprintf(stderr, "Oops, changing the longitude of existing dive site id %8x name %s; not good\n", ds->uuid, ds->name ?: "(unknown)");
 		ds->location.lon = location.lon;
+		invalidate_dive_site_grids();
 	}
 }
 
@@ -1174,6 +1280,7 @@ void parse_location(const char *buffer, location_t *loc)
 static void gps_location(char *buffer, struct dive_site *ds)
 {
 	parse_location(buffer, &ds->location);
+	invalidate_dive_site_grids();
 }
 
 static void gps_in_dive(char *buffer, struct dive *dive, struct parser_state *state)
@@ -1206,6 +1313,7 @@ static void gps_in_dive(char *buffer, struct dive *dive, struct parser_state *st
 			free(coords);
 		} else {
 			ds->location = location;
+			invalidate_dive_site_grids();
 		}
 	}
 }
@@ -1215,12 +1323,83 @@ static void gps_picture_location(char *buffer, struct picture *pic)
 	parse_location(buffer, &pic->location);
 }
 
+static struct xml_keyword dive_keyword[] = {
+	{ "divesiteid", DIVE_DIVESITEID }, { "number", DIVE_NUMBER }, { "tags", DIVE_TAGS },
+	{ "tripflag", DIVE_TRIPFLAG }, { "date", DIVE_DATE }, { "time", DIVE_TIME }, { "datetime", DIVE_DATETIME },
+	/*
+	 * Legacy format note: per-dive depths and duration get saved
+	 * in the first dive computer entry
+	 */
+	DC_DATA_KEYWORDS,
+	{ "filename.picture", DIVE_PICTURE_FILENAME }, { "offset.picture", DIVE_PICTURE_OFFSET },
+	{ "gps.picture", DIVE_PICTURE_GPS }, { "hash.picture", DIVE_PICTURE_HASH },
+	{ "cylinderstartpressure", DIVE_CYLINDER_START }, { "cylinderendpressure", DIVE_CYLINDER_END },
+	{ "gps", DIVE_GPS }, { "Place", DIVE_GPS }, { "latitude", DIVE_LAT }, { "sitelat", DIVE_LAT },
+	{ "lat", DIVE_LAT }, { "longitude", DIVE_LONG }, { "sitelon", DIVE_LONG }, { "lon", DIVE_LONG },
+	{ "location", DIVE_LOCATION }, { "name.dive", DIVE_LOCATION }, { "suit", DIVE_SUIT },
+	{ "divesuit", DIVE_SUIT }, { "notes", DIVE_NOTES }, { "divemaster", DIVE_DIVEMASTER },
+	{ "buddy", DIVE_BUDDY }, { "watersalinity", DIVE_WATERSALINITY }, { "rating.dive", DIVE_RATING },
+	{ "visibility.dive", DIVE_VISIBILITY }, { "wavesize.dive", DIVE_WAVESIZE },
+	{ "current.dive", DIVE_CURRENT }, { "surge.dive", DIVE_SURGE }, { "chill.dive", DIVE_CHILL },
+	{ "airpressure.dive", DIVE_AIRPRESSURE }, { "description.weightsystem", DIVE_WEIGHT_DESCRIPTION },
+	{ "weight.weightsystem", DIVE_WEIGHT }, { "weight", DIVE_WEIGHT },
+	/* These only apply if the dive has a cylinder */
+	{ "size.cylinder", CYL_SIZE }, { "workpressure.cylinder", CYL_WORKPRESSURE },
+	{ "description.cylinder", CYL_DESCRIPTION }, { "start.cylinder", CYL_START },
+	{ "end.cylinder", CYL_END }, { "use.cylinder", CYL_USE }, { "depth.cylinder", CYL_DEPTH },
+	{ "o2", CYL_O2 }, { "o2percent", CYL_O2 }, { "n2", CYL_N2 }, { "he", CYL_HE },
+	{ "air.divetemperature", DIVE_AIRTEMP }, { "water.divetemperature", DIVE_WATERTEMP },
+	{ "invalid", DIVE_INVALID }
+};
+static struct keyword_table dive_keywords = KEYWORD_TABLE(dive_keyword);
+
+/* A cylinder keyword of a dive with at least one cylinder */
+static bool fill_cylinder(cylinder_t *cyl, int id, char *buf, struct parser_state *state)
+{
+	if (!cyl)
+		return false;
+	switch (id) {
+	case CYL_SIZE:
+		cylindersize(buf, &cyl->type.size);
+		return true;
+	case CYL_WORKPRESSURE:
+		pressure(buf, &cyl->type.workingpressure, state);
+		return true;
+	case CYL_DESCRIPTION:
+		utf8_string(buf, &cyl->type.description);
+		return true;
+	case CYL_START:
+		pressure(buf, &cyl->start, state);
+		return true;
+	case CYL_END:
+		pressure(buf, &cyl->end, state);
+		return true;
+	case CYL_USE:
+		cylinder_use(buf, &cyl->cylinder_use, state);
+		return true;
+	case CYL_DEPTH:
+		depth(buf, &cyl->depth, state);
+		return true;
+	case CYL_O2:
+		gasmix(buf, &cyl->gasmix.o2, state);
+		return true;
+	case CYL_N2:
+		gasmix_nitrogen(buf, &cyl->gasmix);
+		return true;
+	case CYL_HE:
+		gasmix(buf, &cyl->gasmix.he, state);
+		return true;
+	}
+	return false;
+}
+
 /* We're in the top-level dive xml. Try to convert whatever value to a dive value */
 static void try_to_fill_dive(struct dive *dive, const char *name, char *buf, struct parser_state *state)
 {
 	char *hash = NULL;
 	cylinder_t *cyl = dive->cylinders.nr > 0 ? get_cylinder(dive, dive->cylinders.nr - 1) : NULL;
 	pressure_t p;
+	int id;
 	start_match("dive", name, buf);
 
 	switch (state->import_source) {
@@ -1237,128 +1416,119 @@ static void try_to_fill_dive(struct dive *dive, const char *name, char *buf, str
 	default:
 		break;
 	}
-	if (MATCH_STATE("divesiteid", dive_site, dive))
-		return;
-	if (MATCH("number", get_index, &dive->number))
+	switch (id = find_xml_keyword(&dive_keywords, name)) {
+	case DIVE_DIVESITEID:
+		dive_site(buf, dive, state);
 		return;
-	if (MATCH("tags", divetags, &dive->tag_list))
+	case DIVE_NUMBER:
+		get_index(buf, &dive->number);
 		return;
-	if (MATCH("tripflag", get_notrip, &dive->notrip))
+	case DIVE_TAGS:
+		divetags(buf, &dive->tag_list);
 		return;
-	if (MATCH_STATE("date", divedate, &dive->when))
+	case DIVE_TRIPFLAG:
+		get_notrip(buf, &dive->notrip);
 		return;
-	if (MATCH_STATE("time", divetime, &dive->when))
+	case DIVE_DATE:
+		divedate(buf, &dive->when, state);
 		return;
-	if (MATCH_STATE("datetime", divedatetime, &dive->when))
+	case DIVE_TIME:
+		divetime(buf, &dive->when, state);
 		return;
-	/*
-	 * Legacy format note: per-dive depths and duration get saved
-	 * in the first dive computer entry
-	 */
-	if (match_dc_data_fields(&dive->dc, name, buf, state))
+	case DIVE_DATETIME:
+		divedatetime(buf, &dive->when, state);
 		return;
-
-	if (MATCH("filename.picture", utf8_string, &state->cur_picture.filename))
+	case DIVE_PICTURE_FILENAME:
+		utf8_string(buf, &state->cur_picture.filename);
 		return;
-	if (MATCH("offset.picture", offsettime, &state->cur_picture.offset))
+	case DIVE_PICTURE_OFFSET:
+		offsettime(buf, &state->cur_picture.offset);
 		return;
-	if (MATCH("gps.picture", gps_picture_location, &state->cur_picture))
+	case DIVE_PICTURE_GPS:
+		gps_picture_location(buf, &state->cur_picture);
 		return;
-	if (MATCH("hash.picture", utf8_string, &hash)) {
+	case DIVE_PICTURE_HASH:
 		/* Legacy -> ignore. */
+		utf8_string(buf, &hash);
 		free(hash);
 		return;
-	}
-	if (MATCH_STATE("cylinderstartpressure", pressure, &p)) {
+	case DIVE_CYLINDER_START:
+		pressure(buf, &p, state);
 		get_or_create_cylinder(dive, 0)->start = p;
 		return;
-	}
-	if (MATCH_STATE("cylinderendpressure", pressure, &p)) {
+	case DIVE_CYLINDER_END:
+		pressure(buf, &p, state);
 		get_or_create_cylinder(dive, 0)->end = p;
 		return;
-	}
-	if (MATCH_STATE("gps", gps_in_dive, dive))
-		return;
-	if (MATCH_STATE("Place", gps_in_dive, dive))
-		return;
-	if (MATCH_STATE("latitude", gps_lat, dive))
-		return;
-	if (MATCH_STATE("sitelat", gps_lat, dive))
-		return;
-	if (MATCH_STATE("lat", gps_lat, dive))
-		return;
-	if (MATCH_STATE("longitude", gps_long, dive))
+	case DIVE_GPS:
+		gps_in_dive(buf, dive, state);
 		return;
-	if (MATCH_STATE("sitelon", gps_long, dive))
+	case DIVE_LAT:
+		gps_lat(buf, dive, state);
 		return;
-	if (MATCH_STATE("lon", gps_long, dive))
+	case DIVE_LONG:
+		gps_long(buf, dive, state);
 		return;
-	if (MATCH_STATE("location", add_dive_site, dive))
+	case DIVE_LOCATION:
+		add_dive_site(buf, dive, state);
 		return;
-	if (MATCH_STATE("name.dive", add_dive_site, dive))
+	case DIVE_SUIT:
+		utf8_string(buf, &dive->suit);
 		return;
-	if (MATCH("suit", utf8_string, &dive->suit))
+	case DIVE_NOTES:
+		utf8_string(buf, &dive->notes);
 		return;
-	if (MATCH("divesuit", utf8_string, &dive->suit))
+	case DIVE_DIVEMASTER:
+		utf8_string(buf, &dive->divemaster);
 		return;
-	if (MATCH("notes", utf8_string, &dive->notes))
+	case DIVE_BUDDY:
+		utf8_string(buf, &dive->buddy);
 		return;
-	if (MATCH("divemaster", utf8_string, &dive->divemaster))
+	case DIVE_WATERSALINITY:
+		salinity(buf, &dive->user_salinity);
 		return;
-	if (MATCH("buddy", utf8_string, &dive->buddy))
+	case DIVE_RATING:
+		get_rating(buf, &dive->rating);
 		return;
-	if (MATCH("watersalinity", salinity, &dive->user_salinity))
+	case DIVE_VISIBILITY:
+		get_rating(buf, &dive->visibility);
 		return;
-	if (MATCH("rating.dive", get_rating, &dive->rating))
+	case DIVE_WAVESIZE:
+		get_rating(buf, &dive->wavesize);
 		return;
-	if (MATCH("visibility.dive", get_rating, &dive->visibility))
+	case DIVE_CURRENT:
+		get_rating(buf, &dive->current);
 		return;
-	if (MATCH("wavesize.dive", get_rating, &dive->wavesize))
+	case DIVE_SURGE:
+		get_rating(buf, &dive->surge);
 		return;
-	if (MATCH("current.dive", get_rating, &dive->current))
+	case DIVE_CHILL:
+		get_rating(buf, &dive->chill);
 		return;
-	if (MATCH("surge.dive", get_rating, &dive->surge))
+	case DIVE_AIRPRESSURE:
+		pressure(buf, &dive->surface_pressure, state);
 		return;
-	if (MATCH("chill.dive", get_rating, &dive->chill))
+	case DIVE_WEIGHT_DESCRIPTION:
+		utf8_string(buf, &dive->weightsystems.weightsystems[dive->weightsystems.nr - 1].description);
 		return;
-	if (MATCH_STATE("airpressure.dive", pressure, &dive->surface_pressure))
+	case DIVE_WEIGHT:
+		weight(buf, &dive->weightsystems.weightsystems[dive->weightsystems.nr - 1].weight, state);
 		return;
-	if (MATCH("description.weightsystem", utf8_string, &dive->weightsystems.weightsystems[dive->weightsystems.nr - 1].description))
+	case DIVE_AIRTEMP:
+		temperature(buf, &dive->airtemp, state);
 		return;
-	if (MATCH_STATE("weight.weightsystem", weight, &dive->weightsystems.weightsystems[dive->weightsystems.nr - 1].weight))
+	case DIVE_WATERTEMP:
+		temperature(buf, &dive->watertemp, state);
 		return;
-	if (MATCH_STATE("weight", weight, &dive->weightsystems.weightsystems[dive->weightsystems.nr - 1].weight))
+	case DIVE_INVALID:
+		get_bool(buf, &dive->invalid);
 		return;
-	if (cyl) {
-		if (MATCH("size.cylinder", cylindersize, &cyl->type.size))
-			return;
-		if (MATCH_STATE("workpressure.cylinder", pressure, &cyl->type.workingpressure))
-			return;
-		if (MATCH("description.cylinder", utf8_string, &cyl->type.description))
-			return;
-		if (MATCH_STATE("start.cylinder", pressure, &cyl->start))
-			return;
-		if (MATCH_STATE("end.cylinder", pressure, &cyl->end))
-			return;
-		if (MATCH_STATE("use.cylinder", cylinder_use, &cyl->cylinder_use))
-			return;
-		if (MATCH_STATE("depth.cylinder", depth, &cyl->depth))
-			return;
-		if (MATCH_STATE("o2", gasmix, &cyl->gasmix.o2))
-			return;
-		if (MATCH_STATE("o2percent", gasmix, &cyl->gasmix.o2))
-			return;
-		if (MATCH("n2", gasmix_nitrogen, &cyl->gasmix))
+	default:
+		if (fill_dc_data_field(&dive->dc, id, buf, state))
 			return;
-		if (MATCH_STATE("he", gasmix, &cyl->gasmix.he))
+		if (fill_cylinder(cyl, id, buf, state))
 			return;
 	}
-	if (MATCH_STATE("air.divetemperature", temperature, &dive->airtemp))
-		return;
-	if (MATCH_STATE("water.divetemperature", temperature, &dive->watertemp))
-		return;
-	if (MATCH("invalid", get_bool, &dive->invalid))
-		return;
 
 	nonmatch("dive", name, buf);
 }
@@ -1585,13 +1755,26 @@ static struct nesting {
 	  { NULL, }
 };
 
+/* The nesting rule of a node - the terminating entry if there is none */
+static const struct nesting *find_nesting(const char *name)
+{
+	const struct nesting *rule = nesting;
+
+	do {
+		if (!strcmp(rule->name, name))
+			break;
+		rule++;
+	} while (rule->name);
+	return rule;
+}
+
 static bool traverse(xmlNode *root, struct parser_state *state)
 {
 	xmlNode *n;
 	bool ret = true;
 
 	for (n = root; n; n = n->next) {
-		struct nesting *rule = nesting;
+		const struct nesting *rule;
 
 		if (!n->name) {
 			if ((ret = visit(n, state)) == false)
@@ -1599,12 +1782,7 @@ static bool traverse(xmlNode *root, struct parser_state *state)
 			continue;
 		}
 
-		do {
-			if (!strcmp(rule->name, (const char *)n->name))
-				break;
-			rule++;
-		} while (rule->name);
-
+		rule = find_nesting((const char *)n->name);
 		if (rule->start)
 			rule->start(state);
 		if ((ret = visit(n, state)) == false)
@@ -1629,6 +1807,111 @@ static void reset_all(struct parser_state *state)
 	state->import_source = UNKNOWN;
 }
 
+/*
+ * A node without children, like the text nodes of the xmlTextReader. These
+ * may be "compact" nodes, which store their content in the properties field,
+ * so we can't use visit().
+ */
+static bool visit_leaf(xmlNode *n, struct parser_state *state)
+{
+	const struct nesting *rule = n->name ? find_nesting((const char *)n->name) : NULL;
+
+	if (rule && rule->start)
+		rule->start(state);
+	if (!visit_one_node(n, state))
+		return false;
+	if (rule && rule->end)
+		rule->end(state);
+	return true;
+}
+
+static bool visit_attributes(xmlNode *n, struct parser_state *state)
+{
+	for (xmlAttr *p = n->properties; p; p = p->next) {
+		for (xmlNode *c = p->children; c; c = c->next) {
+			if (!visit_leaf(c, state))
+				return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * Streaming version of traverse(): the xmlTextReader builds the same nodes
+ * as xmlReadMemory(), but only keeps the ancestors of the current node and
+ * frees everything else as it goes. Thus, the memory use doesn't grow with
+ * the size of the file. The nodes are visited in the same order as by
+ * traverse() on the complete tree: start rule, attributes, children, end rule.
+ *
+ * Returns 1 if the root element needs an XSLT transformation - the caller
+ * has to use the DOM then. Nothing has been parsed in that case. Otherwise
+ * returns 0 on success and -1 on error. Like traverse(), give up if entry()
+ * fails.
+ */
+static int traverse_stream(xmlTextReaderPtr reader, struct parser_state *state)
+{
+	parser_func *end = NULL;
+	int nr_end = 0;
+	bool seen_root = false;
+	int res;
+
+	while ((res = xmlTextReaderRead(reader)) == 1) {
+		int type = xmlTextReaderNodeType(reader);
+		int depth = xmlTextReaderDepth(reader);
+		xmlNode *n = xmlTextReaderCurrentNode(reader);
+		const struct nesting *rule;
+
+		if (type == XML_READER_TYPE_DOCUMENT_TYPE || !n)
+			continue;
+		if (type == XML_READER_TYPE_END_ELEMENT) {
+			if (depth < nr_end && end[depth])
+				end[depth](state);
+			continue;
+		}
+		if (type != XML_READER_TYPE_ELEMENT) {
+			/* Like traverse(), ignore what comes before the root element */
+			if (seen_root && !visit_leaf(n, state))
+				break;
+			continue;
+		}
+
+		if (!seen_root) {
+			seen_root = true;
+			if (needs_xslt_transform(n)) {
+				free(end);
+				return 1;
+			}
+			reset_all(state);
+			dive_start(state);
+		}
+		rule = find_nesting((const char *)n->name);
+		if (rule->start)
+			rule->start(state);
+		if (!visit_one_node(n, state) || !visit_attributes(n, state))
+			break;
+		if (xmlTextReaderIsEmptyElement(reader)) {
+			if (rule->end)
+				rule->end(state);
+			continue;
+		}
+		if (depth >= nr_end) {
+			int nr = depth + 16;
+			end = realloc(end, nr * sizeof(*end));
+			if (!end)
+				exit(1);
+			memset(end + nr_end, 0, (nr - nr_end) * sizeof(*end));
+			nr_end = nr;
+		}
+		end[depth] = rule->end;
+	}
+	free(end);
+	if (!seen_root)
+		return -1;
+	dive_end(state);
+	/* res is 1 if we gave up before the end of the file */
+	return res != 0 ? -1 : 0;
+}
+
 /* divelog.de sends us xml files that claim to be iso-8859-1
  * but once we decode the HTML encoded characters they turn
  * into UTF-8 instead. So skip the incorrect encoding
@@ -1654,6 +1937,90 @@ static const char *preprocess_divelog_de(const char *buffer)
 	return buffer;
 }
 
+static bool contains_dive_site(struct dive_site **sites, int nr, const struct dive_site *ds)
+{
+	for (int i = 0; i < nr; i++) {
+		if (sites[i] == ds)
+			return true;
+	}
+	return false;
+}
+
+/* Free the dives and trips of a file that couldn't be parsed and the dive sites it created */
+static void discard_parsed_dives(struct dive_table *dives, struct trip_table *trips, struct dive_site_table *sites,
+				 struct dive_site **old_sites, int nr_old_sites)
+{
+	for (int i = 0; i < dives->nr; i++)
+		unregister_dive_from_dive_site(dives->dives[i]);
+	clear_dive_table(dives);
+	clear_trip_table(trips);
+	for (int i = sites->nr - 1; i >= 0; i--) {
+		struct dive_site *ds = sites->dive_sites[i];
+		if (!contains_dive_site(old_sites, nr_old_sites, ds))
+			delete_dive_site(ds, sites);
+	}
+}
+
+/*
+ * Stream the file if possible. Returns 1 if the file has to be parsed
+ * into a DOM, because it needs an XSLT transformation.
+ *
+ * Contrary to the DOM, the stream is parsed while it is read. Errors, such
+ * as a truncated file, are only found after the preceding dives were parsed.
+ * Therefore, the dives and trips are collected in temporary tables and only
+ * added to the tables of the caller if the whole file could be parsed. The
+ * dive sites are looked up in the table of the caller, so the dive sites that
+ * were created are removed again on error.
+ */
+static int parse_xml_stream(const char *url, const char *buffer, struct parser_state *state)
+{
+	xmlTextReaderPtr reader;
+	struct dive_table *table = state->target_table;
+	struct trip_table *trips = state->trips;
+	struct dive_table new_dives = empty_dive_table;
+	struct trip_table new_trips = empty_trip_table;
+	struct dive_site **old_sites;
+	int nr_old_sites, res, i;
+
+	/* Let the DOM path deal with the fall back to latin1 */
+	if (!xmlCheckUTF8((const xmlChar *)buffer))
+		return 1;
+
+	reader = xmlReaderForMemory(buffer, strlen(buffer), url, NULL, 0);
+	if (!reader)
+		return 1;
+
+	nr_old_sites = state->sites->nr;
+	old_sites = malloc(nr_old_sites * sizeof(*old_sites) + 1);
+	if (!old_sites)
+		exit(1);
+	memcpy(old_sites, state->sites->dive_sites, nr_old_sites * sizeof(*old_sites));
+	state->target_table = &new_dives;
+	state->trips = &new_trips;
+
+	res = traverse_stream(reader, state);
+	xmlFreeTextReader(reader);
+
+	state->target_table = table;
+	state->trips = trips;
+	if (res == 0) {
+		for (i = 0; i < new_dives.nr; i++)
+			add_to_dive_table(table, table->nr, new_dives.dives[i]);
+		for (i = 0; i < new_trips.nr; i++)
+			insert_trip(new_trips.trips[i], trips);
+	} else {
+		/* The unfinished dive and trip are freed with the parser state */
+		discard_parsed_dives(&new_dives, &new_trips, state->sites, old_sites, nr_old_sites);
+	}
+	free(new_dives.dives);
+	free(new_trips.trips);
+	free(old_sites);
+
+	if (res < 0)
+		return report_error(translate("gettextFromC", "Failed to parse '%s'"), url);
+	return res;
+}
+
 int parse_xml_buffer(const char *url, const char *buffer, int size,
 		     struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites,
 		     const char **params)
@@ -1668,6 +2035,16 @@ int parse_xml_buffer(const char *url, const char *buffer, int size,
 	state.target_table = table;
 	state.trips = trips;
 	state.sites = sites;
+
+	ret = parse_xml_stream(url, res, &state);
+	if (ret != 1) {
+		if (res != buffer)
+			free((char *)res);
+		free_parser_state(&state);
+		return ret;
+	}
+	ret = 0;
+
 	doc = xmlReadMemory(res, strlen(res), url, NULL, 0);
 	if (!doc)
 		doc = xmlReadMemory(res, strlen(res), url, "latin1", 0);
@@ -2242,24 +2619,42 @@ static struct xslt_files {
 	  { NULL, }
   };
 
-static xmlDoc *test_xslt_transforms(xmlDoc *doc, const char **params)
+/* The stylesheet for a root element - the terminating entry if there is none */
+static const struct xslt_files *find_xslt_file(xmlNode *root_element)
 {
-	struct xslt_files *info = xslt_files;
-	xmlDoc *transformed;
-	xsltStylesheetPtr xslt = NULL;
-	xmlNode *root_element = xmlDocGetRootElement(doc);
-	char *attribute;
+	const struct xslt_files *info = xslt_files;
 
 	while (info->root) {
 		if ((strcasecmp((const char *)root_element->name, info->root) == 0)) {
+			xmlChar *attribute;
+
 			if (info->attribute == NULL)
 				break;
-			else if (xmlGetProp(root_element, (const xmlChar *)info->attribute) != NULL)
+			attribute = xmlGetProp(root_element, (const xmlChar *)info->attribute);
+			if (attribute) {
+				xmlFree(attribute);
 				break;
+			}
 		}
 		info++;
 	}
+	return info;
+}
+
+static bool needs_xslt_transform(xmlNode *root_element)
+{
+	return find_xslt_file(root_element)->root != NULL;
+}
+
+static xmlDoc *test_xslt_transforms(xmlDoc *doc, const char **params)
+{
+	const struct xslt_files *info;
+	xmlDoc *transformed;
+	xsltStylesheetPtr xslt = NULL;
+	xmlNode *root_element = xmlDocGetRootElement(doc);
+	char *attribute;
 
+	info = find_xslt_file(root_element);
 	if (info->root) {
 		attribute = (char *)xmlGetProp(xmlFirstElementChild(root_element), (const xmlChar *)"name");
 		if (attribute) {
@@ -15,6 +15,7 @@
 #include "trip.h"
 #include "device.h"
 #include "gettext.h"
+#include "stringpool.h"
 
 struct dive_table dive_table;
 
@@ -371,6 +372,10 @@ void divecomputer_end(struct parser_state *state)
 {
 	if (!state->cur_dc->when)
 		state->cur_dc->when = state->cur_dive->when;
+	/* The same few dive computers are used for many dives - share their strings */
+	intern_owned_string(&state->cur_dc->model);
+	intern_owned_string(&state->cur_dc->serial);
+	intern_owned_string(&state->cur_dc->fw_version);
 	state->cur_dc = NULL;
 }
 
@@ -433,6 +438,7 @@ void add_dive_site(char *ds_name, struct dive *dive, struct parser_state *state)
 					} else {
 						newds->location = ds->location;
 					}
+					invalidate_dive_site_grids();
 					newds->notes = add_to_string(newds->notes, translate("gettextFromC", "additional name for site: %s\n"), ds->name);
 				}
 			} else if (dive->dive_site != ds) {
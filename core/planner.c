@@ -82,7 +82,7 @@ int get_cylinderid_at_time(struct dive *dive, struct divecomputer *dc, duration_
 	int cylinder_idx = 0;
 	struct event *event = dc->events;
 	while (event && event->time.seconds <= time.seconds) {
-		if (!strcmp(event->name, "gaschange"))
+		if (event->kind == EVENT_KIND_GASCHANGE)
 			cylinder_idx = get_cylinder_index(dive, event);
 		event = event->next;
 	}
@@ -114,7 +114,7 @@ static int tissue_at_end(struct deco_state *ds, struct dive *dive, struct deco_s
 	int i;
 	depth_t lastdepth = {};
 	duration_t t0 = {}, t1 = {};
-	struct gasmix gas;
+	struct gasmix gas = gasmix_invalid;
 	int surface_interval = 0;
 
 	if (!dive)
@@ -130,7 +130,7 @@ static int tissue_at_end(struct deco_state *ds, struct dive *dive, struct deco_s
 		return 0;
 	psample = sample = dc->sample;
 
-	const struct event *evdm = NULL;
+	const struct event *evdm = NULL, *evg = NULL;
 	enum divemode_t divemode = UNDEF_COMP_TYPE;
 
 	for (i = 0; i < dc->samples; i++, sample++) {
@@ -142,7 +142,7 @@ static int tissue_at_end(struct deco_state *ds, struct dive *dive, struct deco_s
 			setpoint = sample[0].setpoint;
 
 		t1 = sample->time;
-		gas = get_gasmix_at_time(dive, dc, t0);
+		gas = get_gasmix(dive, dc, t0.seconds, &evg, gas);
 		if (i > 0)
 			lastdepth = psample->depth;
 
@@ -480,24 +480,12 @@ static int *sort_stops(int *dstops, int dnr, struct gaschanges *gstops, int gnr)
 
 int ascent_velocity(int depth, int avg_depth, int bottom_time)
 {
+	struct deco_params params;
+
 	UNUSED(bottom_time);
 	/* We need to make this configurable */
-
-	/* As an example (and possibly reasonable default) this is the Tech 1 provedure according
-	 * to http://www.globalunderwaterexplorers.org/files/Standards_and_Procedures/SOP_Manual_Ver2.0.2.pdf */
-
-	if (depth * 4 > avg_depth * 3) {
-		return prefs.ascrate75;
-	} else {
-		if (depth * 2 > avg_depth) {
-			return prefs.ascrate50;
-		} else {
-			if (depth > 6000)
-				return prefs.ascratestops;
-			else
-				return prefs.ascratelast6m;
-		}
-	}
+	get_deco_params(&params);
+	return deco_ascent_velocity(&params, depth, avg_depth);
 }
 
 static void track_ascent_gas(int depth, struct dive *dive, int cylinder_id, int avg_depth, int bottom_time, bool safety_stop, enum divemode_t divemode)
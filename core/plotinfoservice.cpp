@@ -0,0 +1,351 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "plotinfoservice.h"
+#include "deco.h"
+#include "dive.h"
+#include "divelist.h"
+#include "profile.h"
+#include "qthelper.h"
+#include "sha1.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtConcurrent>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// The cache is keyed by dive id. Since dives are copied around (e.g. displayed_dive),
+// the id alone does not identify the content. Therefore, we also store a hash of
+// everything that goes into the calculation: the samples, events and cylinders of
+// the dive, the tissue loading left over from previous dives and the preferences
+// that are used by the calculation. A mismatch of the hash means a cache miss.
+struct CachedPlotInfo {
+	unsigned char hash[20];
+	unsigned long lastUse;
+	struct plot_info pi;
+};
+
+static QMutex cacheLock;
+static std::unordered_map<int, CachedPlotInfo> plotInfoCache;
+static unsigned long useCounter;
+
+// Bumped when the results of running calculate_plot_info_async() jobs must be thrown away
+static std::atomic<unsigned int> jobGeneration;
+
+static void hashInt(SHA_CTX &ctx, int i)
+{
+	SHA1_Update(&ctx, &i, sizeof(i));
+}
+
+static void hashString(SHA_CTX &ctx, const char *s)
+{
+	if (s)
+		SHA1_Update(&ctx, s, strlen(s));
+	hashInt(ctx, 0);
+}
+
+// The deco parameters are those in effect, which differ from the preferences in the planner.
+// The deco calculation only reads those, the rest of the calculation reads the preferences.
+static void hashPrefs(SHA_CTX &ctx, const struct deco_params &params)
+{
+	SHA1_Update(&ctx, &params.gf_low, sizeof(params.gf_low));
+	SHA1_Update(&ctx, &params.gf_high, sizeof(params.gf_high));
+	hashInt(ctx, params.vpmb_conservatism);
+	hashInt(ctx, params.mode);
+	hashInt(ctx, params.calcceiling3m);
+	hashInt(ctx, params.calcndltts);
+	hashInt(ctx, params.analyticndltts);
+	hashInt(ctx, params.ascrate75);
+	hashInt(ctx, params.ascrate50);
+	hashInt(ctx, params.ascratestops);
+	hashInt(ctx, params.ascratelast6m);
+	hashInt(ctx, params.bottomsac);
+	hashInt(ctx, params.decosac);
+	hashInt(ctx, prefs.o2consumption);
+	hashInt(ctx, prefs.pscr_ratio);
+	hashInt(ctx, prefs.bestmixend.mm);
+	SHA1_Update(&ctx, &prefs.modpO2, sizeof(prefs.modpO2));
+}
+
+static void hashDiveComputer(SHA_CTX &ctx, const struct divecomputer *dc)
+{
+	hashInt(ctx, dc->divemode);
+	hashInt(ctx, dc->no_o2sensors);
+	hashInt(ctx, dc->salinity);
+	hashInt(ctx, dc->surface_pressure.mbar);
+	hashInt(ctx, dc->duration.seconds);
+	hashInt(ctx, dc->maxdepth.mm);
+	hashInt(ctx, dc->meandepth.mm);
+	hashInt(ctx, dc->samples);
+	for (int i = 0; i < dc->samples; i++) {
+		const struct sample *s = dc->sample + i;
+		hashInt(ctx, s->time.seconds);
+		hashInt(ctx, s->depth.mm);
+		hashInt(ctx, s->temperature.mkelvin);
+		hashInt(ctx, s->stoptime.seconds);
+		hashInt(ctx, s->stopdepth.mm);
+		hashInt(ctx, s->ndl.seconds);
+		hashInt(ctx, s->tts.seconds);
+		hashInt(ctx, s->rbt.seconds);
+		hashInt(ctx, s->cns);
+		hashInt(ctx, s->in_deco);
+		hashInt(ctx, s->setpoint.mbar);
+		hashInt(ctx, s->heartbeat);
+		hashInt(ctx, s->bearing.degrees);
+		hashInt(ctx, s->sac.mliter);
+		for (int j = 0; j < MAX_SENSORS; j++) {
+			hashInt(ctx, s->pressure[j].mbar);
+			hashInt(ctx, s->sensor[j]);
+		}
+		for (int j = 0; j < 3; j++)
+			hashInt(ctx, s->o2sensor[j].mbar);
+	}
+	for (const struct event *ev = dc->events; ev; ev = ev->next) {
+		hashInt(ctx, ev->time.seconds);
+		hashInt(ctx, ev->type);
+		hashInt(ctx, ev->flags);
+		hashInt(ctx, ev->value);
+		hashInt(ctx, ev->deleted);
+		hashString(ctx, ev->name);
+		if (event_is_gaschange(ev)) {
+			hashInt(ctx, ev->gas.index);
+			hashInt(ctx, ev->gas.mix.o2.permille);
+			hashInt(ctx, ev->gas.mix.he.permille);
+		}
+	}
+}
+
+// If ds_out is non-null, the tissue loading at the start of the dive is returned there
+static void calculateHash(struct dive *dive, unsigned char hash[20], struct deco_state *ds_out = nullptr)
+{
+	SHA_CTX ctx;
+	struct deco_state ds;
+
+	// Residual tissue loading of previous dives
+	init_decompression(&ds, dive);
+	if (ds_out)
+		*ds_out = ds;
+
+	SHA1_Init(&ctx);
+	hashPrefs(ctx, ds.params);
+	SHA1_Update(&ctx, ds.tissue_n2_sat, sizeof(ds.tissue_n2_sat));
+	SHA1_Update(&ctx, ds.tissue_he_sat, sizeof(ds.tissue_he_sat));
+
+	SHA1_Update(&ctx, &dive->when, sizeof(dive->when));
+	hashInt(ctx, dive->surface_pressure.mbar);
+	hashInt(ctx, dive->salinity);
+	hashInt(ctx, dive->user_salinity);
+	hashInt(ctx, dive->maxdepth.mm);
+	hashInt(ctx, dive->cylinders.nr);
+	for (int i = 0; i < dive->cylinders.nr; i++) {
+		const cylinder_t *cyl = get_cylinder(dive, i);
+		hashInt(ctx, cyl->type.size.mliter);
+		hashInt(ctx, cyl->type.workingpressure.mbar);
+		hashInt(ctx, cyl->gasmix.o2.permille);
+		hashInt(ctx, cyl->gasmix.he.permille);
+		hashInt(ctx, cyl->start.mbar);
+		hashInt(ctx, cyl->end.mbar);
+		hashInt(ctx, cyl->sample_start.mbar);
+		hashInt(ctx, cyl->sample_end.mbar);
+		hashInt(ctx, cyl->cylinder_use);
+	}
+	// Secondary dive computers can provide sensor data for the first one
+	for (const struct divecomputer *dc = &dive->dc; dc; dc = dc->next)
+		hashDiveComputer(ctx, dc);
+	SHA1_Final(hash, &ctx);
+}
+
+// Copy the profile data, but not the deco checkpoints, which belong to the source
+static void copyPlotInfo(struct plot_info *dst, const struct plot_info *src)
+{
+	free_plot_info_data(dst);
+	*dst = *src;
+	dst->nr_deco_checkpoints = 0;
+	dst->deco_checkpoints = NULL;
+	dst->entry = (struct plot_data *)malloc(src->nr * sizeof(struct plot_data));
+	memcpy(dst->entry, src->entry, src->nr * sizeof(struct plot_data));
+	dst->pressures = (struct plot_pressure_data *)malloc(src->nr * src->nr_cylinders * sizeof(struct plot_pressure_data));
+	memcpy(dst->pressures, src->pressures, src->nr * src->nr_cylinders * sizeof(struct plot_pressure_data));
+	if (src->tissues) {
+		dst->tissues = (struct plot_tissue_data *)malloc(src->nr * sizeof(struct plot_tissue_data));
+		memcpy(dst->tissues, src->tissues, src->nr * sizeof(struct plot_tissue_data));
+	}
+}
+
+// Must be called with the cache locked
+static void evictOldest()
+{
+	auto oldest = plotInfoCache.begin();
+	for (auto it = plotInfoCache.begin(); it != plotInfoCache.end(); ++it) {
+		if (it->second.lastUse < oldest->second.lastUse)
+			oldest = it;
+	}
+	if (oldest != plotInfoCache.end()) {
+		free_plot_info_data(&oldest->second.pi);
+		plotInfoCache.erase(oldest);
+	}
+}
+
+// Return true and fill pi (if non-null) if there is a valid cache entry
+static bool lookup(int id, const unsigned char hash[20], struct plot_info *pi)
+{
+	QMutexLocker l(&cacheLock);
+	auto it = plotInfoCache.find(id);
+	if (it == plotInfoCache.end() || memcmp(it->second.hash, hash, 20))
+		return false;
+	it->second.lastUse = ++useCounter;
+	if (pi)
+		copyPlotInfo(pi, &it->second.pi);
+	return true;
+}
+
+// Takes ownership of the data in pi
+static void insert(int id, const unsigned char hash[20], struct plot_info *pi)
+{
+	QMutexLocker l(&cacheLock);
+	auto it = plotInfoCache.find(id);
+	if (it != plotInfoCache.end()) {
+		free_plot_info_data(&it->second.pi);
+	} else {
+		while (plotInfoCache.size() >= PLOT_INFO_CACHE_SIZE)
+			evictOldest();
+		it = plotInfoCache.emplace(id, CachedPlotInfo()).first;
+	}
+	memcpy(it->second.hash, hash, 20);
+	it->second.lastUse = ++useCounter;
+	it->second.pi = *pi;
+}
+
+// Takes ownership of the data in res
+static void store(int id, const unsigned char hash[20], struct plot_info *res, struct plot_info *pi)
+{
+	// The checkpoints are only useful for recalculating edited profiles
+	free(res->deco_checkpoints);
+	res->deco_checkpoints = NULL;
+	res->nr_deco_checkpoints = 0;
+	if (pi)
+		copyPlotInfo(pi, res);
+	insert(id, hash, res);
+}
+
+// Doesn't access the dive table: ds is the tissue loading at the start of the dive,
+// which also carries the deco parameters (struct deco_params)
+static void calculate(struct dive *dive, const unsigned char hash[20], const struct deco_state *ds, struct plot_info *pi)
+{
+	struct plot_info res;
+
+	init_plot_info(&res);
+	create_plot_info_with_deco_state(dive, &dive->dc, &res, false, ds, nullptr);
+	store(dive->id, hash, &res, pi);
+}
+
+extern "C" void get_plot_info(struct dive *dive, struct plot_info *pi)
+{
+	unsigned char hash[20];
+	struct deco_state ds;
+
+	calculateHash(dive, hash, &ds);
+	if (!lookup(dive->id, hash, pi))
+		calculate(dive, hash, &ds, pi);
+}
+
+extern "C" void precalculate_plot_info(struct dive **dives, int nr)
+{
+	struct Job {
+		struct dive *dive;
+		unsigned char hash[20];
+		struct deco_state ds;
+	};
+	std::vector<Job> todo;
+
+	// Everything that depends on other dives (the dive table, the cached tissue loading
+	// of previous dives) or on the global deco parameters is collected here, on the calling
+	// thread. The workers only read their dive, its initial deco state, which also carries
+	// the deco settings (struct deco_params), and a few other preferences.
+	// Must be called from the main thread: the preferences and the application state are
+	// only changed there, so they can't change while we wait for the workers.
+	for (int i = 0; i < nr; i++) {
+		Job job;
+
+		job.dive = dives[i];
+		calculateHash(job.dive, job.hash, &job.ds);
+		if (!lookup(job.dive->id, job.hash, nullptr))
+			todo.push_back(job);
+	}
+	auto fill = [](Job &job) {
+		calculate(job.dive, job.hash, &job.ds, nullptr);
+	};
+
+	// The planner changes the global deco mode and works on displayed_dive.
+	// In that case, calculate on the calling thread.
+	if (in_planner()) {
+		for (Job &job: todo)
+			fill(job);
+		return;
+	}
+	QtConcurrent::blockingMap(todo, fill);
+}
+
+bool lookup_plot_info(struct dive *dive, struct plot_info *pi)
+{
+	unsigned char hash[20];
+
+	calculateHash(dive, hash);
+	return lookup(dive->id, hash, pi);
+}
+
+QFuture<void> calculate_plot_info_async(struct dive *dive)
+{
+	struct Job {
+		unsigned char hash[20];
+		struct deco_state ds;
+		struct dive *copy;
+		unsigned int generation;
+	};
+	auto job = std::make_shared<Job>();
+
+	// Everything that depends on other dives is done here. The worker only sees its own copy.
+	// The deco mode and the deco settings are captured in job->ds (see struct deco_params),
+	// but the gas calculations still read the preferences. If the application state or the
+	// preferences change meanwhile, the result is discarded with discard_plot_info_jobs().
+	job->generation = jobGeneration;
+	calculateHash(dive, job->hash, &job->ds);
+	job->copy = alloc_dive();
+	copy_dive(dive, job->copy);
+
+	return QtConcurrent::run([job]() {
+		struct plot_info res;
+
+		init_plot_info(&res);
+		create_plot_info_with_deco_state(job->copy, &job->copy->dc, &res, false, &job->ds, nullptr);
+		if (job->generation == jobGeneration)
+			store(job->copy->id, job->hash, &res, nullptr);
+		else
+			free_plot_info_data(&res);
+		free_dive(job->copy);
+	});
+}
+
+void discard_plot_info_jobs()
+{
+	++jobGeneration;
+}
+
+extern "C" void invalidate_plot_info(const struct dive *dive)
+{
+	QMutexLocker l(&cacheLock);
+	auto it = plotInfoCache.find(dive->id);
+	if (it != plotInfoCache.end()) {
+		free_plot_info_data(&it->second.pi);
+		plotInfoCache.erase(it);
+	}
+}
+
+extern "C" void clear_plot_info_cache()
+{
+	QMutexLocker l(&cacheLock);
+	for (auto &it: plotInfoCache)
+		free_plot_info_data(&it.second.pi);
+	plotInfoCache.clear();
+}
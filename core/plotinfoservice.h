@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-2.0
+// A cache of per-dive profile data (struct plot_info), which can be filled for
+// many dives in parallel. Used by the exporters that need the profiles of a
+// large number of dives.
+
+#ifndef PLOTINFOSERVICE_H
+#define PLOTINFOSERVICE_H
+
+struct dive;
+struct plot_info;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Calculate the plot info of the first dive computer of the given dives on a
+// thread pool and put them into the cache. Only the last PLOT_INFO_CACHE_SIZE
+// results are kept, therefore callers should work in batches of that size.
+// Must be called from the main thread.
+#define PLOT_INFO_CACHE_SIZE 256
+extern void precalculate_plot_info(struct dive **dives, int nr);
+
+// Fill pi with the plot info of the first dive computer of the dive, using the
+// cached data if it is still valid. The old data in pi is freed, as for
+// create_plot_info_new(). Free with free_plot_info_data().
+extern void get_plot_info(struct dive *dive, struct plot_info *pi);
+
+// Called by invalidate_dive_cache(): drop the cached plot info of the dive
+extern void invalidate_plot_info(const struct dive *dive);
+extern void clear_plot_info_cache(void);
+
+#ifdef __cplusplus
+}
+
+#include <QFuture>
+
+// Fill pi (if non-null) from the cache. Returns false if the dive isn't cached.
+bool lookup_plot_info(struct dive *dive, struct plot_info *pi);
+
+// Calculate the plot info of the first dive computer of the dive on a worker thread
+// and put it into the cache. The dive is copied and the data that depends on other
+// dives is calculated before returning, so that the dive list may be changed while
+// the calculation is running. Must not be used in the planner.
+QFuture<void> calculate_plot_info_async(struct dive *dive);
+
+// Don't put the results of currently running calculate_plot_info_async() jobs into the
+// cache. Must be called when the application state (and thus the deco mode) or the
+// preferences change.
+void discard_plot_info_jobs();
+#endif
+
+#endif // PLOTINFOSERVICE_H
@@ -178,6 +178,7 @@ struct preferences {
 	bool            verbatim_plan;
 
 	// ********** TecDetails **********
+	bool                        analyticndltts; // closed-form NDL / TTS with Buehlmann
 	bool                        calcalltissues;
 	bool                        calcceiling;
 	bool                        calcceiling3m;
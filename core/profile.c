@@ -26,7 +26,6 @@
 
 #define MAX_PROFILE_DECO 7200
 
-extern int ascent_velocity(int depth, int avg_depth, int bottom_time);
 
 struct dive *current_dive = NULL;
 unsigned int dc_number = 0;
@@ -228,6 +227,71 @@ static void analyze_plot_info_minmax(struct plot_info *pi, int entry_index)
 	plot_entry->max = max;
 }
 
+/* Are the plot entries sorted by time? The sliding window passes rely on that. */
+static bool plot_entries_sorted(const struct plot_info *pi)
+{
+	int i;
+
+	for (i = 1; i < pi->nr; i++) {
+		if (pi->entry[i].sec < pi->entry[i - 1].sec)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * The same as calling analyze_plot_info_minmax() for every entry, but in
+ * one pass: when the entries are sorted by time, the 9 minute window only
+ * ever moves forward. Keep the candidates for the minimum and maximum in
+ * two monotonic queues of entry indices, the front being the current
+ * min/max. Entries are only dropped from the back for strictly smaller
+ * (larger) depths, so that ties go to the earlier entry as above.
+ */
+static void analyze_plot_info_minmax_window(struct plot_info *pi)
+{
+	struct plot_data *entry = pi->entry;
+	int nr = pi->nr;
+	int min_head = 0, min_tail = 0, max_head = 0, max_tail = 0;
+	int start = 0, end = 0;
+	int i, *minq, *maxq;
+
+	minq = malloc(2 * nr * sizeof(*minq));
+	if (!minq) {
+		for (i = 0; i < nr; i++)
+			analyze_plot_info_minmax(pi, i);
+		return;
+	}
+	maxq = minq + nr;
+
+	for (i = 0; i < nr; i++) {
+		/* Add the entries up to HALF_INTERVAL after this one... */
+		while (end < nr && entry[end].sec <= entry[i].sec + HALF_INTERVAL) {
+			int depth = entry[end].depth;
+
+			while (min_tail > min_head && entry[minq[min_tail - 1]].depth > depth)
+				min_tail--;
+			minq[min_tail++] = end;
+			while (max_tail > max_head && entry[maxq[max_tail - 1]].depth < depth)
+				max_tail--;
+			maxq[max_tail++] = end;
+			end++;
+		}
+
+		/* ...and drop the ones more than HALF_INTERVAL before it */
+		while (entry[start].sec < entry[i].sec - HALF_INTERVAL)
+			start++;
+		while (minq[min_head] < start)
+			min_head++;
+		while (maxq[max_head] < start)
+			max_head++;
+
+		entry[i].min = minq[min_head];
+		entry[i].max = maxq[max_head];
+	}
+
+	free(minq);
+}
+
 static velocity_t velocity(int speed)
 {
 	velocity_t v;
@@ -290,8 +354,12 @@ static void analyze_plot_info(struct plot_info *pi)
 	}
 
 	/* get minmax data */
-	for (i = 0; i < nr; i++)
-		analyze_plot_info_minmax(pi, i);
+	if (plot_entries_sorted(pi)) {
+		analyze_plot_info_minmax_window(pi);
+	} else {
+		for (i = 0; i < nr; i++)
+			analyze_plot_info_minmax(pi, i);
+	}
 }
 
 /*
@@ -325,10 +393,13 @@ int get_cylinder_index(const struct dive *dive, const struct event *ev)
 
 struct event *get_next_event_mutable(struct event *event, const char *name)
 {
+	enum event_kind kind;
+
 	if (!name || !*name)
 		return NULL;
+	kind = get_event_kind(name);
 	while (event) {
-		if (same_string(event->name, name))
+		if (kind != EVENT_KIND_OTHER ? event->kind == kind : same_string(event->name, name))
 			return event;
 		event = event->next;
 	}
@@ -502,8 +573,13 @@ void free_plot_info_data(struct plot_info *pi)
 {
 	free(pi->entry);
 	free(pi->pressures);
+	free(pi->tissues);
+	free(pi->deco_checkpoints);
 	pi->entry = NULL;
 	pi->pressures = NULL;
+	pi->tissues = NULL;
+	pi->deco_checkpoints = NULL;
+	pi->nr_deco_checkpoints = 0;
 }
 
 static void populate_plot_entries(struct dive *dive, struct divecomputer *dc, struct plot_info *pi)
@@ -649,11 +725,13 @@ static void populate_plot_entries(struct dive *dive, struct divecomputer *dc, st
  * Calculate the sac rate between the two plot entries 'first' and 'last'.
  *
  * Everything in between has a cylinder pressure for at least some of the cylinders.
+ * The depth pressure integrated over the time between two entries is passed in
+ * 'pressuretime', see calculate_sac_windows().
  */
-static int sac_between(struct dive *dive, struct plot_info *pi, int first, int last, const bool gases[])
+static int sac_between(struct dive *dive, struct plot_info *pi, int first, int last, const bool gases[], const double pressuretime[])
 {
 	int i, airuse;
-	double pressuretime;
+	double atmseconds;
 
 	if (first == last)
 		return 0;
@@ -679,35 +757,13 @@ static int sac_between(struct dive *dive, struct plot_info *pi, int first, int l
 		return 0;
 
 	/* Calculate depthpressure integrated over time */
-	pressuretime = 0.0;
+	atmseconds = 0.0;
 	do {
-		struct plot_data *entry = pi->entry + first;
-		struct plot_data *next = entry + 1;
-		int depth = (entry->depth + next->depth) / 2;
-		int time = next->sec - entry->sec;
-		double atm = depth_to_atm(depth, dive);
-
-		pressuretime += atm * time;
+		atmseconds += pressuretime[first];
 	} while (++first < last);
 
-	/* Turn "atmseconds" into "atmminutes" */
-	pressuretime /= 60;
-
-	/* SAC = mliter per minute */
-	return lrint(airuse / pressuretime);
-}
-
-/* Is there pressure data for all gases? */
-static bool all_pressures(struct plot_info *pi, int idx, const bool gases[])
-{
-	int i;
-
-	for (i = 0; i < pi->nr_cylinders; i++) {
-		if (gases[i] && !get_plot_pressure(pi, idx, i))
-			return false;
-	}
-
-	return true;
+	/* SAC = mliter per minute, turning "atmseconds" into "atmminutes" */
+	return lrint(airuse / (atmseconds / 60));
 }
 
 /* Which of the set of gases have pressure data? Returns false if none of them. */
@@ -724,17 +780,118 @@ static bool filter_pressures(struct plot_info *pi, int idx, const bool gases_in[
 	return has_pressure;
 }
 
+/*
+ * The limits of the windows that the momentary sac rates are averaged
+ * over, precalculated for all entries so that fill_sac() doesn't have to
+ * walk the plot entries for every single one of them.
+ */
+struct sac_windows {
+	int *surface_start;	/* last i' <= i such that i'-1 and i' are both at the surface, or 0 */
+	int *surface_end;	/* first i' >= i such that i' and i'+1 are both at the surface, or nr-1 */
+	int *time_start;	/* first entry of the run of entries not more than 30 seconds before i */
+	int *time_end;		/* last entry of the run of entries not more than 60 seconds after i */
+	int *pressure_start;	/* per cylinder: first entry of the run of pressure data containing i */
+	int *pressure_end;	/* per cylinder: last entry of the run of pressure data starting at i, or i-1 */
+	double *pressuretime;	/* depth pressure integrated over time from entry i to i+1 */
+};
+
+static void free_sac_windows(struct sac_windows *w)
+{
+	free(w->surface_start);
+	free(w->pressure_start);
+	free(w->pressuretime);
+}
+
+static bool at_surface(const struct plot_info *pi, int idx)
+{
+	return pi->entry[idx].depth < SURFACE_THRESHOLD &&
+	       pi->entry[idx + 1].depth < SURFACE_THRESHOLD;
+}
+
+static bool calculate_sac_windows(struct dive *dive, struct plot_info *pi, struct sac_windows *w)
+{
+	struct plot_data *entry = pi->entry;
+	int nr = pi->nr, nr_cylinders = pi->nr_cylinders;
+	int i, cyl, first, last;
+
+	w->surface_start = malloc(4 * nr * sizeof(int));
+	w->pressure_start = malloc(2 * nr * (size_t)nr_cylinders * sizeof(int));
+	w->pressuretime = malloc(nr * sizeof(double));
+	if (!w->surface_start || (nr_cylinders && !w->pressure_start) || !w->pressuretime) {
+		free_sac_windows(w);
+		return false;
+	}
+	w->surface_end = w->surface_start + nr;
+	w->time_start = w->surface_end + nr;
+	w->time_end = w->time_start + nr;
+	w->pressure_end = w->pressure_start + nr * nr_cylinders;
+
+	w->surface_start[0] = 0;
+	for (i = 1; i < nr; i++) {
+		int depth = (entry[i - 1].depth + entry[i].depth) / 2;
+		int time = entry[i].sec - entry[i - 1].sec;
+
+		w->surface_start[i] = at_surface(pi, i - 1) ? i : w->surface_start[i - 1];
+		w->pressuretime[i - 1] = depth_to_atm(depth, dive) * time;
+	}
+	w->pressuretime[nr - 1] = 0.0;
+	w->surface_end[nr - 1] = nr - 1;
+	for (i = nr - 2; i >= 0; i--)
+		w->surface_end[i] = at_surface(pi, i) ? i : w->surface_end[i + 1];
+
+	if (plot_entries_sorted(pi)) {
+		first = last = 0;
+		for (i = 0; i < nr; i++) {
+			while (entry[first].sec < entry[i].sec - 30)
+				first++;
+			while (last < nr - 1 && entry[last + 1].sec <= entry[i].sec + 60)
+				last++;
+			w->time_start[i] = first;
+			w->time_end[i] = last;
+		}
+	} else {
+		/* Go entry by entry, stopping at the first one out of range */
+		for (i = 0; i < nr; i++) {
+			for (first = i; first > 0 && entry[first - 1].sec >= entry[i].sec - 30; first--)
+				;
+			for (last = i; last < nr - 1 && entry[last + 1].sec <= entry[i].sec + 60; last++)
+				;
+			w->time_start[i] = first;
+			w->time_end[i] = last;
+		}
+	}
+
+	for (cyl = 0; cyl < nr_cylinders; cyl++) {
+		int *start = w->pressure_start + cyl * nr;
+		int *end = w->pressure_end + cyl * nr;
+
+		for (i = 0; i < nr; i++) {
+			if (!get_plot_pressure(pi, i, cyl))
+				start[i] = i + 1;
+			else
+				start[i] = i > 0 ? start[i - 1] : 0;
+		}
+		for (i = nr - 1; i >= 0; i--) {
+			if (!get_plot_pressure(pi, i, cyl))
+				end[i] = i - 1;
+			else
+				end[i] = i < nr - 1 ? end[i + 1] : nr - 1;
+		}
+	}
+
+	return true;
+}
+
 /*
  * Try to do the momentary sac rate for this entry, averaging over one
  * minute. This is premature optimization, but instead of allocating
  * an array of gases, the caller passes in scratch memory in the last
  * argument.
  */
-static void fill_sac(struct dive *dive, struct plot_info *pi, int idx, const bool gases_in[], bool gases[])
+static void fill_sac(struct dive *dive, struct plot_info *pi, const struct sac_windows *w, int idx, const bool gases_in[], bool gases[])
 {
 	struct plot_data *entry = pi->entry + idx;
-	int first, last;
-	int time;
+	int first, last, i;
 
 	if (entry->sac)
 		return;
@@ -748,41 +905,30 @@ static void fill_sac(struct dive *dive, struct plot_info *pi, int idx, const boo
 
 	/*
 	 * Try to go back 30 seconds to get 'first'.
-	 * Stop if the cylinder pressure data set changes.
+	 * Stop at the surface or if the cylinder pressure data set changes.
 	 */
-	first = idx;
-	time = entry->sec - 30;
-	while (idx > 0) {
-		struct plot_data *entry = pi->entry + idx;
-		struct plot_data *prev = pi->entry + idx - 1;
-
-		if (prev->depth < SURFACE_THRESHOLD && entry->depth < SURFACE_THRESHOLD)
-			break;
-		if (prev->sec < time)
-			break;
-		if (!all_pressures(pi, idx - 1, gases))
-			break;
-		idx--;
-		first = idx;
+	first = MAX(w->surface_start[idx], w->time_start[idx]);
+	for (i = 0; i < pi->nr_cylinders; i++) {
+		if (gases[i])
+			first = MAX(first, w->pressure_start[i * pi->nr + idx]);
 	}
 
-	/* Now find an entry a minute after the first one */
-	last = first;
-	time = pi->entry[first].sec + 60;
-	while (++idx < pi->nr) {
-		struct plot_data *entry = pi->entry + last;
-		struct plot_data *next = pi->entry + last + 1;
-		if (next->depth < SURFACE_THRESHOLD && entry->depth < SURFACE_THRESHOLD)
-			break;
-		if (next->sec > time)
-			break;
-		if (!all_pressures(pi, idx + 1, gases))
-			break;
-		last = idx;
+	/*
+	 * Now find an entry a minute after the first one. This has always
+	 * required pressure data in the entry after 'last', too.
+	 */
+	last = MIN(w->surface_end[first], w->time_end[first]);
+	for (i = 0; i < pi->nr_cylinders; i++) {
+		if (!gases[i])
+			continue;
+		if (first + 2 < pi->nr)
+			last = MIN(last, w->pressure_end[i * pi->nr + first + 2] - 1);
+		else
+			last = first;
 	}
 
 	/* Ok, now calculate the SAC between 'first' and 'last' */
-	entry->sac = sac_between(dive, pi, first, last, gases);
+	entry->sac = sac_between(dive, pi, first, last, gases, w->pressuretime);
 }
 
 /*
@@ -800,8 +946,12 @@ static void calculate_sac(struct dive *dive, struct divecomputer *dc, struct plo
 {
 	struct gasmix gasmix = gasmix_invalid;
 	const struct event *ev = NULL;
+	struct sac_windows windows;
 	bool *gases, *gases_scratch;
 
+	if (!pi->nr || !calculate_sac_windows(dive, pi, &windows))
+		return;
+
 	gases = calloc(pi->nr_cylinders, sizeof(*gases));
 
 	/* This might be premature optimization, but let's allocate the gas array for
@@ -816,11 +966,12 @@ static void calculate_sac(struct dive *dive, struct divecomputer *dc, struct plo
 			matching_gases(dive, newmix, gases);
 		}
 
-		fill_sac(dive, pi, i, gases, gases_scratch);
+		fill_sac(dive, pi, &windows, i, gases, gases_scratch);
 	}
 
 	free(gases);
 	free(gases_scratch);
+	free_sac_windows(&windows);
 }
 
 static void populate_secondary_sensor_data(const struct divecomputer *dc, struct plot_info *pi)
@@ -942,6 +1093,139 @@ static void setup_gas_sensor_pressure(const struct dive *dive, const struct dive
 }
 
 #ifndef SUBSURFACE_MOBILE
+/*
+ * Deco checkpoints: for Buehlmann, calculate_deco_information() saves the deco state every
+ * DECO_CHECKPOINT_INTERVAL seconds of dive time, together with a fingerprint of all inputs
+ * of the calculation up to that point. When the profile of a plot_info is recalculated
+ * (e.g. when dragging a point in the profile or editing the plan), we resume from the
+ * last checkpoint whose fingerprint still matches and copy the results for the entries
+ * before that from the previous calculation, instead of replaying the dive from the start.
+ */
+#define DECO_CHECKPOINT_INTERVAL 120
+
+struct deco_checkpoint {
+	int idx;			/* entries up to and including idx have been calculated */
+	uint64_t fingerprint;		/* of the inputs up to and including entry idx */
+	int last_ndl_tts_calc_time;
+	struct deco_state ds;
+};
+
+/* FNV-1a - we don't need anything fancy, this only has to detect changes */
+static uint64_t fingerprint_add(uint64_t fingerprint, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+
+	while (len--) {
+		fingerprint ^= *p++;
+		fingerprint *= 1099511628211ULL;
+	}
+	return fingerprint;
+}
+
+static uint64_t fingerprint_add_int(uint64_t fingerprint, int i)
+{
+	return fingerprint_add(fingerprint, &i, sizeof(i));
+}
+
+/* Fingerprint of everything that influences the deco calculation, apart from the plot entries */
+static uint64_t deco_fingerprint_start(const struct deco_state *ds, const struct dive *dive, double surface_pressure, bool print_mode)
+{
+	uint64_t fingerprint = 14695981039346656037ULL;
+
+	fingerprint = fingerprint_add(fingerprint, ds->tissue_n2_sat, sizeof(ds->tissue_n2_sat));
+	fingerprint = fingerprint_add(fingerprint, ds->tissue_he_sat, sizeof(ds->tissue_he_sat));
+	fingerprint = fingerprint_add(fingerprint, &ds->gf_low_pressure_this_dive, sizeof(ds->gf_low_pressure_this_dive));
+	fingerprint = fingerprint_add(fingerprint, &surface_pressure, sizeof(surface_pressure));
+	fingerprint = fingerprint_add_int(fingerprint, dive->salinity);
+	fingerprint = fingerprint_add(fingerprint, &ds->params.gf_low, sizeof(ds->params.gf_low));
+	fingerprint = fingerprint_add(fingerprint, &ds->params.gf_high, sizeof(ds->params.gf_high));
+	fingerprint = fingerprint_add_int(fingerprint, ds->params.vpmb_conservatism);
+	fingerprint = fingerprint_add_int(fingerprint, ds->params.calcceiling3m);
+	fingerprint = fingerprint_add_int(fingerprint, ds->params.calcndltts);
+	fingerprint = fingerprint_add_int(fingerprint, ds->params.analyticndltts);
+	fingerprint = fingerprint_add_int(fingerprint, ds->params.ascrate75);
+	fingerprint = fingerprint_add_int(fingerprint, ds->params.ascrate50);
+	fingerprint = fingerprint_add_int(fingerprint, ds->params.ascratestops);
+	fingerprint = fingerprint_add_int(fingerprint, ds->params.ascratelast6m);
+	fingerprint = fingerprint_add_int(fingerprint, ds->params.mode);
+	fingerprint = fingerprint_add_int(fingerprint, ds->params.planner);
+	fingerprint = fingerprint_add_int(fingerprint, print_mode);
+	return fingerprint;
+}
+
+static uint64_t deco_fingerprint_entry(uint64_t fingerprint, const struct plot_data *entry, struct gasmix gasmix, enum divemode_t divemode)
+{
+	fingerprint = fingerprint_add_int(fingerprint, entry->sec);
+	fingerprint = fingerprint_add_int(fingerprint, entry->depth);
+	fingerprint = fingerprint_add_int(fingerprint, entry->running_sum);
+	fingerprint = fingerprint_add_int(fingerprint, entry->o2pressure.mbar);
+	fingerprint = fingerprint_add_int(fingerprint, gasmix.o2.permille);
+	fingerprint = fingerprint_add_int(fingerprint, gasmix.he.permille);
+	return fingerprint_add_int(fingerprint, divemode);
+}
+
+static void copy_deco_results(struct plot_info *pi, int idx)
+{
+	struct plot_data *dst = pi->entry + idx;
+	const struct plot_data *src = pi->prev_entry + idx;
+
+	dst->ambpressure = src->ambpressure;
+	dst->gfline = src->gfline;
+	dst->icd_warning = src->icd_warning;
+	dst->ceiling = src->ceiling;
+	dst->ndl = src->ndl;
+	if (pi->prev_tissues)
+		pi->tissues[idx] = pi->prev_tissues[idx];
+	dst->surface_gf = src->surface_gf;
+	dst->current_gf = src->current_gf;
+	dst->in_deco_calc = src->in_deco_calc;
+	dst->ndl_calc = src->ndl_calc;
+	dst->tts_calc = src->tts_calc;
+	dst->stoptime_calc = src->stoptime_calc;
+	dst->stopdepth_calc = src->stopdepth_calc;
+}
+
+/*
+ * Find the last checkpoint of the previous calculation that is still valid for the
+ * new plot entries. Returns the index of that checkpoint or -1.
+ */
+static int find_deco_checkpoint(const struct dive *dive, const struct divecomputer *dc, const struct plot_info *pi, uint64_t fingerprint)
+{
+	int i, cp = 0, res = -1;
+	struct gasmix gasmix = gasmix_invalid;
+	const struct event *ev = NULL, *evd = NULL;
+	enum divemode_t current_divemode = UNDEF_COMP_TYPE;
+
+	if (!pi->prev_entry || !pi->nr_deco_checkpoints)
+		return -1;
+
+	for (i = 1; i < pi->nr && cp < pi->nr_deco_checkpoints; i++) {
+		const struct deco_checkpoint *checkpoint = pi->deco_checkpoints + cp;
+
+		current_divemode = get_current_divemode(dc, pi->entry[i].sec, &evd, &current_divemode);
+		gasmix = get_gasmix(dive, dc, pi->entry[i].sec, &ev, gasmix);
+		fingerprint = deco_fingerprint_entry(fingerprint, pi->entry + i, gasmix, current_divemode);
+		if (i < checkpoint->idx)
+			continue;
+		if (checkpoint->fingerprint != fingerprint || checkpoint->idx >= pi->prev_nr)
+			break;
+		res = cp++;
+	}
+	return res;
+}
+
+static void add_deco_checkpoint(struct plot_info *pi, int idx, uint64_t fingerprint, int last_ndl_tts_calc_time, const struct deco_state *ds)
+{
+	struct deco_checkpoint *checkpoint;
+
+	pi->deco_checkpoints = realloc(pi->deco_checkpoints, (pi->nr_deco_checkpoints + 1) * sizeof(struct deco_checkpoint));
+	checkpoint = pi->deco_checkpoints + pi->nr_deco_checkpoints++;
+	checkpoint->idx = idx;
+	checkpoint->fingerprint = fingerprint;
+	checkpoint->last_ndl_tts_calc_time = last_ndl_tts_calc_time;
+	checkpoint->ds = *ds;
+}
+
 /* calculate DECO STOP / TTS / NDL */
 static void calculate_ndl_tts(struct deco_state *ds, const struct dive *dive, struct plot_data *entry, struct gasmix gasmix, double surface_pressure,enum divemode_t divemode)
 {
@@ -975,7 +1259,7 @@ static void calculate_ndl_tts(struct deco_state *ds, const struct dive *dive, st
 		       ) {
 			entry->ndl_calc += time_stepsize;
 			add_segment(ds, depth_to_bar(entry->depth, dive),
-				    gasmix, time_stepsize, entry->o2pressure.mbar, divemode, prefs.bottomsac);
+				    gasmix, time_stepsize, entry->o2pressure.mbar, divemode, ds->params.bottomsac);
 		}
 		/* we don't need to calculate anything else */
 		return;
@@ -985,9 +1269,9 @@ static void calculate_ndl_tts(struct deco_state *ds, const struct dive *dive, st
 	entry->in_deco_calc = true;
 
 	/* Add segments for movement to stopdepth */
-	for (; ascent_depth > next_stop; ascent_depth -= ascent_s_per_step * ascent_velocity(ascent_depth, entry->running_sum / entry->sec, 0), entry->tts_calc += ascent_s_per_step) {
+	for (; ascent_depth > next_stop; ascent_depth -= ascent_s_per_step * deco_ascent_velocity(&ds->params, ascent_depth, entry->running_sum / entry->sec), entry->tts_calc += ascent_s_per_step) {
 		add_segment(ds, depth_to_bar(ascent_depth, dive),
-			    gasmix, ascent_s_per_step, entry->o2pressure.mbar, divemode, prefs.decosac);
+			    gasmix, ascent_s_per_step, entry->o2pressure.mbar, divemode, ds->params.decosac);
 		next_stop = ROUND_UP(deco_allowed_depth(tissue_tolerance_calc(ds, dive, depth_to_bar(ascent_depth, dive)),
 							surface_pressure, dive, 1), deco_stepsize);
 	}
@@ -1008,29 +1292,192 @@ static void calculate_ndl_tts(struct deco_state *ds, const struct dive *dive, st
 		if (entry->tts_calc > MAX_PROFILE_DECO)
 			break;
 		add_segment(ds, depth_to_bar(ascent_depth, dive),
-			    gasmix, time_stepsize, entry->o2pressure.mbar, divemode, prefs.decosac);
+			    gasmix, time_stepsize, entry->o2pressure.mbar, divemode, ds->params.decosac);
 
 		if (deco_allowed_depth(tissue_tolerance_calc(ds, dive, depth_to_bar(ascent_depth,dive)), surface_pressure, dive, 1) <= next_stop) {
 			/* move to the next stop and add the travel between stops */
-			for (; ascent_depth > next_stop; ascent_depth -= ascent_s_per_deco_step * ascent_velocity(ascent_depth, entry->running_sum / entry->sec, 0), entry->tts_calc += ascent_s_per_deco_step)
+			for (; ascent_depth > next_stop; ascent_depth -= ascent_s_per_deco_step * deco_ascent_velocity(&ds->params, ascent_depth, entry->running_sum / entry->sec), entry->tts_calc += ascent_s_per_deco_step)
 				add_segment(ds, depth_to_bar(ascent_depth, dive),
-					    gasmix, ascent_s_per_deco_step, entry->o2pressure.mbar, divemode, prefs.decosac);
+					    gasmix, ascent_s_per_deco_step, entry->o2pressure.mbar, divemode, ds->params.decosac);
 			ascent_depth = next_stop;
 			next_stop -= deco_stepsize;
 		}
 	}
 }
 
+/*
+ * The inspired inert gas pressures of the levels every 3m for the closed-form NDL / TTS. They
+ * only depend on the gas and on the setpoint, so adjacent plot entries usually share them.
+ * The stop schedule itself depends on the tissues and is solved for every entry.
+ */
+#define MAX_DECO_STOP_LEVELS 100
+
+struct deco_stop_cache {
+	bool valid;
+	struct gasmix gasmix;
+	int o2pressure;
+	enum divemode_t divemode;
+	struct deco_level level[MAX_DECO_STOP_LEVELS];
+};
+
+static const struct deco_level *get_deco_stop_levels(const struct deco_state *ds, struct deco_stop_cache *cache, const struct dive *dive,
+						     const struct plot_data *entry, struct gasmix gasmix, enum divemode_t divemode)
+{
+	int i;
+
+	if (cache->valid && same_gasmix(cache->gasmix, gasmix) && cache->o2pressure == entry->o2pressure.mbar && cache->divemode == divemode)
+		return cache->level;
+	for (i = 0; i < MAX_DECO_STOP_LEVELS; i++)
+		deco_level_init(ds, cache->level + i, depth_to_bar(i * 3000, dive), gasmix, entry->o2pressure.mbar, divemode);
+	cache->valid = true;
+	cache->gasmix = gasmix;
+	cache->o2pressure = entry->o2pressure.mbar;
+	cache->divemode = divemode;
+	return cache->level;
+}
+
+/* Ascend from 'depth' to 'to' with the ascent rates of calculate_ndl_tts(), returns the time it takes */
+static int ascend_closed_form(struct deco_state *ds, const struct dive *dive, const struct plot_data *entry, struct gasmix gasmix,
+			      enum divemode_t divemode, int depth, int to)
+{
+	struct deco_level from_level, to_level;
+	int time = 0;
+
+	deco_level_init(ds, &from_level, depth_to_bar(depth, dive), gasmix, entry->o2pressure.mbar, divemode);
+	while (depth > to) {
+		/* one leg for each ascent rate */
+		int velocity = MAX(deco_ascent_velocity(&ds->params, depth, entry->running_sum / entry->sec), 1);
+		int leg_time = 0;
+
+		do {
+			depth -= velocity;
+			leg_time++;
+		} while (depth > to && deco_ascent_velocity(&ds->params, depth, entry->running_sum / entry->sec) == velocity);
+		deco_level_init(ds, &to_level, depth_to_bar(MAX(depth, to), dive), gasmix, entry->o2pressure.mbar, divemode);
+		deco_expose_travel(ds, &from_level, &to_level, leg_time);
+		from_level = to_level;
+		time += leg_time;
+	}
+	return time;
+}
+
+/* Is there a ceiling after staying at 'here' for the given time? */
+static bool ceiling_after(const struct deco_state *ds, const struct dive *dive, const struct deco_level *here, int seconds, double surface_pressure)
+{
+	struct deco_state after = *ds;
+
+	deco_expose(&after, here, seconds);
+	return deco_allowed_depth(tissue_tolerance_calc(&after, dive, here->pressure), surface_pressure, dive, 1) > 0;
+}
+
+/*
+ * Closed-form version of calculate_ndl_tts() for Buehlmann: the NDL and the time at each stop
+ * are solved for per compartment instead of adding one minute after the other. The ascent is
+ * done in legs of 3m, checking the ceiling at the end of each. Returns false if the dive is too
+ * deep for the cached levels.
+ */
+static bool calculate_ndl_tts_closed_form(struct deco_state *ds, const struct dive *dive, struct plot_data *entry, struct gasmix gasmix,
+					  double surface_pressure, enum divemode_t divemode, struct deco_stop_cache *cache)
+{
+	const int deco_stepsize = 3000;
+	/* deco_allowed_depth() only sees a ceiling from half a mbar on */
+	const double rounding = 0.0005;
+	const struct deco_level *level;
+	int next_stop = ROUND_UP(deco_allowed_depth(
+					 tissue_tolerance_calc(ds, dive, depth_to_bar(entry->depth, dive)),
+					 surface_pressure, dive, 1), deco_stepsize);
+	int ascent_depth = entry->depth;
+
+	if (MAX(next_stop, entry->depth) >= (MAX_DECO_STOP_LEVELS - 1) * deco_stepsize)
+		return false;
+	level = get_deco_stop_levels(ds, cache, dive, entry, gasmix, divemode);
+	entry->tts_calc = 0;
+
+	if (next_stop == 0) {
+		struct deco_level here;
+		int minutes;
+
+		if (entry->depth < 3000) {
+			entry->ndl = MAX_PROFILE_DECO;
+			return true;
+		}
+		/* as in calculate_ndl_tts(), the NDL ends with the first full minute with a ceiling */
+		deco_level_init(ds, &here, depth_to_bar(entry->depth, dive), gasmix, entry->o2pressure.mbar, divemode);
+		minutes = (int)floor(deco_time_to_ceiling(ds, dive, &here, surface_pressure + rounding, MAX_PROFILE_DECO) / 60) + 1;
+
+		/* The ceiling moves the gradient factors while we wait, so check the minutes around that */
+		while (minutes < MAX_PROFILE_DECO / 60 && !ceiling_after(ds, dive, &here, minutes * 60, surface_pressure))
+			minutes++;
+		while (minutes > 1 && ceiling_after(ds, dive, &here, (minutes - 1) * 60, surface_pressure))
+			minutes--;
+		entry->ndl_calc = MIN(MAX_PROFILE_DECO, minutes * 60);
+		return true;
+	}
+
+	entry->in_deco_calc = true;
+
+	/* Ascend leg by leg as long as the ceiling stays above the end of the leg */
+	while (ascent_depth > next_stop) {
+		struct deco_state leg = *ds;
+		int to = ROUND_UP(ascent_depth, deco_stepsize) - deco_stepsize;
+		int time = ascend_closed_form(&leg, dive, entry, gasmix, divemode, ascent_depth, to);
+		int ceiling = ROUND_UP(deco_allowed_depth(tissue_tolerance_calc(&leg, dive, depth_to_bar(to, dive)),
+							  surface_pressure, dive, 1), deco_stepsize);
+
+		if (ceiling > to) {
+			/* we would have stopped on the way, at the stop above the ceiling */
+			ds->gf_low_pressure_this_dive = leg.gf_low_pressure_this_dive;
+			next_stop = MIN(ceiling, (MAX_DECO_STOP_LEVELS - 1) * deco_stepsize);
+			ascent_depth = next_stop;
+			break;
+		}
+		*ds = leg;
+		entry->tts_calc += time;
+		ascent_depth = to;
+		next_stop = ceiling;
+	}
+	ascent_depth = next_stop;
+
+	entry->stoptime_calc = 0;
+	entry->stopdepth_calc = next_stop;
+
+	/* Then stay at each stop until the ceiling is at the next one */
+	while (ascent_depth > 0) {
+		const struct deco_level *at = level + ascent_depth / deco_stepsize;
+		double limit = surface_pressure + at[-1].pressure - level[0].pressure + rounding;
+		int stoptime = MAX(1, (int)ceil(deco_time_to_clear(ds, dive, at, limit, MAX_PROFILE_DECO) / 60)) * 60;
+
+		/* like calculate_ndl_tts(), give up in the first minute beyond MAX_PROFILE_DECO */
+		if (entry->tts_calc + stoptime > MAX_PROFILE_DECO)
+			stoptime = MIN(stoptime, MAX(MAX_PROFILE_DECO - entry->tts_calc, 0) / 60 * 60 + 60);
+		if (ascent_depth == entry->stopdepth_calc)
+			entry->stoptime_calc = stoptime;
+		entry->tts_calc += stoptime;
+		if (entry->tts_calc > MAX_PROFILE_DECO)
+			break;
+		deco_expose(ds, at, stoptime);
+		entry->tts_calc += ascend_closed_form(ds, dive, entry, gasmix, divemode, ascent_depth, ascent_depth - deco_stepsize);
+		ascent_depth -= deco_stepsize;
+	}
+	return true;
+}
+
 /* Let's try to do some deco calculations.
  */
 void calculate_deco_information(struct deco_state *ds, const struct deco_state *planner_ds, const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi, bool print_mode)
 {
 	int i, count_iteration = 0;
 	double surface_pressure = (dc->surface_pressure.mbar ? dc->surface_pressure.mbar : get_surface_pressure_in_mbar(dive, true)) / 1000.0;
-	bool first_iteration = true;
-	int prev_deco_time = 10000000, time_deep_ceiling = 0;
-
-	if (!in_planner() || !planner_ds) {
+	bool first_iteration = true, cva_pass = false, done = false;
+	int time_deep_ceiling = 0, last_estimate = -1, last_deco_time = 0;
+	int first_entry = 1, resume_ndl_tts_calc_time = 0, next_checkpoint_time = DECO_CHECKPOINT_INTERVAL;
+	uint64_t fingerprint = 0;
+	struct deco_stop_cache stop_cache = { .valid = false };
+	/* Only use the settings in ds: the calculation may run in the background while they change */
+	const enum deco_mode mode = ds->params.mode;
+	const bool planner = ds->params.planner;
+
+	if (!planner || !planner_ds) {
 		ds->deco_time = 0;
 		ds->first_ceiling_pressure.mbar = 0;
 	} else {
@@ -1038,29 +1485,75 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 		ds->first_ceiling_pressure = planner_ds->first_ceiling_pressure;
 	}
 	struct deco_state *cache_data_initial = NULL;
-	lock_planner();
+	if (!pi->tissues)
+		pi->tissues = calloc(pi->nr, sizeof(*pi->tissues));
+	if (!pi->tissues)
+		return;
+	/* Outside of the planner, the calculation only reads global data and may
+	 * run concurrently for different dives (see plotinfoservice.cpp). */
+	if (planner)
+		lock_planner();
+
+	/* Resume from the last valid checkpoint. VPM-B iterates over the whole dive, so there
+	 * the state at a given time depends on the rest of the dive and we can't do that. */
+	pi->deco_resumed_entries = 0;
+	if (mode != VPMB) {
+		int cp;
+
+		fingerprint = deco_fingerprint_start(ds, dive, surface_pressure, print_mode);
+		cp = find_deco_checkpoint(dive, dc, pi, fingerprint);
+		if (cp >= 0) {
+			const struct deco_checkpoint *checkpoint = pi->deco_checkpoints + cp;
+
+			if (pi->prev_entry != pi->entry) {
+				for (i = 1; i <= checkpoint->idx; i++)
+					copy_deco_results(pi, i);
+			}
+			*ds = checkpoint->ds;
+			fingerprint = checkpoint->fingerprint;
+			first_entry = checkpoint->idx + 1;
+			pi->deco_resumed_entries = checkpoint->idx;
+			resume_ndl_tts_calc_time = checkpoint->last_ndl_tts_calc_time;
+			next_checkpoint_time = pi->entry[checkpoint->idx].sec + DECO_CHECKPOINT_INTERVAL;
+		}
+		pi->nr_deco_checkpoints = cp + 1;
+	} else {
+		pi->nr_deco_checkpoints = 0;
+	}
 	/* For VPM-B outside the planner, cache the initial deco state for CVA iterations */
-	if (decoMode() == VPMB) {
+	if (mode == VPMB) {
 		cache_deco_state(ds, &cache_data_initial);
 	}
 	/* For VPM-B outside the planner, iterate until deco time converges (usually one or two iterations after the initial)
-	 * Set maximum number of iterations to 10 just in case */
-
-	while ((abs(prev_deco_time - ds->deco_time) >= 30) && (count_iteration < 10)) {
-		int last_ndl_tts_calc_time = 0, first_ceiling = 0, current_ceiling, last_ceiling = 0, final_tts = 0 , time_clear_ceiling = 0;
-		if (decoMode() == VPMB)
+	 * Set maximum number of iterations to 10 just in case.
+	 * Only the deco time carries over from one iteration to the next, so until it has converged
+	 * we skip the NDL / TTS of the entries (cva_pass) and calculate those in one more iteration
+	 * with the final gradients. */
+
+	while (!done) {
+		int last_ndl_tts_calc_time = resume_ndl_tts_calc_time, first_ceiling = 0, current_ceiling, last_ceiling = 0, final_tts = 0 , time_clear_ceiling = 0;
+		if (mode == VPMB)
 			ds->first_ceiling_pressure.mbar = depth_to_mbar(first_ceiling, dive);
 		struct gasmix gasmix = gasmix_invalid;
 		const struct event *ev = NULL, *evd = NULL;
 		enum divemode_t current_divemode = UNDEF_COMP_TYPE;
 
-		for (i = 1; i < pi->nr; i++) {
+		for (i = first_entry; i < pi->nr; i++) {
 			struct plot_data *entry = pi->entry + i;
+			struct plot_tissue_data *tissues = pi->tissues + i;
 			int j, t0 = (entry - 1)->sec, t1 = entry->sec;
 			int time_stepsize = 20;
 
+			/* Save the state after the previous entry */
+			if (mode != VPMB && t0 >= next_checkpoint_time) {
+				add_deco_checkpoint(pi, i - 1, fingerprint, last_ndl_tts_calc_time, ds);
+				next_checkpoint_time = t0 + DECO_CHECKPOINT_INTERVAL;
+			}
+
 			current_divemode = get_current_divemode(dc, entry->sec, &evd, &current_divemode);
 			gasmix = get_gasmix(dive, dc, t1, &ev, gasmix);
+			if (mode != VPMB)
+				fingerprint = deco_fingerprint_entry(fingerprint, entry, gasmix, current_divemode);
 			entry->ambpressure = depth_to_bar(entry->depth, dive);
 			entry->gfline = get_gf(ds, entry->ambpressure, dive) * (100.0 - AMB_PERCENTAGE) + AMB_PERCENTAGE;
 			if (t0 > t1) {
@@ -1083,21 +1576,21 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 				entry->ceiling = (entry - 1)->ceiling;
 			} else {
 				/* Keep updating the VPM-B gradients until the start of the ascent phase of the dive. */
-				if (decoMode() == VPMB && last_ceiling >= first_ceiling && first_iteration == true) {
+				if (mode == VPMB && last_ceiling >= first_ceiling && first_iteration == true) {
 					nuclear_regeneration(ds, t1);
 					vpmb_start_gradient(ds);
 					/* For CVA iterations, calculate next gradient */
-					if (!first_iteration || in_planner())
+					if (!first_iteration || planner)
 						vpmb_next_gradient(ds, ds->deco_time, surface_pressure / 1000.0);
 				}
-				entry->ceiling = deco_allowed_depth(tissue_tolerance_calc(ds, dive, depth_to_bar(entry->depth, dive)), surface_pressure, dive, !prefs.calcceiling3m);
-				if (prefs.calcceiling3m)
+				entry->ceiling = deco_allowed_depth(tissue_tolerance_calc(ds, dive, depth_to_bar(entry->depth, dive)), surface_pressure, dive, !ds->params.calcceiling3m);
+				if (ds->params.calcceiling3m)
 					current_ceiling = deco_allowed_depth(tissue_tolerance_calc(ds, dive, depth_to_bar(entry->depth, dive)), surface_pressure, dive, true);
 				else
 					current_ceiling = entry->ceiling;
 				last_ceiling = current_ceiling;
 				/* If using VPM-B, take first_ceiling_pressure as the deepest ceiling */
-				if (decoMode() == VPMB) {
+				if (mode == VPMB) {
 					if  (current_ceiling >= first_ceiling ||
 					     (time_deep_ceiling == t0 && entry->depth == (entry - 1)->depth)) {
 						time_deep_ceiling = t1;
@@ -1109,7 +1602,7 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 							/* For CVA calculations, deco time = dive time remaining is a good guess,
 							   but we want to over-estimate deco_time for the first iteration so it
 							   converges correctly, so add 30min*/
-							if (!in_planner())
+							if (!planner)
 								ds->deco_time = pi->maxtime - t1 + 1800;
 							vpmb_next_gradient(ds, ds->deco_time, surface_pressure / 1000.0);
 						}
@@ -1126,9 +1619,9 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 			for (j = 0; j < 16; j++) {
 				double m_value = ds->buehlmann_inertgas_a[j] + entry->ambpressure / ds->buehlmann_inertgas_b[j];
 				double surface_m_value = ds->buehlmann_inertgas_a[j] + surface_pressure / ds->buehlmann_inertgas_b[j];
-				entry->ceilings[j] = deco_allowed_depth(ds->tolerated_by_tissue[j], surface_pressure, dive, 1);
+				tissues->ceilings[j] = deco_allowed_depth(ds->tolerated_by_tissue[j], surface_pressure, dive, 1);
 				double current_gf = (ds->tissue_inertgas_saturation[j] - entry->ambpressure) / (m_value - entry->ambpressure);
-				entry->percentages[j] = ds->tissue_inertgas_saturation[j] < entry->ambpressure ?
+				tissues->percentages[j] = ds->tissue_inertgas_saturation[j] < entry->ambpressure ?
 					lrint(ds->tissue_inertgas_saturation[j] / entry->ambpressure * AMB_PERCENTAGE) :
 					lrint(AMB_PERCENTAGE + current_gf * (100.0 - AMB_PERCENTAGE));
 				if (current_gf > entry->current_gf)
@@ -1142,8 +1635,8 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 			* We don't for print-mode because this info doesn't show up there
 			* If the ceiling hasn't cleared by the last data point, we need tts for VPM-B CVA calculation
 			* It is not necessary to do these calculation on the first VPMB iteration, except for the last data point */
-			if ((prefs.calcndltts && !print_mode && (decoMode() != VPMB || in_planner() || !first_iteration)) ||
-			    (decoMode() == VPMB && !in_planner() && i == pi->nr - 1)) {
+			if ((ds->params.calcndltts && !print_mode && (mode != VPMB || planner || (!first_iteration && !cva_pass))) ||
+			    (mode == VPMB && !planner && i == pi->nr - 1)) {
 				/* only calculate ndl/tts on every 30 seconds */
 				if ((entry->sec - last_ndl_tts_calc_time) < 30 && i != pi->nr - 1) {
 					struct plot_data *prev_entry = (entry - 1);
@@ -1158,38 +1651,57 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 				/* We are going to mess up deco state, so store it for later restore */
 				struct deco_state *cache_data = NULL;
 				cache_deco_state(ds, &cache_data);
-				calculate_ndl_tts(ds, dive, entry, gasmix, surface_pressure, current_divemode);
-				if (decoMode() == VPMB && !in_planner() && i == pi->nr - 1)
+				if (!ds->params.analyticndltts || mode == VPMB ||
+				    !calculate_ndl_tts_closed_form(ds, dive, entry, gasmix, surface_pressure, current_divemode, &stop_cache))
+					calculate_ndl_tts(ds, dive, entry, gasmix, surface_pressure, current_divemode);
+				if (mode == VPMB && !planner && i == pi->nr - 1)
 					final_tts = entry->tts_calc;
 				/* Restore "real" deco state for next real time step */
-				restore_deco_state(cache_data, ds, decoMode() == VPMB);
+				restore_deco_state(cache_data, ds, mode == VPMB);
 				free(cache_data);
 			}
 		}
-		if (decoMode() == VPMB && !in_planner()) {
-			int this_deco_time;
-			prev_deco_time = ds->deco_time;
+		if (mode == VPMB && !planner) {
+			int this_deco_time = ds->deco_time;
+			bool converged;
 			// Do we need to update deco_time?
 			if (final_tts > 0)
-				ds->deco_time = last_ndl_tts_calc_time + final_tts - time_deep_ceiling;
+				this_deco_time = last_ndl_tts_calc_time + final_tts - time_deep_ceiling;
 			else if (time_clear_ceiling > 0)
 				/* Consistent with planner, deco_time ends after ascending (20s @9m/min from 3m)
 				 * at end of whole minute after clearing ceiling. The deepest ceiling when planning a dive
 				 * comes typically 10-60s after the end of the bottom time, so add 20s to the calculated
 				 * deco time. */
-					ds->deco_time = ROUND_UP(time_clear_ceiling - time_deep_ceiling + 20, 60) + 20;
+					this_deco_time = ROUND_UP(time_clear_ceiling - time_deep_ceiling + 20, 60) + 20;
+			count_iteration ++;
+			converged = abs(this_deco_time - ds->deco_time) < 30 || count_iteration >= 10;
+			if (cva_pass && (converged || count_iteration >= 9)) {
+				/* Calculate the NDL / TTS with the gradients of this iteration */
+				cva_pass = false;
+			} else if (converged) {
+				ds->deco_time = this_deco_time;
+				done = true;
+			} else {
+				int next_deco_time = vpmb_next_deco_time(last_estimate, last_deco_time, ds->deco_time, this_deco_time);
+
+				/* The first iteration updates the gradients on the way, so its deco time isn't usable for the secant */
+				last_estimate = first_iteration ? -1 : ds->deco_time;
+				last_deco_time = this_deco_time;
+				ds->deco_time = next_deco_time;
+				cva_pass = ds->params.calcndltts && !print_mode;
+			}
 			vpmb_next_gradient(ds, ds->deco_time, surface_pressure / 1000.0);
 			final_tts = 0;
 			last_ndl_tts_calc_time = 0;
 			first_ceiling = 0;
 			first_iteration = false;
-			count_iteration ++;
 			this_deco_time = ds->deco_time;
 			restore_deco_state(cache_data_initial, ds, true);
 			ds->deco_time = this_deco_time;
 		} else {
-			// With Buhlmann iterating isn't needed.  This makes the while condition false.
-			prev_deco_time = ds->deco_time = 0;
+			// With Buhlmann iterating isn't needed.
+			ds->deco_time = 0;
+			done = true;
 		}
 	}
 
@@ -1197,7 +1709,8 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 #if DECO_CALC_DEBUG & 1
 	dump_tissues(ds);
 #endif
-	unlock_planner();
+	if (planner)
+		unlock_planner();
 }
 #endif
 
@@ -1372,16 +1885,45 @@ void init_plot_info(struct plot_info *pi)
  * info must be initialized with init_plot_info().
  */
 void create_plot_info_new(struct dive *dive, struct divecomputer *dc, struct plot_info *pi, bool fast, const struct deco_state *planner_ds)
+{
+#ifndef SUBSURFACE_MOBILE
+	struct deco_state initial_ds;
+	init_decompression(&initial_ds, dive);
+	create_plot_info_with_deco_state(dive, dc, pi, fast, &initial_ds, planner_ds);
+#else
+	create_plot_info_with_deco_state(dive, dc, pi, fast, NULL, planner_ds);
+#endif
+}
+
+/*
+ * As create_plot_info_new(), but start the deco calculation with the given tissue
+ * loading instead of calculating it from the previous dives. This does not access
+ * the dive table, so it may be run on a copy of a dive in a worker thread.
+ */
+void create_plot_info_with_deco_state(struct dive *dive, struct divecomputer *dc, struct plot_info *pi, bool fast,
+				      const struct deco_state *initial_ds, const struct deco_state *planner_ds)
 {
 	int o2, he, o2max;
 #ifndef SUBSURFACE_MOBILE
-	struct deco_state plot_deco_state;
-	init_decompression(&plot_deco_state, dive);
+	struct deco_state plot_deco_state = *initial_ds;
 #else
+	UNUSED(initial_ds);
 	UNUSED(planner_ds);
 #endif
+	/* Keep the previous results and the deco checkpoints for calculate_deco_information() */
+	struct plot_data *prev_entry = pi->entry;
+	struct plot_tissue_data *prev_tissues = pi->tissues;
+	int prev_nr = pi->nr;
+	int nr_deco_checkpoints = pi->nr_deco_checkpoints;
+	struct deco_checkpoint *deco_checkpoints = pi->deco_checkpoints;
+	pi->entry = NULL;
+	pi->tissues = NULL;
+	pi->deco_checkpoints = NULL;
 	free_plot_info_data(pi);
 	calculate_max_limits_new(dive, dc, pi);
+	/* Only now, as calculate_max_limits_new() clears the whole plot info */
+	pi->deco_checkpoints = deco_checkpoints;
+	pi->nr_deco_checkpoints = nr_deco_checkpoints;
 	get_dive_gas(dive, &o2, &he, &o2max);
 	if (dc->divemode == FREEDIVE){
 		pi->dive_type = FREEDIVE;
@@ -1398,15 +1940,23 @@ void create_plot_info_new(struct dive *dive, struct divecomputer *dc, struct plo
 
 	check_setpoint_events(dive, dc, pi);     /* Populate setpoints */
 	setup_gas_sensor_pressure(dive, dc, pi); /* Try to populate our gas pressure knowledge */
-	if (!fast) {
-		for (int cyl = 0; cyl < pi->nr_cylinders; cyl++)
-			populate_pressure_information(dive, dc, pi, cyl);
-	}
+	if (!fast)
+		populate_pressure_information(dive, dc, pi);
 	fill_o2_values(dive, dc, pi);			 /* .. and insert the O2 sensor data having 0 values. */
 	calculate_sac(dive, dc, pi);			 /* Calculate sac */
 #ifndef SUBSURFACE_MOBILE
+	pi->prev_entry = prev_entry;
+	pi->prev_tissues = prev_tissues;
+	pi->prev_nr = prev_nr;
 	calculate_deco_information(&plot_deco_state, planner_ds, dive, dc, pi, false); /* and ceiling information, using gradient factor values in Preferences) */
+	pi->prev_entry = NULL;
+	pi->prev_tissues = NULL;
+	pi->prev_nr = 0;
+#else
+	UNUSED(prev_nr);
 #endif
+	free(prev_entry);
+	free(prev_tissues);
 	calculate_gas_information_new(dive, dc, pi);	 /* Calculate gas partial pressures */
 
 #ifdef DEBUG_GAS
@@ -1559,11 +2109,12 @@ static void plot_string(const struct plot_info *pi, int idx, struct membuffer *b
 		if (entry->ceiling) {
 			depthvalue = get_depth_units(entry->ceiling, NULL, &depth_unit);
 			put_format_loc(b, translate("gettextFromC", "Calculated ceiling %.0f%s\n"), depthvalue, depth_unit);
-			if (prefs.calcalltissues) {
+			const struct plot_tissue_data *tissues = get_plot_tissue_data(pi, idx);
+			if (prefs.calcalltissues && tissues) {
 				int k;
 				for (k = 0; k < 16; k++) {
-					if (entry->ceilings[k]) {
-						depthvalue = get_depth_units(entry->ceilings[k], NULL, &depth_unit);
+					if (tissues->ceilings[k]) {
+						depthvalue = get_depth_units(tissues->ceilings[k], NULL, &depth_unit);
 						put_format_loc(b, translate("gettextFromC", "Tissue %.0fmin: %.1f%s\n"), buehlmann_N2_t_halflife[k], depthvalue, depth_unit);
 					}
 				}
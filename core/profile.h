@@ -42,8 +42,6 @@ struct plot_data {
 	/* Depth info */
 	int depth;
 	int ceiling;
-	int ceilings[16];
-	int percentages[16];
 	int ndl;
 	int tts;
 	int rbt;
@@ -80,6 +78,16 @@ struct plot_data {
 	bool icd_warning;
 };
 
+/*
+ * Per-tissue results of the deco calculation. They are only needed for the
+ * tissue graphs, the tooltip and the profile data export, so they are kept
+ * out of struct plot_data and only allocated by calculate_deco_information().
+ */
+struct plot_tissue_data {
+	int ceilings[16];
+	int percentages[16];
+};
+
 struct ev_select {
 	char *ev_name;
 	bool plot_ev;
@@ -88,6 +96,8 @@ struct ev_select {
 extern void compare_samples(struct plot_info *p1, int idx1, int idx2, char *buf, int bufsize, bool sum);
 extern void init_plot_info(struct plot_info *pi);
 extern void create_plot_info_new(struct dive *dive, struct divecomputer *dc, struct plot_info *pi, bool fast, const struct deco_state *planner_ds);
+extern void create_plot_info_with_deco_state(struct dive *dive, struct divecomputer *dc, struct plot_info *pi, bool fast,
+					     const struct deco_state *initial_ds, const struct deco_state *planner_ds);
 extern void calculate_deco_information(struct deco_state *ds, const struct deco_state *planner_de, const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi, bool print_mode);
 extern int get_plot_details_new(const struct plot_info *pi, int time, struct membuffer *);
 extern void free_plot_info_data(struct plot_info *pi);
@@ -117,6 +127,12 @@ static inline void set_plot_pressure_data(struct plot_info *pi, int idx, enum pl
 	pi->pressures[cylinder * pi->nr + idx].data[sensor] = value;
 }
 
+/* Returns NULL if no deco information was calculated for this plot info */
+static inline const struct plot_tissue_data *get_plot_tissue_data(const struct plot_info *pi, int idx)
+{
+	return pi->tissues ? pi->tissues + idx : NULL;
+}
+
 static inline int get_plot_sensor_pressure(const struct plot_info *pi, int idx, int cylinder)
 {
 	return get_plot_pressure_data(pi, idx, SENSOR_PR, cylinder);
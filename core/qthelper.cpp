@@ -39,6 +39,7 @@
 #include <QProgressDialog>	// TODO: remove with convertThumbnails()
 #include <cstdarg>
 #include <cstdint>
+#include <vector>
 
 #include <libxslt/documents.h>
 
@@ -1619,6 +1620,39 @@ extern "C" void unlock_planner()
 	planLock.unlock();
 }
 
+QMutex decoChainLock;
+
+extern "C" void lock_deco_chains()
+{
+	decoChainLock.lock();
+}
+
+extern "C" void unlock_deco_chains()
+{
+	decoChainLock.unlock();
+}
+
+QMutex errorLock;
+
+extern "C" void lock_errors()
+{
+	errorLock.lock();
+}
+
+extern "C" void unlock_errors()
+{
+	errorLock.unlock();
+}
+
+// Call fn(idx, data) for idx = 0..nr-1 on the global thread pool and wait for all calls to finish
+extern "C" void run_in_parallel(int nr, void (*fn)(int idx, void *data), void *data)
+{
+	std::vector<int> indices(nr);
+	for (int i = 0; i < nr; i++)
+		indices[i] = i;
+	QtConcurrent::blockingMap(indices, [fn, data](int idx) { fn(idx, data); });
+}
+
 char *copy_qstring(const QString &s)
 {
 	return strdup(qPrintable(s));
@@ -148,6 +148,11 @@ char *get_current_date();
 void print_qt_versions();
 void lock_planner();
 void unlock_planner();
+void lock_deco_chains();
+void unlock_deco_chains();
+void lock_errors();
+void unlock_errors();
+void run_in_parallel(int nr, void (*fn)(int idx, void *data), void *data);
 xsltStylesheetPtr get_stylesheet(const char *name);
 weight_t string_to_weight(const char *str);
 depth_t string_to_depth(const char *str);
@@ -245,7 +245,7 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 {
 	int idx;
 
-	put_format(b, "%3u:%02u", FRACTION(sample->time.seconds, 60));
+	put_min_sec(b, "", sample->time.seconds, 3, "");
 	put_milli(b, " ", sample->depth.mm, "m");
 	put_temperature(b, sample->temperature, " ", "°C");
 
@@ -284,11 +284,11 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 
 	/* the deco/ndl values are stored whenever they change */
 	if (sample->ndl.seconds != old->ndl.seconds) {
-		put_format(b, " ndl=%u:%02u", FRACTION(sample->ndl.seconds, 60));
+		put_min_sec(b, " ndl=", sample->ndl.seconds, 0, "");
 		old->ndl = sample->ndl;
 	}
 	if (sample->tts.seconds != old->tts.seconds) {
-		put_format(b, " tts=%u:%02u", FRACTION(sample->tts.seconds, 60));
+		put_min_sec(b, " tts=", sample->tts.seconds, 0, "");
 		old->tts = sample->tts;
 	}
 	if (sample->in_deco != old->in_deco) {
@@ -296,7 +296,7 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 		old->in_deco = sample->in_deco;
 	}
 	if (sample->stoptime.seconds != old->stoptime.seconds) {
-		put_format(b, " stoptime=%u:%02u", FRACTION(sample->stoptime.seconds, 60));
+		put_min_sec(b, " stoptime=", sample->stoptime.seconds, 0, "");
 		old->stoptime = sample->stoptime;
 	}
 
@@ -306,12 +306,14 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 	}
 
 	if (sample->cns != old->cns) {
-		put_format(b, " cns=%u%%", sample->cns);
+		put_string(b, " cns=");
+		put_uint(b, sample->cns, 0);
+		put_string(b, "%");
 		old->cns = sample->cns;
 	}
 
 	if (sample->rbt.seconds != old->rbt.seconds) {
-		put_format(b, " rbt=%u:%02u", FRACTION(sample->rbt.seconds, 60));
+		put_min_sec(b, " rbt=", sample->rbt.seconds, 0, "");
 		old->rbt.seconds = sample->rbt.seconds;
 	}
 
@@ -342,7 +344,7 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 		show_index(b, sample->bearing.degrees, "bearing=", "°");
 		old->bearing.degrees = sample->bearing.degrees;
 	}
-	put_format(b, "\n");
+	put_string(b, "\n");
 }
 
 static void save_samples(struct membuffer *b, struct dive *dive, struct divecomputer *dc)
@@ -472,6 +474,7 @@ static void create_dive_buffer(struct dive *dive, struct membuffer *b)
 struct dir {
 	git_treebuilder *files;
 	struct dir *subdirs, *sibling;
+	git_oid *written;	/* if set, receives the id of the written tree */
 	char unique, name[1];
 };
 
@@ -518,6 +521,7 @@ static struct dir *new_directory(git_repository *repo, struct dir *parent, struc
 	 * and an empty treebuilder list of files.
 	 */
 	subdir->subdirs = NULL;
+	subdir->written = NULL;
 	git_treebuilder_new(&subdir->files, repo, NULL);
 	memcpy(subdir->name, name, len);
 	subdir->unique = 0;
@@ -645,7 +649,7 @@ static int save_pictures(git_repository *repo, struct dir *dir, struct dive *div
 	return 0;
 }
 
-static int save_one_dive(git_repository *repo, struct dir *tree, struct dive *dive, struct tm *tm, bool cached_ok)
+static int save_one_dive(git_repository *repo, struct dir *tree, struct dive *dive, struct tm *tm, bool cached_ok, git_oid *written)
 {
 	struct divecomputer *dc;
 	struct membuffer buf = { 0 }, name = { 0 };
@@ -672,6 +676,7 @@ static int save_one_dive(git_repository *repo, struct dir *tree, struct dive *di
 
 	subdir = new_directory(repo, tree, &name);
 	subdir->unique = 1;
+	subdir->written = written;
 	free_buffer(&name);
 
 	create_dive_buffer(dive, &buf);
@@ -786,7 +791,7 @@ static void verify_shared_date(timestamp_t when, struct tm *tm)
 #define MIN_TIMESTAMP (0)
 #define MAX_TIMESTAMP (0x7fffffffffffffff)
 
-static int save_one_trip(git_repository *repo, struct dir *tree, dive_trip_t *trip, struct tm *tm, bool cached_ok)
+static int save_one_trip(git_repository *repo, struct dir *tree, dive_trip_t *trip, struct tm *tm, bool cached_ok, git_oid *dive_ids)
 {
 	int i;
 	struct dive *dive;
@@ -820,12 +825,228 @@ static int save_one_trip(git_repository *repo, struct dir *tree, dive_trip_t *tr
 	/* Save each dive in the directory */
 	for_each_dive(i, dive) {
 		if (dive->divetrip == trip)
-			save_one_dive(repo, subdir, dive, tm, cached_ok);
+			save_one_dive(repo, subdir, dive, tm, cached_ok, dive_ids ? dive_ids + i : NULL);
 	}
 
 	return 0;
 }
 
+/*
+ * Incremental saves
+ *
+ * A month directory only depends on the dives and trips saved into it.
+ * A dive that didn't change since it was loaded or saved is described by
+ * its git ID, a trip by the fields that make up its name and description.
+ * We hash that description of every month and remember the tree that we
+ * wrote for it. When saving on top of the commit of the last save, months
+ * with an unchanged description are inserted as the remembered tree and
+ * none of their trips and dives are visited. The dive site directory is
+ * cached the same way.
+ *
+ * The year and root directories are always rebuilt, so the result is
+ * the same tree as the one of a full save.
+ */
+struct cached_tree {
+	int year, mon;
+	git_oid signature, id;
+};
+
+/* The trees written by the last save, valid as long as its commit is our parent */
+static struct {
+	char *commit;
+	int nr, allocated;
+	struct cached_tree *months;
+	bool have_sites;
+	struct cached_tree sites;
+} tree_cache;
+
+struct month_tree {
+	struct cached_tree tree;
+	bool dirty, inserted;
+	struct membuffer desc;
+};
+
+struct incremental_save {
+	bool use_cache;
+	int nr, allocated;
+	struct month_tree *months;
+	bool sites_cached;
+	struct cached_tree sites;
+	git_oid *dive_ids;	/* the dive trees we wrote, indexed like the dive table */
+};
+
+static struct month_tree *get_month(struct incremental_save *inc, int year, int mon)
+{
+	struct month_tree *month;
+
+	/* The dives are sorted, so it's usually one of the last months */
+	for (int i = inc->nr - 1; i >= 0; i--) {
+		month = inc->months + i;
+		if (month->tree.year == year && month->tree.mon == mon)
+			return month;
+	}
+	if (inc->nr >= inc->allocated) {
+		inc->allocated = (inc->nr + 16) * 3 / 2;
+		inc->months = realloc(inc->months, inc->allocated * sizeof(*inc->months));
+	}
+	month = inc->months + inc->nr++;
+	memset(month, 0, sizeof(*month));
+	month->tree.year = year;
+	month->tree.mon = mon;
+	return month;
+}
+
+static void describe_dive(struct month_tree *month, struct dive *dive)
+{
+	char hex[GIT_OID_HEXSZ + 1];
+	git_oid id;
+
+	/* A changed dive has to be written out, and its month with it */
+	if (!dive_cache_is_valid(dive)) {
+		month->dirty = true;
+		return;
+	}
+	git_oid_fromraw(&id, dive->git_id);
+	git_oid_tostr(hex, sizeof(hex), &id);
+	put_format(&month->desc, "dive %lld %s\n", (long long)dive->when, hex);
+}
+
+static void describe_text(struct membuffer *b, const char *text)
+{
+	if (!text) {
+		put_string(b, "-\n");
+		return;
+	}
+	put_format(b, "%d:", (int)strlen(text));
+	put_string(b, text);
+	put_string(b, "\n");
+}
+
+/*
+ * Describe every month the way create_git_tree() saves it. Months with
+ * changed dives are marked dirty and don't get a signature.
+ */
+static void describe_months(struct incremental_save *inc)
+{
+	int i;
+	struct dive *dive;
+
+	for (i = 0; i < inc->nr; i++)
+		inc->months[i].dirty = false;
+	for (i = 0; i < trip_table.nr; ++i)
+		trip_table.trips[i]->saved = 0;
+
+	for_each_dive(i, dive) {
+		dive_trip_t *trip = dive->divetrip;
+		struct month_tree *month;
+		struct tm tm;
+
+		if (trip && trip->saved)
+			continue;
+		utc_mkdate(trip ? trip_date(trip) : dive->when, &tm);
+		month = get_month(inc, tm.tm_year, tm.tm_mon);
+		if (!trip) {
+			describe_dive(month, dive);
+			continue;
+		}
+		trip->saved = 1;
+		put_format(&month->desc, "trip %lld\n", (long long)trip_date(trip));
+		describe_text(&month->desc, trip->location);
+		describe_text(&month->desc, trip->notes);
+		for (int j = 0; j < trip->dives.nr; j++)
+			describe_dive(month, trip->dives.dives[j]);
+	}
+
+	for (i = 0; i < inc->nr; i++) {
+		struct month_tree *month = inc->months + i;
+		if (!month->dirty)
+			git_odb_hash(&month->tree.signature, month->desc.buffer, month->desc.len, GIT_OBJ_BLOB);
+		free_buffer(&month->desc);
+	}
+}
+
+static const struct cached_tree *find_cached_month(const struct cached_tree *month)
+{
+	for (int i = 0; i < tree_cache.nr; i++) {
+		const struct cached_tree *cached = tree_cache.months + i;
+		if (cached->year == month->year && cached->mon == month->mon)
+			return cached;
+	}
+	return NULL;
+}
+
+/* Find the months that we can take from the cache */
+static void prepare_incremental_save(struct incremental_save *inc)
+{
+	describe_months(inc);
+	for (int i = 0; i < inc->nr; i++) {
+		struct month_tree *month = inc->months + i;
+		const struct cached_tree *cached;
+
+		if (month->dirty)
+			continue;
+		cached = inc->use_cache ? find_cached_month(&month->tree) : NULL;
+		if (cached && git_oid_equal(&cached->signature, &month->tree.signature))
+			git_oid_cpy(&month->tree.id, &cached->id);
+		else
+			month->dirty = true;
+	}
+}
+
+static int insert_cached_month(struct dir *year, struct month_tree *month)
+{
+	char name[16];
+
+	month->inserted = true;
+	snprintf(name, sizeof(name), "%02d", month->tree.mon + 1);
+	if (tree_insert(year->files, name, 0, &month->tree.id, GIT_FILEMODE_TREE))
+		return report_error("cached month tree insert failed");
+	return 0;
+}
+
+/*
+ * After a successful commit, the dives we wrote are unchanged with respect
+ * to it, and the trees we wrote become the new cache.
+ */
+static bool is_written(const git_oid *id)
+{
+	static const unsigned char null_id[GIT_OID_RAWSZ] = { 0 };
+	return !!memcmp(id->id, null_id, GIT_OID_RAWSZ);
+}
+
+static void finish_incremental_save(struct incremental_save *inc)
+{
+	int i;
+	struct dive *dive;
+
+	for_each_dive(i, dive) {
+		if (is_written(&inc->dive_ids[i]))
+			memcpy(dive->git_id, inc->dive_ids[i].id, GIT_OID_RAWSZ);
+	}
+
+	describe_months(inc);
+	tree_cache.nr = 0;
+	for (i = 0; i < inc->nr; i++) {
+		if (inc->months[i].dirty || !is_written(&inc->months[i].tree.id))
+			continue;
+		if (tree_cache.nr >= tree_cache.allocated) {
+			tree_cache.allocated = (tree_cache.nr + 16) * 3 / 2;
+			tree_cache.months = realloc(tree_cache.months, tree_cache.allocated * sizeof(*tree_cache.months));
+		}
+		tree_cache.months[tree_cache.nr++] = inc->months[i].tree;
+	}
+	tree_cache.sites = inc->sites;
+	tree_cache.have_sites = is_written(&inc->sites.id);
+	free(tree_cache.commit);
+	tree_cache.commit = copy_string(saved_git_id);
+}
+
+static void free_incremental_save(struct incremental_save *inc)
+{
+	free(inc->months);
+	free(inc->dive_ids);
+}
+
 static void save_units(void *_b)
 {
 	struct membuffer *b =_b;
@@ -886,37 +1107,75 @@ static void save_settings(git_repository *repo, struct dir *tree)
 	blob_insert(repo, tree, &b, "00-Subsurface");
 }
 
-static void save_divesites(git_repository *repo, struct dir *tree)
+static void save_one_site(struct membuffer *b, struct dive_site *ds)
+{
+	show_utf8(b, "name ", ds->name, "\n");
+	show_utf8(b, "description ", ds->description, "\n");
+	show_utf8(b, "notes ", ds->notes, "\n");
+	put_location(b, &ds->location, "gps ", "\n");
+	for (int j = 0; j < ds->taxonomy.nr; j++) {
+		struct taxonomy *t = &ds->taxonomy.category[j];
+		if (t->category != TC_NONE && t->value) {
+			put_format(b, "geo cat %d origin %d ", t->category, t->origin);
+			show_utf8(b, "", t->value, "\n" );
+		}
+	}
+}
+
+/* Check whether the dive site directory of the last save can be reused */
+static bool describe_sites(struct incremental_save *inc)
+{
+	struct membuffer desc = { 0 };
+
+	for (int i = 0; i < dive_site_table.nr; i++) {
+		struct membuffer b = { 0 };
+		struct dive_site *ds = get_dive_site(i, &dive_site_table);
+
+		save_one_site(&b, ds);
+		put_format(&desc, "Site-%08x %u\n", ds->uuid, b.len);
+		put_bytes(&desc, b.buffer, b.len);
+		free_buffer(&b);
+	}
+	git_odb_hash(&inc->sites.signature, desc.buffer ? desc.buffer : "", desc.len, GIT_OBJ_BLOB);
+	free_buffer(&desc);
+
+	if (!inc->use_cache || !tree_cache.have_sites ||
+	    !git_oid_equal(&tree_cache.sites.signature, &inc->sites.signature))
+		return false;
+	git_oid_cpy(&inc->sites.id, &tree_cache.sites.id);
+	return true;
+}
+
+static void save_divesites(git_repository *repo, struct dir *tree, struct incremental_save *inc)
 {
 	struct dir *subdir;
 	struct membuffer dirname = { 0 };
+
+	purge_empty_dive_sites(&dive_site_table);
+	if (inc && describe_sites(inc)) {
+		if (tree_insert(tree->files, "01-Divesites", 0, &inc->sites.id, GIT_FILEMODE_TREE))
+			report_error("cached dive site tree insert failed");
+		return;
+	}
+
 	put_format(&dirname, "01-Divesites");
 	subdir = new_directory(repo, tree, &dirname);
 	free_buffer(&dirname);
+	if (inc)
+		subdir->written = &inc->sites.id;
 
-	purge_empty_dive_sites(&dive_site_table);
 	for (int i = 0; i < dive_site_table.nr; i++) {
 		struct membuffer b = { 0 };
 		struct dive_site *ds = get_dive_site(i, &dive_site_table);
 		struct membuffer site_file_name = { 0 };
 		put_format(&site_file_name, "Site-%08x", ds->uuid);
-		show_utf8(&b, "name ", ds->name, "\n");
-		show_utf8(&b, "description ", ds->description, "\n");
-		show_utf8(&b, "notes ", ds->notes, "\n");
-		put_location(&b, &ds->location, "gps ", "\n");
-		for (int j = 0; j < ds->taxonomy.nr; j++) {
-			struct taxonomy *t = &ds->taxonomy.category[j];
-			if (t->category != TC_NONE && t->value) {
-				put_format(&b, "geo cat %d origin %d ", t->category, t->origin);
-				show_utf8(&b, "", t->value, "\n" );
-			}
-		}
+		save_one_site(&b, ds);
 		blob_insert(repo, subdir, &b, mb_cstring(&site_file_name));
 		free_buffer(&site_file_name);
 	}
 }
 
-static int create_git_tree(git_repository *repo, struct dir *root, bool select_only, bool cached_ok)
+static int create_git_tree(git_repository *repo, struct dir *root, bool select_only, bool cached_ok, struct incremental_save *inc)
 {
 	int i;
 	struct dive *dive;
@@ -925,7 +1184,10 @@ static int create_git_tree(git_repository *repo, struct dir *root, bool select_o
 	git_storage_update_progress(translate("gettextFromC", "Start saving data"));
 	save_settings(repo, root);
 
-	save_divesites(repo, root);
+	save_divesites(repo, root, inc);
+
+	if (inc)
+		prepare_incremental_save(inc);
 
 	for (i = 0; i < trip_table.nr; ++i)
 		trip_table.trips[i]->saved = 0;
@@ -935,7 +1197,7 @@ static int create_git_tree(git_repository *repo, struct dir *root, bool select_o
 	for_each_dive(i, dive) {
 		struct tm tm;
 		struct dir *tree;
-
+		struct month_tree *month = NULL;
 
 		trip = dive->divetrip;
 
@@ -949,7 +1211,19 @@ static int create_git_tree(git_repository *repo, struct dir *root, bool select_o
 		/* Create the date-based hierarchy */
 		utc_mkdate(trip ? trip_date(trip) : dive->when, &tm);
 		tree = mktree(repo, root, "%04d", tm.tm_year);
+
+		/* Unchanged months are inserted as a whole */
+		if (inc) {
+			month = get_month(inc, tm.tm_year, tm.tm_mon);
+			if (!month->dirty) {
+				if (!month->inserted && insert_cached_month(tree, month))
+					return -1;
+				continue;
+			}
+		}
 		tree = mktree(repo, tree, "%02d", tm.tm_mon + 1);
+		if (month)
+			tree->written = &month->tree.id;
 
 		if (trip) {
 			/* Did we already save this trip? */
@@ -958,11 +1232,11 @@ static int create_git_tree(git_repository *repo, struct dir *root, bool select_o
 			trip->saved = 1;
 
 			/* Pass that new subdirectory in for save-trip */
-			save_one_trip(repo, tree, trip, &tm, cached_ok);
+			save_one_trip(repo, tree, trip, &tm, cached_ok, inc ? inc->dive_ids : NULL);
 			continue;
 		}
 
-		save_one_dive(repo, tree, dive, &tm, cached_ok);
+		save_one_dive(repo, tree, dive, &tm, cached_ok, inc ? inc->dive_ids + i : NULL);
 	}
 	git_storage_update_progress(translate("gettextFromC", "Done creating local cache"));
 	return 0;
@@ -1189,8 +1463,11 @@ static int write_git_tree(git_repository *repo, struct dir *tree, git_oid *resul
 	while ((subdir = tree->subdirs) != NULL) {
 		git_oid id;
 
-		if (!write_git_tree(repo, subdir, &id))
+		if (!write_git_tree(repo, subdir, &id)) {
 			tree_insert(tree->files, subdir->name, subdir->unique, &id, GIT_FILEMODE_TREE);
+			if (subdir->written)
+				git_oid_cpy(subdir->written, &id);
+		}
 		tree->subdirs = subdir->sibling;
 		free(subdir);
 	};
@@ -1214,6 +1491,7 @@ int do_git_save(git_repository *repo, const char *branch, const char *remote, bo
 	struct dir tree;
 	git_oid id;
 	bool cached_ok;
+	struct incremental_save inc = { 0 };
 
 	if (verbose)
 		SSRF_INFO("git storage: do git save\n");
@@ -1227,26 +1505,48 @@ int do_git_save(git_repository *repo, const char *branch, const char *remote, bo
 	 */
 	cached_ok = try_to_find_parent(saved_git_id, repo);
 
+	/*
+	 * Selected dive saves have a different layout, so only full saves
+	 * take part in the incremental saving. The trees of the last save
+	 * can only be reused if we are saving on top of it.
+	 */
+	if (!select_only && !create_empty) {
+		inc.use_cache = cached_ok && tree_cache.commit && same_string(tree_cache.commit, saved_git_id);
+		inc.dive_ids = calloc(dive_table.nr + 1, sizeof(*inc.dive_ids));
+	}
+
 	/* Start with an empty tree: no subdirectories, no files */
 	tree.name[0] = 0;
 	tree.subdirs = NULL;
-	if (git_treebuilder_new(&tree.files, repo, NULL))
+	tree.written = NULL;
+	if (git_treebuilder_new(&tree.files, repo, NULL)) {
+		free_incremental_save(&inc);
 		return report_error("git treebuilder failed");
+	}
 
 	if (!create_empty)
 		/* Populate our tree data structure */
-		if (create_git_tree(repo, &tree, select_only, cached_ok))
+		if (create_git_tree(repo, &tree, select_only, cached_ok, inc.dive_ids ? &inc : NULL)) {
+			free_incremental_save(&inc);
 			return -1;
+		}
 
 	if (verbose)
 		SSRF_INFO("git storage, write git tree\n");
 
-	if (write_git_tree(repo, &tree, &id))
+	if (write_git_tree(repo, &tree, &id)) {
+		free_incremental_save(&inc);
 		return report_error("git tree write failed");
+	}
 
 	/* And save the tree! */
-	if (create_new_commit(repo, remote, branch, &id, create_empty))
+	if (create_new_commit(repo, remote, branch, &id, create_empty)) {
+		free_incremental_save(&inc);
 		return report_error("creating commit failed");
+	}
+	if (inc.dive_ids)
+		finish_incremental_save(&inc);
+	free_incremental_save(&inc);
 
 	/* now sync the tree with the remote server */
 	if (remote && !git_local_only)
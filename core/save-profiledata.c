@@ -3,6 +3,7 @@
 #include "core/errorhelper.h"
 #include "core/file.h"
 #include "core/membuffer.h"
+#include "core/plotinfoservice.h"
 #include "core/subsurface-string.h"
 #include "core/save-profiledata.h"
 #include "core/version.h"
@@ -45,6 +46,7 @@ static void put_video_time(struct membuffer *b, int secs)
 static void put_pd(struct membuffer *b, const struct plot_info *pi, int idx)
 {
 	const struct plot_data *entry = pi->entry + idx;
+	const struct plot_tissue_data *tissues = get_plot_tissue_data(pi, idx);
 
 	put_int(b, entry->in_deco);
 	put_int(b,  entry->sec);
@@ -56,9 +58,9 @@ static void put_pd(struct membuffer *b, const struct plot_info *pi, int idx)
 	put_int(b, entry->depth);
 	put_int(b, entry->ceiling);
 	for (int i = 0; i < 16; i++)
-		put_int(b, entry->ceilings[i]);
+		put_int(b, tissues ? tissues->ceilings[i] : 0);
 	for (int i = 0; i < 16; i++)
-		put_int(b, entry->percentages[i]);
+		put_int(b, tissues ? tissues->percentages[i] : 0);
 	put_int(b, entry->ndl);
 	put_int(b, entry->tts);
 	put_int(b, entry->rbt);
@@ -202,34 +204,51 @@ static void put_st_event(struct membuffer *b, struct plot_data *entry, int offse
 	put_format(b, "\n");
 }
 
-static void save_profiles_buffer(struct membuffer *b, bool select_only)
+/* Calculate the profiles of a batch of dives in parallel, then write them in order */
+static void put_profiles(struct membuffer *b, struct dive **dives, int nr, struct plot_info *pi)
 {
-	int i;
+	precalculate_plot_info(dives, nr);
+	for (int i = 0; i < nr; i++) {
+		get_plot_info(dives[i], pi);
+		put_headers(b, pi->nr_cylinders);
+
+		for (int j = 0; j < pi->nr; j++)
+			put_pd(b, pi, j);
+		put_format(b, "\n");
+		free_plot_info_data(pi);
+	}
+}
+
+/* The profiles of each batch are written to "f" as soon as they are done */
+static void save_profiles_buffer(struct membuffer *b, FILE *f, bool select_only)
+{
+	int i, nr = 0;
 	struct dive *dive;
 	struct plot_info pi;
-	struct deco_state *planner_deco_state = NULL;
+	struct dive **batch = malloc(PLOT_INFO_CACHE_SIZE * sizeof(struct dive *));
 
 	init_plot_info(&pi);
 	for_each_dive(i, dive) {
 		if (select_only && !dive->selected)
 			continue;
-		create_plot_info_new(dive, &dive->dc, &pi, false, planner_deco_state);
-		put_headers(b, pi.nr_cylinders);
-
-		for (int i = 0; i < pi.nr; i++)
-			put_pd(b, &pi, i);
-		put_format(b, "\n");
-		free_plot_info_data(&pi);
+		batch[nr++] = dive;
+		if (nr == PLOT_INFO_CACHE_SIZE) {
+			put_profiles(b, batch, nr, &pi);
+			flush_chunk(b, f, 0);
+			nr = 0;
+		}
 	}
+	if (nr)
+		put_profiles(b, batch, nr, &pi);
+	free(batch);
 }
 
 void save_subtitles_buffer(struct membuffer *b, struct dive *dive, int offset, int length)
 {
 	struct plot_info pi;
-	struct deco_state *planner_deco_state = NULL;
 
 	init_plot_info(&pi);
-	create_plot_info_new(dive, &dive->dc, &pi, false, planner_deco_state);
+	get_plot_info(dive, &pi);
 
 	put_format(b, "[Script Info]\n");
 	put_format(b, "; Script generated by Subsurface %s\n", subsurface_canonical_version());
@@ -252,8 +271,6 @@ int save_profiledata(const char *filename, bool select_only)
 	FILE *f;
 	int error = 0;
 
-	save_profiles_buffer(&buf, select_only);
-
 	if (same_string(filename, "-")) {
 		f = stdout;
 	} else {
@@ -261,6 +278,7 @@ int save_profiledata(const char *filename, bool select_only)
 		f = subsurface_fopen(filename, "w");
 	}
 	if (f) {
+		save_profiles_buffer(&buf, f, select_only);
 		flush_buffer(&buf, f);
 		error = fclose(f);
 	}
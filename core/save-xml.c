@@ -235,7 +235,7 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 {
 	int idx;
 
-	put_format(b, "  <sample time='%u:%02u min'", FRACTION(sample->time.seconds, 60));
+	put_min_sec(b, "  <sample time='", sample->time.seconds, 0, " min'");
 	put_milli(b, " depth='", sample->depth.mm, " m'");
 	if (sample->temperature.mkelvin && sample->temperature.mkelvin != old->temperature.mkelvin) {
 		put_temperature(b, sample->temperature, " temp='", " C'");
@@ -274,15 +274,15 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 
 	/* the deco/ndl values are stored whenever they change */
 	if (sample->ndl.seconds != old->ndl.seconds) {
-		put_format(b, " ndl='%u:%02u min'", FRACTION(sample->ndl.seconds, 60));
+		put_min_sec(b, " ndl='", sample->ndl.seconds, 0, " min'");
 		old->ndl = sample->ndl;
 	}
 	if (sample->tts.seconds != old->tts.seconds) {
-		put_format(b, " tts='%u:%02u min'", FRACTION(sample->tts.seconds, 60));
+		put_min_sec(b, " tts='", sample->tts.seconds, 0, " min'");
 		old->tts = sample->tts;
 	}
 	if (sample->rbt.seconds != old->rbt.seconds) {
-		put_format(b, " rbt='%u:%02u min'", FRACTION(sample->rbt.seconds, 60));
+		put_min_sec(b, " rbt='", sample->rbt.seconds, 0, " min'");
 		old->rbt = sample->rbt;
 	}
 	if (sample->in_deco != old->in_deco) {
@@ -290,7 +290,7 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 		old->in_deco = sample->in_deco;
 	}
 	if (sample->stoptime.seconds != old->stoptime.seconds) {
-		put_format(b, " stoptime='%u:%02u min'", FRACTION(sample->stoptime.seconds, 60));
+		put_min_sec(b, " stoptime='", sample->stoptime.seconds, 0, " min'");
 		old->stoptime = sample->stoptime;
 	}
 
@@ -300,7 +300,9 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 	}
 
 	if (sample->cns != old->cns) {
-		put_format(b, " cns='%u%%'", sample->cns);
+		put_string(b, " cns='");
+		put_uint(b, sample->cns, 0);
+		put_string(b, "%'");
 		old->cns = sample->cns;
 	}
 
@@ -331,7 +333,7 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 		show_index(b, sample->bearing.degrees, "bearing='", "'");
 		old->bearing.degrees = sample->bearing.degrees;
 	}
-	put_format(b, " />\n");
+	put_string(b, " />\n");
 }
 
 static void save_one_event(struct membuffer *b, struct dive *dive, struct event *ev)
@@ -609,7 +611,13 @@ int save_dives(const char *filename)
 	return save_dives_logic(filename, false, false);
 }
 
-static void save_dives_buffer(struct membuffer *b, bool select_only, bool anonymize)
+#define SAVE_CHUNK_SIZE (64 * 1024)
+
+/*
+ * If "f" is given, the output is written to it chunk by chunk
+ * while saving, so that memory use doesn't grow with the log.
+ */
+static void save_dives_buffer(struct membuffer *b, FILE *f, bool select_only, bool anonymize)
 {
 	int i;
 	struct dive *dive;
@@ -659,6 +667,7 @@ static void save_dives_buffer(struct membuffer *b, bool select_only, bool anonym
 
 	/* save the dives */
 	for_each_dive(i, dive) {
+		flush_chunk(b, f, SAVE_CHUNK_SIZE);
 		if (select_only) {
 
 			if (!dive->selected)
@@ -755,8 +764,6 @@ int save_dives_logic(const char *filename, const bool select_only, bool anonymiz
 	if (git)
 		return git_save_dives(git, branch, remote, select_only);
 
-	save_dives_buffer(&buf, select_only, anonymize);
-
 	if (same_string(filename, "-")) {
 		f = stdout;
 	} else {
@@ -765,6 +772,7 @@ int save_dives_logic(const char *filename, const bool select_only, bool anonymiz
 		f = subsurface_fopen(filename, "w");
 	}
 	if (f) {
+		save_dives_buffer(&buf, f, select_only, anonymize);
 		flush_buffer(&buf, f);
 		error = fclose(f);
 	}
@@ -794,7 +802,7 @@ int export_dives_xslt(const char *filename, const bool selected, const int units
 		return report_error("No filename for export");
 
 	/* Save XML to file and convert it into a memory buffer */
-	save_dives_buffer(&buf, selected, anonymize);
+	save_dives_buffer(&buf, NULL, selected, anonymize);
 
 	/*
 	 * Parse the memory buffer into XML document and
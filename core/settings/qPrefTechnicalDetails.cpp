@@ -14,6 +14,7 @@ qPrefTechnicalDetails *qPrefTechnicalDetails::instance()
 
 void qPrefTechnicalDetails::loadSync(bool doSync)
 {
+	disk_analyticndltts(doSync);
 	disk_calcalltissues(doSync);
 	disk_calcceiling(doSync);
 	disk_calcceiling3m(doSync);
@@ -41,6 +42,8 @@ void qPrefTechnicalDetails::loadSync(bool doSync)
 	disk_zoomed_plot(doSync);
 }
 
+HANDLE_PREFERENCE_BOOL(TechnicalDetails, "analyticndltts", analyticndltts);
+
 HANDLE_PREFERENCE_BOOL(TechnicalDetails, "calcalltissues", calcalltissues);
 
 HANDLE_PREFERENCE_BOOL(TechnicalDetails, "calcceiling", calcceiling);
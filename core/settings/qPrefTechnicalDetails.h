@@ -7,6 +7,7 @@
 
 class qPrefTechnicalDetails : public QObject {
 	Q_OBJECT
+	Q_PROPERTY(bool analyticndltts READ analyticndltts WRITE set_analyticndltts NOTIFY analyticndlttsChanged)
 	Q_PROPERTY(bool calcalltissues READ calcalltissues WRITE set_calcalltissues NOTIFY calcalltissuesChanged)
 	Q_PROPERTY(bool calcceiling READ calcceiling WRITE set_calcceiling NOTIFY calcceilingChanged)
 	Q_PROPERTY(bool calcceiling3m READ calcceiling3m WRITE set_calcceiling3m NOTIFY calcceiling3mChanged)
@@ -43,6 +44,7 @@ public:
 	static void sync() { loadSync(true); }
 
 public:
+	static bool analyticndltts() { return prefs.analyticndltts; }
 	static bool calcalltissues() { return prefs.calcalltissues; }
 	static bool calcceiling() { return prefs.calcceiling; }
 	static bool calcceiling3m() { return prefs.calcceiling3m; }
@@ -71,6 +73,7 @@ public:
 	static bool zoomed_plot() { return prefs.zoomed_plot; }
 
 public slots:
+	static void set_analyticndltts(bool value);
 	static void set_calcalltissues(bool value);
 	static void set_calcceiling(bool value);
 	static void set_calcceiling3m(bool value);
@@ -99,6 +102,7 @@ public slots:
 	static void set_zoomed_plot(bool value);
 
 signals:
+	void analyticndlttsChanged(bool value);
 	void calcalltissuesChanged(bool value);
 	void calcceilingChanged(bool value);
 	void calcceiling3mChanged(bool value);
@@ -129,6 +133,7 @@ signals:
 private:
 	qPrefTechnicalDetails() {}
 
+	static void disk_analyticndltts(bool doSync);
 	static void disk_calcalltissues(bool doSync);
 	static void disk_calcceiling(bool doSync);
 	static void disk_calcceiling3m(bool doSync);
@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "stringpool.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <stdlib.h>
+
+// The elements of an unordered_set don't move, so the pointers returned by
+// c_str() stay valid as long as the string isn't removed - i.e. forever.
+static std::mutex poolLock;
+static std::unordered_set<std::string> pool;
+static std::unordered_set<const char *> pooledPointers;
+
+extern "C" const char *intern_string(const char *s)
+{
+	if (!s)
+		return nullptr;
+	std::lock_guard<std::mutex> lock(poolLock);
+	const char *res = pool.emplace(s).first->c_str();
+	pooledPointers.insert(res);
+	return res;
+}
+
+extern "C" int is_interned_string(const char *s)
+{
+	if (!s)
+		return 0;
+	std::lock_guard<std::mutex> lock(poolLock);
+	return pooledPointers.count(s) > 0;
+}
+
+extern "C" void free_unless_interned(const char *s)
+{
+	if (s && !is_interned_string(s))
+		free((void *)s);
+}
+
+extern "C" void intern_owned_string(const char **s)
+{
+	const char *old = *s;
+	*s = intern_string(old);
+	free_unless_interned(old);
+}
@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: GPL-2.0
+// A global pool of immutable strings. Strings that are repeated across many
+// dives, such as the model, serial number and firmware version of dive
+// computers, are stored only once. Interned strings live until the end of
+// the program and must never be freed. Fields that may hold either an
+// interned or an owned string are released with free_unless_interned().
+// All functions may be called from any thread.
+
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns the pooled copy of s. Equal strings give the same pointer. NULL gives NULL.
+extern const char *intern_string(const char *s);
+extern int is_interned_string(const char *s);
+extern void free_unless_interned(const char *s);
+// Replace an owned string by its pooled copy and free the original
+extern void intern_owned_string(const char **s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STRINGPOOL_H
@@ -36,6 +36,7 @@ struct preferences default_prefs = {
 	.calcceiling = false,
 	.calcceiling3m = false,
 	.calcndltts = false,
+	.analyticndltts = false,
 	.decoinfo = true,
 	.gflow = 30,
 	.gfhigh = 75,
@@ -23,16 +23,20 @@
 	}
 
 /* get the index where we want to insert an object so that everything stays
- * ordered according to a comparison function() */
+ * ordered according to a comparison function(). Objects that compare equal
+ * are inserted after the existing ones. */
 #define MAKE_GET_INSERTION_INDEX(table_type, item_type, array_name, fun)		\
 	int table_type##_get_insertion_index(struct table_type *table, item_type item)	\
 	{										\
-		/* we might want to use binary search here */				\
-		for (int i = 0; i < table->nr; i++) {					\
-			if (fun(item, table->array_name[i]))				\
-				return i;						\
+		int lo = 0, hi = table->nr;						\
+		while (lo < hi) {							\
+			int mid = lo + (hi - lo) / 2;					\
+			if (fun(item, table->array_name[mid]))				\
+				hi = mid;						\
+			else								\
+				lo = mid + 1;						\
 		}									\
-		return table->nr;							\
+		return lo;								\
 	}
 
 /* add object at the given index to a table. */
@@ -110,4 +114,126 @@
 		src->array_name = NULL;						\
 	}
 
+
+/*
+ * Tables of objects with a unique id (dives and trips) can keep a hash index
+ * from the id to the object, see idindex.h. These tables have a
+ * "struct id_index *index" member and use the _INDEXED variants of the
+ * macros above. Only the tables for which the function "indexed" returns
+ * true keep an index, other tables (e.g. of imported dives) are searched
+ * linearly. The index is built by add_to_<table>(), merge_into_<table>() and
+ * move_<table>() and kept up to date by remove_from_<table>(). clear_<table>()
+ * drops it. get_by_id_in_<table>() only reads the index, so that lookups can
+ * run concurrently.
+ */
+#define MAKE_ID_INDEX(table_type, array_name, indexed)				\
+	static void build_index_##table_type(struct table_type *table)		\
+	{									\
+		if (table->index || !indexed(table))				\
+			return;							\
+		table->index = alloc_id_index();				\
+		for (int i = 0; i < table->nr; i++)				\
+			id_index_add(table->index, table->array_name[i]->id,	\
+				     table->array_name[i]);			\
+	}
+
+#define MAKE_ADD_TO_INDEXED(table_type, item_type, array_name, id)			\
+	void add_to_##table_type(struct table_type *table, int idx, item_type item)	\
+	{										\
+		int i;									\
+		build_index_##table_type(table);					\
+		if (table->index)							\
+			id_index_add(table->index, item->id, item);			\
+		grow_##table_type(table);						\
+		table->nr++;								\
+											\
+		for (i = idx; i < table->nr; i++) {					\
+			item_type tmp = table->array_name[i];				\
+			table->array_name[i] = item;					\
+			item = tmp;							\
+		}									\
+	}
+
+#define MAKE_REMOVE_FROM_INDEXED(table_type, array_name, id)					\
+	void remove_from_##table_type(struct table_type *table, int idx)			\
+	{											\
+		int i;										\
+		if (table->index)								\
+			id_index_remove(table->index, table->array_name[idx]->id,		\
+					table->array_name[idx]);				\
+		for (i = idx; i < table->nr - 1; i++)						\
+			table->array_name[i] = table->array_name[i + 1];			\
+		memset(&table->array_name[--table->nr], 0, sizeof(table->array_name[0]));	\
+	}
+
+#define MAKE_CLEAR_TABLE_INDEXED(table_type, array_name, item_name)		\
+	void clear_##table_type(struct table_type *table)			\
+	{									\
+		for (int i = 0; i < table->nr; i++)				\
+			free_##item_name(table->array_name[i]);			\
+		table->nr = 0;							\
+		free_id_index(table->index);					\
+		table->index = NULL;						\
+	}
+
+/* The index moves with the objects */
+#define MAKE_MOVE_TABLE_INDEXED(table_type, array_name)				\
+	void move_##table_type(struct table_type *src, struct table_type *dst)	\
+	{									\
+		clear_##table_type(dst);					\
+		free(dst->array_name);						\
+		*dst = *src;							\
+		src->nr = src->allocated = 0;					\
+		src->array_name = NULL;						\
+		src->index = NULL;						\
+		build_index_##table_type(dst);					\
+	}
+
+#define MAKE_GET_BY_ID(table_type, item_type, array_name, id)				\
+	item_type get_by_id_in_##table_type(const struct table_type *table, int id_value)	\
+	{										\
+		if (table->index)							\
+			return (item_type)id_index_get(table->index, id_value);	\
+		for (int i = 0; i < table->nr; i++) {					\
+			if (table->array_name[i]->id == id_value)			\
+				return table->array_name[i];				\
+		}									\
+		return NULL;								\
+	}
+
+/* Add all objects of "batch" to a table that is ordered according to the
+ * comparison function. The batch is sorted and then merged into the table
+ * from the back, so that every object of the table moves at most once.
+ * Equal objects end up in the same order as with repeated insertion. The
+ * batch is left sorted, but otherwise unchanged. */
+#define MAKE_MERGE_INTO_INDEXED(table_type, item_type, array_name, fun, id)		\
+	void merge_into_##table_type(struct table_type *table, struct table_type *batch)	\
+	{										\
+		int i = table->nr - 1, j = batch->nr - 1, k = table->nr + batch->nr - 1;\
+		if (!batch->nr)								\
+			return;								\
+		build_index_##table_type(table);					\
+		sort_##table_type(batch);						\
+		if (k >= table->allocated) {						\
+			int allocated = (k + 32) * 3 / 2;				\
+			item_type *items = realloc(table->array_name, allocated * sizeof(item_type));\
+			if (!items)							\
+				exit(1);						\
+			table->array_name = items;					\
+			table->allocated = allocated;					\
+		}									\
+		while (j >= 0) {							\
+			if (i >= 0 && fun(batch->array_name[j], table->array_name[i]))	\
+				table->array_name[k--] = table->array_name[i--];	\
+			else								\
+				table->array_name[k--] = batch->array_name[j--];	\
+		}									\
+		table->nr += batch->nr;							\
+		if (table->index) {							\
+			for (j = 0; j < batch->nr; j++)					\
+				id_index_add(table->index, batch->array_name[j]->id,	\
+					     batch->array_name[j]);			\
+		}									\
+	}
+
 #endif
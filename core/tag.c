@@ -21,11 +21,11 @@ static const char *default_tags[] = {
 };
 
 /* copy an element in a list of tags */
+/* Tags are owned by g_tag_list and shared between all dives, so copying
+ * a list only copies the entries. */
 static void copy_tl(struct tag_entry *st, struct tag_entry *dt)
 {
-	dt->tag = malloc(sizeof(struct divetag));
-	dt->tag->name = copy_string(st->tag->name);
-	dt->tag->source = copy_string(st->tag->source);
+	dt->tag = st->tag;
 }
 
 static bool tag_seen_before(struct tag_entry *start, struct tag_entry *before)
@@ -75,15 +75,6 @@ char *taglist_get_tagstring(struct tag_entry *tag_list)
 	return detach_cstring(&b);
 }
 
-static inline void taglist_free_divetag(struct divetag *tag)
-{
-	if (tag->name != NULL)
-		free(tag->name);
-	if (tag->source != NULL)
-		free(tag->source);
-	free(tag);
-}
-
 /* Add a tag to the tag_list, keep the list sorted */
 static struct divetag *taglist_add_divetag(struct tag_entry **tag_list, struct divetag *tag)
 {
@@ -110,13 +101,77 @@ static struct divetag *taglist_add_divetag(struct tag_entry **tag_list, struct d
 	return tag;
 }
 
+/*
+ * Hashed index of the tags in g_tag_list by name, so that adding the tags of a
+ * dive doesn't have to search the whole list. Open addressing with linear probing.
+ * If g_tag_list was freed or cleaned up elsewhere, its head changed and the index
+ * is rebuilt.
+ */
+static struct divetag **tag_index;
+static unsigned int tag_index_size, tag_index_count;
+static struct tag_entry *tag_index_list;
+
+static unsigned int tag_hash(const char *name)
+{
+	unsigned int hash = 2166136261u;	/* FNV-1a */
+
+	while (*name)
+		hash = (hash ^ (unsigned char)*name++) * 16777619u;
+	return hash;
+}
+
+/* The slot of the tag with the given name, or the empty slot where it belongs */
+static struct divetag **tag_index_slot(const char *name)
+{
+	unsigned int i = tag_hash(name) & (tag_index_size - 1);
+
+	while (tag_index[i] && strcmp(tag_index[i]->name, name))
+		i = (i + 1) & (tag_index_size - 1);
+	return tag_index + i;
+}
+
+static void tag_index_add(struct divetag *tag)
+{
+	if (2 * (tag_index_count + 1) > tag_index_size) {
+		struct divetag **old = tag_index;
+		unsigned int i, old_size = tag_index_size;
+
+		tag_index_size = old_size ? 2 * old_size : 64;
+		tag_index = calloc(tag_index_size, sizeof(*tag_index));
+		for (i = 0; i < old_size; i++) {
+			if (old[i])
+				*tag_index_slot(old[i]->name) = old[i];
+		}
+		free(old);
+	}
+	*tag_index_slot(tag->name) = tag;
+	tag_index_count++;
+}
+
+/* The tag in g_tag_list with the given name or NULL */
+static struct divetag *find_global_tag(const char *name)
+{
+	struct tag_entry *entry;
+
+	if (g_tag_list != tag_index_list) {
+		if (tag_index)
+			memset(tag_index, 0, tag_index_size * sizeof(*tag_index));
+		tag_index_count = 0;
+		for (entry = g_tag_list; entry; entry = entry->next)
+			tag_index_add(entry->tag);
+		tag_index_list = g_tag_list;
+	}
+	if (!tag_index)
+		return NULL;
+	return *tag_index_slot(name);
+}
+
 struct divetag *taglist_add_tag(struct tag_entry **tag_list, const char *tag)
 {
 	size_t i = 0;
 	int is_default_tag = 0;
-	struct divetag *ret_tag, *new_tag;
-	const char *translation;
-	new_tag = malloc(sizeof(struct divetag));
+	struct divetag *ret_tag;
+	const char *name = tag;
 
 	for (i = 0; i < sizeof(default_tags) / sizeof(char *); i++) {
 		if (strcmp(default_tags[i], tag) == 0) {
@@ -125,29 +180,21 @@ struct divetag *taglist_add_tag(struct tag_entry **tag_list, const char *tag)
 		}
 	}
 	/* Only translate default tags */
-	if (is_default_tag) {
-		translation = translate("gettextFromC", tag);
-		new_tag->name = malloc(strlen(translation) + 1);
-		memcpy(new_tag->name, translation, strlen(translation) + 1);
-		new_tag->source = malloc(strlen(tag) + 1);
-		memcpy(new_tag->source, tag, strlen(tag) + 1);
-	} else {
-		new_tag->source = NULL;
-		new_tag->name = malloc(strlen(tag) + 1);
-		memcpy(new_tag->name, tag, strlen(tag) + 1);
-	}
-	/* Try to insert new_tag into g_tag_list if we are not operating on it */
-	if (tag_list != &g_tag_list) {
-		ret_tag = taglist_add_divetag(&g_tag_list, new_tag);
-		/* g_tag_list already contains new_tag, free the duplicate */
-		if (ret_tag != new_tag)
-			taglist_free_divetag(new_tag);
-		ret_tag = taglist_add_divetag(tag_list, ret_tag);
-	} else {
-		ret_tag = taglist_add_divetag(tag_list, new_tag);
-		if (ret_tag != new_tag)
-			taglist_free_divetag(new_tag);
+	if (is_default_tag)
+		name = translate("gettextFromC", tag);
+
+	/* All tags live in g_tag_list, the lists of the dives only refer to them */
+	ret_tag = find_global_tag(name);
+	if (!ret_tag) {
+		ret_tag = malloc(sizeof(struct divetag));
+		ret_tag->name = strdup(name);
+		ret_tag->source = is_default_tag ? strdup(tag) : NULL;
+		taglist_add_divetag(&g_tag_list, ret_tag);
+		tag_index_list = g_tag_list;
+		tag_index_add(ret_tag);
 	}
+	if (tag_list != &g_tag_list)
+		taglist_add_divetag(tag_list, ret_tag);
 	return ret_tag;
 }
 
@@ -4,6 +4,7 @@
 #include "dive.h"
 #include "subsurface-time.h"
 #include "subsurface-string.h"
+#include "idindex.h"
 #include "selection.h"
 #include "table.h"
 #include "core/qthelper.h"
@@ -45,15 +46,23 @@ void free_trip(dive_trip_t *trip)
 	}
 }
 
+/* Only the global trip table is looked up by id */
+static bool is_global_trip_table(const struct trip_table *table)
+{
+	return table == &trip_table;
+}
+
 /* Trip table functions */
 static MAKE_GET_IDX(trip_table, struct dive_trip *, trips)
 static MAKE_GROW_TABLE(trip_table, struct dive_trip *, trips)
 static MAKE_GET_INSERTION_INDEX(trip_table, struct dive_trip *, trips, trip_less_than)
-static MAKE_ADD_TO(trip_table, struct dive_trip *, trips)
-static MAKE_REMOVE_FROM(trip_table, trips)
+MAKE_ID_INDEX(trip_table, trips, is_global_trip_table)
+static MAKE_ADD_TO_INDEXED(trip_table, struct dive_trip *, trips, id)
+static MAKE_REMOVE_FROM_INDEXED(trip_table, trips, id)
 MAKE_SORT(trip_table, struct dive_trip *, trips, comp_trips)
 MAKE_REMOVE(trip_table, struct dive_trip *, trip)
-MAKE_CLEAR_TABLE(trip_table, trips, trip)
+MAKE_CLEAR_TABLE_INDEXED(trip_table, trips, trip)
+static MAKE_GET_BY_ID(trip_table, struct dive_trip *, trips, id)
 
 timestamp_t trip_date(const struct dive_trip *trip)
 {
@@ -108,6 +117,7 @@ struct dive_trip *unregister_dive_from_trip(struct dive *dive)
 
 	remove_dive(dive, &trip->dives);
 	dive->divetrip = NULL;
+	invalidate_deco_chains();
 	return trip;
 }
 
@@ -201,11 +211,7 @@ dive_trip_t *get_trip_for_new_dive(struct dive *new_dive, bool *allocated)
 /* lookup of trip in main trip_table based on its id */
 dive_trip_t *get_trip_by_uniq_id(int tripId)
 {
-	for (int i = 0; i < trip_table.nr; i++) {
-		if (trip_table.trips[i]->id == tripId)
-			return trip_table.trips[i];
-	}
-	return NULL;
+	return get_by_id_in_trip_table(&trip_table, tripId);
 }
 
 /* Check if two trips overlap time-wise up to trip threshold. */
@@ -23,9 +23,10 @@ typedef struct dive_trip
 typedef struct trip_table {
 	int nr, allocated;
 	struct dive_trip **trips;
+	struct id_index *index;	/* only for the global table, see table.h */
 } trip_table_t;
 
-static const trip_table_t empty_trip_table = { 0, 0, (struct dive_trip **)0 };
+static const trip_table_t empty_trip_table = { 0, 0, (struct dive_trip **)0, (struct id_index *)0 };
 
 extern void add_dive_to_trip(struct dive *, dive_trip_t *);
 extern struct dive_trip *unregister_dive_from_trip(struct dive *dive);
@@ -175,6 +175,7 @@ void uemis_set_divelocation(int divespot, char *text, double longitude, double l
 			if (ds) {
 				ds->name = strdup(text);
 				ds->location = create_location(latitude, longitude);
+				invalidate_dive_site_grids();
 			}
 		}
 		hp = hp->next;
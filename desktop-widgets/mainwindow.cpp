@@ -25,6 +25,7 @@
 #include "core/git-access.h"
 #include "core/import-csv.h"
 #include "core/planner.h"
+#include "core/plotinfoservice.h"
 #include "core/qthelper.h"
 #include "core/subsurface-string.h"
 #include "core/trip.h"
@@ -306,6 +307,7 @@ MainWindow::MainWindow() : QMainWindow(),
 	connect(tec, &qPrefTechnicalDetails::calcceiling3mChanged         , graphics, &ProfileWidget2::actionRequestedReplot);
 	connect(tec, &qPrefTechnicalDetails::modChanged                   , graphics, &ProfileWidget2::actionRequestedReplot);
 	connect(tec, &qPrefTechnicalDetails::calcndlttsChanged            , graphics, &ProfileWidget2::actionRequestedReplot);
+	connect(tec, &qPrefTechnicalDetails::analyticndlttsChanged        , graphics, &ProfileWidget2::actionRequestedReplot);
 	connect(tec, &qPrefTechnicalDetails::hrgraphChanged               , graphics, &ProfileWidget2::actionRequestedReplot);
 	connect(tec, &qPrefTechnicalDetails::rulergraphChanged            , graphics, &ProfileWidget2::actionRequestedReplot);
 	connect(tec, &qPrefTechnicalDetails::show_sacChanged              , graphics, &ProfileWidget2::actionRequestedReplot);
@@ -1768,6 +1770,9 @@ void MainWindow::setApplicationState(ApplicationState state)
 	if (getAppState() == state)
 		return;
 
+	// Background profile calculations may have seen the old deco mode
+	discard_plot_info_jobs();
+	graphics->discardPlotInfoRequests();
 	setAppState(state);
 
 	const Quadrants &quadrants = applicationState[(int)state];
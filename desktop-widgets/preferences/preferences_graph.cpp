@@ -41,6 +41,7 @@ void PreferencesGraph::refreshSettings()
 
 	ui->gflow->setValue(prefs.gflow);
 	ui->gfhigh->setValue(prefs.gfhigh);
+	ui->analytic_ndl_tts->setChecked(prefs.analyticndltts);
 	ui->vpmb_conservatism->setValue(prefs.vpmb_conservatism);
 	ui->show_ccr_setpoint->setChecked(prefs.show_ccr_setpoint);
 	ui->show_ccr_sensors->setChecked(prefs.show_ccr_sensors);
@@ -69,6 +70,7 @@ void PreferencesGraph::syncSettings()
 	qPrefTechnicalDetails::set_gflow(ui->gflow->value());
 	qPrefTechnicalDetails::set_gfhigh(ui->gfhigh->value());
 	set_gf(ui->gflow->value(), ui->gfhigh->value());
+	qPrefTechnicalDetails::set_analyticndltts(ui->analytic_ndl_tts->isChecked());
 	qPrefTechnicalDetails::set_vpmb_conservatism(ui->vpmb_conservatism->value());
 	set_vpmb_conservatism(ui->vpmb_conservatism->value());
 	qPrefTechnicalDetails::set_show_ccr_setpoint(ui->show_ccr_setpoint->isChecked());
@@ -94,6 +96,7 @@ void PreferencesGraph::on_buehlmann_toggled(bool buehlmann)
 	ui->gflow->setEnabled(buehlmann);
 	ui->label_GFhigh->setEnabled(buehlmann);
 	ui->label_GFlow->setEnabled(buehlmann);
+	ui->analytic_ndl_tts->setEnabled(buehlmann);
 	ui->vpmb_conservatism->setEnabled(!buehlmann);
 	ui->label_VPMB->setEnabled(!buehlmann);
 }
@@ -2,6 +2,7 @@
 #include <QApplication>
 #include <QClipboard>
 #include <QDebug>
+#include <QSet>
 #include <QVector>
 
 #include "qmlmapwidgethelper.h"
@@ -162,27 +163,60 @@ void MapWidgetHelper::selectedLocationChanged(struct dive_site *ds_in)
 	emit selectedDivesChanged(selectedDiveIds);
 }
 
+static void addVisibleSite(struct dive_site *ds, void *data)
+{
+	static_cast<QSet<struct dive_site *> *>(data)->insert(ds);
+}
+
 void MapWidgetHelper::selectVisibleLocations()
 {
 	int idx;
 	struct dive *dive;
 	QList<int> selectedDiveIds;
+
+	// Fetch the sites in the bounding box of the map from the spatial index of the
+	// dive site table, instead of projecting the site of every dive onto the map.
+	// This doesn't work if the map shows the whole world, possibly multiple times,
+	// since then the corners don't describe the visible area. In that case, fall
+	// back to asking the map for every dive site.
+	QGeoCoordinate nw, se;
+	qreal width = m_map->property("width").toReal();
+	qreal height = m_map->property("height").toReal();
+	qreal zoomLevel = m_map->property("zoomLevel").toReal();
+	QMetaObject::invokeMethod(m_map, "toCoordinate", Q_RETURN_ARG(QGeoCoordinate, nw),
+	                          Q_ARG(QPointF, QPointF(0.0, 0.0)));
+	QMetaObject::invokeMethod(m_map, "toCoordinate", Q_RETURN_ARG(QGeoCoordinate, se),
+	                          Q_ARG(QPointF, QPointF(width, height)));
+	bool useIndex = nw.isValid() && se.isValid() && width < 256.0 * pow(2.0, zoomLevel);
+	QSet<struct dive_site *> visibleSites;
+	if (useIndex) {
+		location_t sw = create_location(se.latitude(), nw.longitude());
+		location_t ne = create_location(nw.latitude(), se.longitude());
+		for_each_dive_site_in_box(&sw, &ne, &dive_site_table, addVisibleSite, &visibleSites);
+	}
+
 	for_each_dive (idx, dive) {
 		struct dive_site *ds = get_dive_site_for_dive(dive);
 		if (!dive_site_has_gps_location(ds))
 			continue;
-		const qreal latitude = ds->location.lat.udeg * 0.000001;
-		const qreal longitude = ds->location.lon.udeg * 0.000001;
-		QGeoCoordinate dsCoord(latitude, longitude);
-		QPointF point;
-		QMetaObject::invokeMethod(m_map, "fromCoordinate", Q_RETURN_ARG(QPointF, point),
-		                          Q_ARG(QGeoCoordinate, dsCoord));
-		if (!qIsNaN(point.x()))
+		if (useIndex) {
+			if (!visibleSites.contains(ds))
+				continue;
+		} else {
+			const qreal latitude = ds->location.lat.udeg * 0.000001;
+			const qreal longitude = ds->location.lon.udeg * 0.000001;
+			QGeoCoordinate dsCoord(latitude, longitude);
+			QPointF point;
+			QMetaObject::invokeMethod(m_map, "fromCoordinate", Q_RETURN_ARG(QPointF, point),
+			                          Q_ARG(QGeoCoordinate, dsCoord));
+			if (qIsNaN(point.x()))
+				continue;
+		}
 #ifndef SUBSURFACE_MOBILE // indices on desktop
-			selectedDiveIds.append(idx);
+		selectedDiveIds.append(idx);
 	}
 #else // use id on mobile instead of index
-			selectedDiveIds.append(dive->id);
+		selectedDiveIds.append(dive->id);
 	}
 	int last; // get latest dive chronologically
 	if (!selectedDiveIds.isEmpty()) {
@@ -70,8 +70,11 @@ SOURCES += ../../subsurface-mobile-main.cpp \
 	../../core/import-cobalt.c \
 	../../core/import-divinglog.c \
 	../../core/import-csv.c \
+	../../core/keyword.c \
+	../../core/idindex.cpp \
 	../../core/save-html.c \
 	../../core/statistics.c \
+	../../core/stringpool.cpp \
 	../../core/worldmap-save.c \
 	../../core/libdivecomputer.c \
 	../../core/version.c \
@@ -79,6 +82,7 @@ SOURCES += ../../subsurface-mobile-main.cpp \
 	../../core/datatrak.c \
 	../../core/ostctools.c \
 	../../core/planner.c \
+	../../core/plotinfoservice.cpp \
 	../../core/save-xml.c \
 	../../core/cochran.c \
 	../../core/deco.c \
@@ -198,16 +202,20 @@ HEADERS += \
 	../../core/git-access.h \
 	../../core/gpslocation.h \
 	../../core/imagedownloader.h \
+	../../core/keyword.h \
+	../../core/idindex.h \
 	../../core/pref.h \
 	../../core/profile.h \
 	../../core/qthelper.h \
 	../../core/save-html.h \
 	../../core/statistics.h \
+	../../core/stringpool.h \
 	../../core/units.h \
 	../../core/version.h \
 	../../core/picture.h \
 	../../core/pictureobj.h \
 	../../core/planner.h \
+	../../core/plotinfoservice.h \
 	../../core/divesite.h \
 	../../core/checkcloudconnection.h \
 	../../core/cochran.h \
@@ -15,7 +15,11 @@
 #include "libdivecomputer/parser.h"
 #include "profile-widget/profilewidget2.h"
 
-AbstractProfilePolygonItem::AbstractProfilePolygonItem() : QObject(), QGraphicsPolygonItem(), hAxis(NULL), vAxis(NULL), dataModel(NULL), hDataColumn(-1), vDataColumn(-1)
+#include <algorithm>
+#include <cmath>
+
+AbstractProfilePolygonItem::AbstractProfilePolygonItem() : QObject(), QGraphicsPolygonItem(), hAxis(NULL), vAxis(NULL), dataModel(NULL), hDataColumn(-1), vDataColumn(-1),
+	columnWidth(0.0), decimated(false)
 {
 	setCacheMode(DeviceCoordinateCache);
 #ifndef SUBSURFACE_MOBILE
@@ -53,8 +57,70 @@ void AbstractProfilePolygonItem::setModel(DivePlotDataModel *model)
 	modelDataChanged();
 }
 
+void AbstractProfilePolygonItem::setColumnWidth(qreal width)
+{
+	if (width == columnWidth)
+		return;
+	columnWidth = width;
+	updateDecimation();
+}
+
+void AbstractProfilePolygonItem::setDecimatedPolygon(const QPolygonF &poly)
+{
+	fullPolygon = poly;
+	decimated = true;
+	updateDecimation();
+}
+
+void AbstractProfilePolygonItem::updateDecimation()
+{
+	if (decimated)
+		setPolygon(decimate(fullPolygon, &pointIndices));
+}
+
+// Reduce a line to what can be seen at the current resolution: of the points that fall
+// into the same pixel column, keep the first, the last, the minimum and the maximum,
+// in their original order. Thus, peaks are drawn the same as with all points.
+QPolygonF AbstractProfilePolygonItem::decimate(const QPolygonF &poly, QVector<int> *indices) const
+{
+	int count = poly.count();
+	QPolygonF res;
+	if (indices)
+		indices->clear();
+	if (columnWidth <= 0.0) {
+		if (indices) {
+			indices->reserve(count);
+			for (int i = 0; i < count; i++)
+				indices->append(i);
+		}
+		return poly;
+	}
+	int i = 0;
+	while (i < count) {
+		double column = floor(poly[i].x() / columnWidth);
+		int first = i, minIdx = i, maxIdx = i;
+		for (++i; i < count && floor(poly[i].x() / columnWidth) == column; i++) {
+			if (poly[i].y() < poly[minIdx].y())
+				minIdx = i;
+			if (poly[i].y() > poly[maxIdx].y())
+				maxIdx = i;
+		}
+		int keep[4] = { first, std::min(minIdx, maxIdx), std::max(minIdx, maxIdx), i - 1 };
+		for (int k = 0; k < 4; k++) {
+			if (k > 0 && keep[k] == keep[k - 1])
+				continue;
+			res.append(poly[keep[k]]);
+			if (indices)
+				indices->append(keep[k]);
+		}
+	}
+	return res;
+}
+
 void AbstractProfilePolygonItem::modelDataRemoved(const QModelIndex&, int, int)
 {
+	fullPolygon.clear();
+	pointIndices.clear();
 	setPolygon(QPolygonF());
 	qDeleteAll(texts);
 	texts.clear();
@@ -105,6 +171,7 @@ void AbstractProfilePolygonItem::modelDataChanged(const QModelIndex&, const QMod
 		QPointF point(hAxis->posAtValue(horizontalValue), vAxis->posAtValue(verticalValue));
 		poly.append(point);
 	}
+	decimated = false;
 	setPolygon(poly);
 
 	qDeleteAll(texts);
@@ -139,13 +206,16 @@ void DiveProfileItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *o
 	pen.setCosmetic(true);
 	pen.setWidth(2);
 	QPolygonF poly = polygon();
-	// This paints the colors of the velocities.
-	for (int i = 1, count = dataModel->rowCount(); i < count; i++) {
-		QModelIndex colorIndex = dataModel->index(i, DivePlotDataModel::COLOR);
+	// This paints the colors of the velocities. The polygon may be decimated, therefore
+	// use the data row of each point. The points past the last row are the ceiling.
+	for (int i = 1, count = std::min(poly.count(), pointIndices.count()); i < count; i++) {
+		int row = pointIndices[i];
+		if (row >= dataModel->rowCount())
+			break;
+		QModelIndex colorIndex = dataModel->index(row, DivePlotDataModel::COLOR);
 		pen.setBrush(QBrush(colorIndex.data(Qt::BackgroundRole).value<QColor>()));
 		painter->setPen(pen);
-		if (i < poly.count())
-			painter->drawLine(poly[i - 1], poly[i]);
+		painter->drawLine(poly[i - 1], poly[i]);
 	}
 	painter->restore();
 }
@@ -153,10 +223,12 @@ void DiveProfileItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *o
 int DiveProfileItem::maxCeiling(int row)
 {
 	int max = -1;
-	plot_data *entry = dataModel->data().entry + row;
+	const plot_tissue_data *tissues = get_plot_tissue_data(&dataModel->data(), row);
+	if (!tissues)
+		return max;
 	for (int tissue = 0; tissue < 16; tissue++) {
-		if (max < entry->ceilings[tissue])
-			max = entry->ceilings[tissue];
+		if (max < tissues->ceilings[tissue])
+			max = tissues->ceilings[tissue];
 	}
 	return max;
 }
@@ -209,6 +281,7 @@ void DiveProfileItem::modelDataChanged(const QModelIndex &topLeft, const QModelI
 		}
 		setPolygon(p);
 	}
+	setDecimatedPolygon(polygon());
 
 	// This is the blueish gradient that the Depth Profile should have.
 	// It's a simple QLinearGradient with 2 stops, starting from top to bottom.
@@ -320,7 +393,7 @@ void DiveHeartrateItem::modelDataChanged(const QModelIndex &topLeft, const QMode
 		createTextItem(sec, hr);
 		last_printed_hr = hr;
 	}
-	setPolygon(poly);
+	setDecimatedPolygon(poly);
 
 	if (texts.count())
 		texts.last()->setAlignment(Qt::AlignLeft | Qt::AlignBottom);
@@ -408,11 +481,11 @@ void DivePercentageItem::paint(QPainter *painter, const QStyleOptionGraphicsItem
 	mypen.setCapStyle(Qt::FlatCap);
 	mypen.setCosmetic(false);
 	QPolygonF poly = polygon();
+	struct gasmix gasmix = gasmix_invalid;
+	const struct event *ev = NULL;
 	for (int i = 1, modelDataCount = dataModel->rowCount(); i < modelDataCount; i++) {
 		if (i < poly.count()) {
 			double value = dataModel->index(i, vDataColumn).data().toDouble();
-			struct gasmix gasmix = gasmix_air;
-			const struct event *ev = NULL;
 			int sec = dataModel->index(i, DivePlotDataModel::TIME).data().toInt();
 			gasmix = get_gasmix(&displayed_dive, displayed_dc, sec, &ev, gasmix);
 			int inert = 1000 - get_o2(gasmix);
@@ -452,7 +525,7 @@ void DiveAmbPressureItem::modelDataChanged(const QModelIndex &topLeft, const QMo
 		QPointF point(hAxis->posAtValue(sec), vAxis->posAtValue(hr));
 		poly.append(point);
 	}
-	setPolygon(poly);
+	setDecimatedPolygon(poly);
 
 	if (texts.count())
 		texts.last()->setAlignment(Qt::AlignLeft | Qt::AlignBottom);
@@ -497,7 +570,7 @@ void DiveGFLineItem::modelDataChanged(const QModelIndex &topLeft, const QModelIn
 		QPointF point(hAxis->posAtValue(sec), vAxis->posAtValue(hr));
 		poly.append(point);
 	}
-	setPolygon(poly);
+	setDecimatedPolygon(poly);
 
 	if (texts.count())
 		texts.last()->setAlignment(Qt::AlignLeft | Qt::AlignBottom);
@@ -556,7 +629,7 @@ void DiveTemperatureItem::modelDataChanged(const QModelIndex &topLeft, const QMo
 			createTextItem(sec, mkelvin);
 		last_printed_temp = mkelvin;
 	}
-	setPolygon(poly);
+	setDecimatedPolygon(poly);
 
 	/* it would be nice to print the end temperature, if it's
 	* different or if the last temperature print has been more
@@ -623,7 +696,7 @@ void DiveMeanDepthItem::modelDataChanged(const QModelIndex &topLeft, const QMode
 		poly.append(point);
 	}
 	lastRunningSum = meandepthvalue;
-	setPolygon(poly);
+	setDecimatedPolygon(poly);
 	createTextItem();
 }
 
@@ -849,7 +922,7 @@ void DiveCalculatedCeiling::modelDataChanged(const QModelIndex &topLeft, const Q
 
 	poly.prepend(QPointF(p1.x(), vAxis->posAtValue(0)));
 	poly.append(QPointF(p2.x(), vAxis->posAtValue(0)));
-	setPolygon(poly);
+	setDecimatedPolygon(poly);
 
 	QLinearGradient pat(0, polygon().boundingRect().top(), 0, polygon().boundingRect().bottom());
 	pat.setColorAt(0, getColor(CALC_CEILING_SHALLOW));
@@ -950,7 +1023,7 @@ void PartialPressureGasItem::modelDataChanged(const QModelIndex &topLeft, const
 	plot_data *entry = dataModel->data().entry;
 	QPolygonF poly;
 	QPolygonF alertpoly;
-	alertPolygons.clear();
+	fullAlertPolygons.clear();
 	double threshold_min = 100.0; // yes, a ridiculous high partial pressure
 	double threshold_max = 0.0;
 	if (thresholdPtrMax)
@@ -965,32 +1038,40 @@ void PartialPressureGasItem::modelDataChanged(const QModelIndex &topLeft, const
 		poly.push_back(point);
 		if (thresholdPtrMax && value >= threshold_max) {
 			if (inAlertFragment) {
-				alertPolygons.back().push_back(point);
+				fullAlertPolygons.back().push_back(point);
 			} else {
 				alertpoly.clear();
 				alertpoly.push_back(point);
-				alertPolygons.append(alertpoly);
+				fullAlertPolygons.append(alertpoly);
 				inAlertFragment = true;
 			}
 		} else if (thresholdPtrMin && value <= threshold_min) {
 			if (inAlertFragment) {
-				alertPolygons.back().push_back(point);
+				fullAlertPolygons.back().push_back(point);
 			} else {
 				alertpoly.clear();
 				alertpoly.push_back(point);
-				alertPolygons.append(alertpoly);
+				fullAlertPolygons.append(alertpoly);
 				inAlertFragment = true;
 			}
 		} else {
 			inAlertFragment = false;
 		}
 	}
-	setPolygon(poly);
+	setDecimatedPolygon(poly);
 	/*
 	createPPLegend(trUtf8("pN₂"), getColor(PN2), legendPos);
 	*/
 }
 
+void PartialPressureGasItem::updateDecimation()
+{
+	AbstractProfilePolygonItem::updateDecimation();
+	alertPolygons.clear();
+	Q_FOREACH (const QPolygonF &poly, fullAlertPolygons)
+		alertPolygons.append(decimate(poly));
+}
+
 void PartialPressureGasItem::paint(QPainter *painter, const QStyleOptionGraphicsItem*, QWidget*)
 {
 	const qreal pWidth = 0.0;
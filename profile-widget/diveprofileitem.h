@@ -41,6 +41,9 @@ public:
 	void setModel(DivePlotDataModel *model);
 	void setHorizontalDataColumn(int column);
 	void setVerticalDataColumn(int column);
+	/* Width of a device pixel in item coordinates, used to decimate the lines
+	 * set with setDecimatedPolygon(). 0 means: show all points. */
+	void setColumnWidth(qreal width);
 	virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = 0) = 0;
 public
 slots:
@@ -59,12 +62,25 @@ protected:
 	 */
 	bool shouldCalculateStuff(const QModelIndex &topLeft, const QModelIndex &bottomRight);
 
+	/* Long dives with high sample rates have many more points than there are pixels
+	 * on the screen. Items that draw lines pass them through setDecimatedPolygon(),
+	 * which keeps the full polygon and sets a reduced copy for painting. This is
+	 * redone by updateDecimation() when the zoom level or the size of the view changes.
+	 */
+	void setDecimatedPolygon(const QPolygonF &poly);
+	virtual void updateDecimation();
+	QPolygonF decimate(const QPolygonF &poly, QVector<int> *indices = nullptr) const;
+
 	DiveCartesianAxis *hAxis;
 	DiveCartesianAxis *vAxis;
 	DivePlotDataModel *dataModel;
 	int hDataColumn;
 	int vDataColumn;
 	QList<DiveTextItem *> texts;
+	qreal columnWidth;
+	bool decimated;
+	QPolygonF fullPolygon;
+	QVector<int> pointIndices; // for each point of polygon(), its index in fullPolygon
 };
 
 class DiveProfileItem : public AbstractProfilePolygonItem {
@@ -215,7 +231,11 @@ public:
 	void setVisibilitySettingsKey(const QString &setVisibilitySettingsKey);
 	void setColors(const QColor &normalColor, const QColor &alertColor);
 
+protected:
+	void updateDecimation() override;
+
 private:
+	QVector<QPolygonF> fullAlertPolygons;
 	QVector<QPolygonF> alertPolygons;
 	const double *thresholdPtrMin;
 	const double *thresholdPtrMax;
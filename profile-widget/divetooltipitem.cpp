@@ -270,8 +270,9 @@ void ToolTipItem::refresh(const QPointF &pos)
 		painter.drawLine(0, lrint(60 - AMB_PERCENTAGE * (entry->pressures.n2 + entry->pressures.he) / entry->ambpressure / 2),
 				16, lrint(60 - AMB_PERCENTAGE * (entry->pressures.n2 + entry->pressures.he) / entry->ambpressure /2));
 		painter.setPen(QColor(0, 0, 0, 127));
-		for (int i=0; i<16; i++) {
-			painter.drawLine(i, 60, i, 60 - entry->percentages[i] / 2);
+		const struct plot_tissue_data *tissue_data = get_plot_tissue_data(&pInfo, idx);
+		for (int i=0; tissue_data && i<16; i++) {
+			painter.drawLine(i, 60, i, 60 - tissue_data->percentages[i] / 2);
 		}
 		entryToolTip.second->setText(QString::fromUtf8(mb.buffer, mb.len));
 	}
@@ -21,6 +21,7 @@
 #include "qt-models/models.h"
 #include "qt-models/divepicturemodel.h" // TODO: remove once divepictures have been undo-ified
 #include "core/divelist.h"
+#include "core/plotinfoservice.h"
 #include "core/errorhelper.h"
 #ifndef SUBSURFACE_MOBILE
 #include "desktop-widgets/diveplanner.h"
@@ -144,6 +145,10 @@ ProfileWidget2::ProfileWidget2(QWidget *parent) : QGraphicsView(parent),
 	tankItem(new TankItem()),
 	isGrayscale(false),
 	printMode(false),
+#ifndef SUBSURFACE_MOBILE
+	pendingDiveId(0),
+	pendingClearPictures(false),
+#endif
 	shouldCalculateMaxTime(true),
 	shouldCalculateMaxDepth(true),
 	fontPrintScale(1.0)
@@ -174,6 +179,7 @@ ProfileWidget2::ProfileWidget2(QWidget *parent) : QGraphicsView(parent),
 	connect(&diveListNotifier, &DiveListNotifier::cylinderEdited, this, &ProfileWidget2::profileChanged);
 	connect(&diveListNotifier, &DiveListNotifier::eventsChanged, this, &ProfileWidget2::profileChanged);
 	connect(&diveListNotifier, &DiveListNotifier::pictureOffsetChanged, this, &ProfileWidget2::pictureOffsetChanged);
+	connect(&plotInfoWatcher, &QFutureWatcher<void>::finished, this, &ProfileWidget2::plotInfoCalculated);
 #endif // SUBSURFACE_MOBILE
 
 #if !defined(QT_NO_DEBUG) && defined(SHOW_PLOT_INFO_TABLE)
@@ -553,10 +559,93 @@ void ProfileWidget2::resetZoom()
 	zoomLevel = 0;
 }
 
+#ifndef SUBSURFACE_MOBILE
+// The background calculation is only used for viewing the first dive computer of dives
+// in the dive list. Edits and the planner need the profile immediately, as do callers
+// that grab the profile right away (they pass "instant"). Dives without samples get a
+// fake profile, which is cheap.
+bool ProfileWidget2::calculateInBackground(const struct dive *d, bool instant) const
+{
+	return !instant && !printMode && currentState != EDIT && !in_planner() && dc_number == 0 &&
+	       d->dc.samples > 0 && get_dive_by_uniq_id(d->id) == d;
+}
+
+// Only one calculation runs at a time. Requesting a new dive replaces the pending
+// one, so that when scrolling through the dive list, the dives that were skipped
+// over are never calculated. A calculation that is already running can't be
+// cancelled, but its result ends up in the cache.
+void ProfileWidget2::requestPlotInfo(const struct dive *d, bool clearPictures)
+{
+	pendingDiveId = d->id;
+	pendingClearPictures = clearPictures;
+	speculativeDiveIds.clear();
+	startPlotInfoCalculation();
+}
+
+// The user will likely look at the previous or next dive, so calculate those while idle
+void ProfileWidget2::queueNeighbourDives(const struct dive *d)
+{
+	int idx = get_divenr(d);
+	speculativeDiveIds.clear();
+	if (idx < 0)
+		return;
+	if (idx + 1 < dive_table.nr)
+		speculativeDiveIds.append(dive_table.dives[idx + 1]->id);
+	if (idx > 0)
+		speculativeDiveIds.append(dive_table.dives[idx - 1]->id);
+	startPlotInfoCalculation();
+}
+
+// The calculations must not run in the planner, see calculate_plot_info_async()
+void ProfileWidget2::discardPlotInfoRequests()
+{
+	pendingDiveId = 0;
+	speculativeDiveIds.clear();
+}
+
+void ProfileWidget2::startPlotInfoCalculation()
+{
+	// Before the first dive is shown, the state is still EMPTY
+	if (plotInfoWatcher.isRunning() || in_planner() || (currentState != PROFILE && currentState != EMPTY))
+		return;
+	if (pendingDiveId) {
+		struct dive *d = get_dive_by_uniq_id(pendingDiveId);
+		if (d) {
+			plotInfoWatcher.setFuture(calculate_plot_info_async(d));
+			return;
+		}
+		pendingDiveId = 0;
+	}
+	while (!speculativeDiveIds.isEmpty()) {
+		struct dive *d = get_dive_by_uniq_id(speculativeDiveIds.takeFirst());
+		if (d && d->dc.samples > 0 && !lookup_plot_info(d, nullptr)) {
+			plotInfoWatcher.setFuture(calculate_plot_info_async(d));
+			return;
+		}
+	}
+}
+
+void ProfileWidget2::plotInfoCalculated()
+{
+	// If the user is still waiting for this dive, show it. This finds the profile in
+	// the cache, unless the dive or the preferences changed meanwhile. In that case,
+	// it is simply requested again. If a speculative calculation finished, the
+	// pending dive is started the same way.
+	if (pendingDiveId) {
+		struct dive *d = get_dive_by_uniq_id(pendingDiveId);
+		pendingDiveId = 0;
+		if (d && d == current_dive && currentState != ADD && currentState != PLAN)
+			plotDive(d, true, pendingClearPictures);
+	}
+	startPlotInfoCalculation();
+}
+#endif
+
 // Currently just one dive, but the plan is to enable All of the selected dives.
 void ProfileWidget2::plotDive(const struct dive *d, bool force, bool doClearPictures, bool instant)
 {
 	static bool firstCall = true;
+	bool cachedPlotInfo = false;
 #ifndef SUBSURFACE_MOBILE
 	QElapsedTimer measureDuration; // let's measure how long this takes us (maybe we'll turn of TTL calculation later
 	measureDuration.start();
@@ -576,6 +665,21 @@ void ProfileWidget2::plotDive(const struct dive *d, bool force, bool doClearPict
 		if (d->id == displayed_dive.id && dc_number == dataModel->dcShown() && !force)
 			return;
 
+#ifndef SUBSURFACE_MOBILE
+		// Calculating the profile of long dives takes a while. Unless it is cached,
+		// calculate it on a worker thread and keep showing the previous profile.
+		// plotInfoCalculated() comes back here once the result is in the cache.
+		if (calculateInBackground(d, instant)) {
+			if (!lookup_plot_info(get_dive_by_uniq_id(d->id), &plotInfo)) {
+				requestPlotInfo(d, doClearPictures);
+				return;
+			}
+			cachedPlotInfo = true;
+			queueNeighbourDives(d);
+		}
+		pendingDiveId = 0;
+#endif
+
 		// this copies the dive and makes copies of all the relevant additional data
 		copy_dive(d, &displayed_dive);
 #ifndef SUBSURFACE_MOBILE
@@ -642,8 +746,10 @@ void ProfileWidget2::plotDive(const struct dive *d, bool force, bool doClearPict
 
 	// create_plot_info_new() automatically frees old plot data
 #ifndef SUBSURFACE_MOBILE
-	create_plot_info_new(&displayed_dive, currentdc, &plotInfo, !shouldCalculateMaxDepth, &DivePlannerPointsModel::instance()->final_deco_state);
+	if (!cachedPlotInfo)
+		create_plot_info_new(&displayed_dive, currentdc, &plotInfo, !shouldCalculateMaxDepth, &DivePlannerPointsModel::instance()->final_deco_state);
 #else
+	Q_UNUSED(cachedPlotInfo);
 	create_plot_info_new(&displayed_dive, currentdc, &plotInfo, !shouldCalculateMaxDepth, nullptr);
 #endif
 	int newMaxtime = get_maxtime(&plotInfo);
@@ -857,6 +963,10 @@ void ProfileWidget2::actionRequestedReplot(bool)
 
 void ProfileWidget2::settingsChanged()
 {
+#ifndef SUBSURFACE_MOBILE
+	// The background calculations of profiles read some of the preferences
+	discard_plot_info_jobs();
+#endif
 	// if we are showing calculated ceilings then we have to replot()
 	// because the GF could have changed; otherwise we try to avoid replot()
 	// but always replot in PLAN/ADD/EDIT mode to avoid a bug of DiveHandlers not
@@ -936,6 +1046,22 @@ void ProfileWidget2::resizeEvent(QResizeEvent *event)
 	QGraphicsView::resizeEvent(event);
 	fitInView(sceneRect(), Qt::IgnoreAspectRatio);
 	fixBackgroundPos();
+	updateLevelOfDetail();
+}
+
+// The lines of the profile are decimated to the horizontal resolution of the view.
+// This only depends on the transformation, so it is redone on zoom and resize, but
+// not when panning. When printing, the profile is rendered at a higher resolution
+// than that of the view, so keep all points.
+void ProfileWidget2::updateLevelOfDetail()
+{
+	qreal pixelsPerUnit = transform().m11() * devicePixelRatioF();
+	qreal columnWidth = printMode || pixelsPerUnit <= 0.0 ? 0.0 : 1.0 / pixelsPerUnit;
+	Q_FOREACH (QGraphicsItem *item, scene()->items()) {
+		AbstractProfilePolygonItem *polygonItem = dynamic_cast<AbstractProfilePolygonItem *>(item);
+		if (polygonItem)
+			polygonItem->setColumnWidth(columnWidth);
+	}
 }
 
 #ifndef SUBSURFACE_MOBILE
@@ -991,6 +1117,7 @@ void ProfileWidget2::fixBackgroundPos()
 void ProfileWidget2::scale(qreal sx, qreal sy)
 {
 	QGraphicsView::scale(sx, sy);
+	updateLevelOfDetail();
 
 #ifndef SUBSURFACE_MOBILE
 	// Since the zoom level changed, adjust the duration bars accordingly.
@@ -1650,6 +1777,7 @@ void ProfileWidget2::setPrintMode(bool mode, bool grayscale)
 {
 	printMode = mode;
 	resetZoom();
+	updateLevelOfDetail();
 
 	// set printMode for axes
 	profileYAxis->setPrintMode(mode);
@@ -3,6 +3,9 @@
 #define PROFILEWIDGET2_H
 
 #include <QGraphicsView>
+#ifndef SUBSURFACE_MOBILE
+#include <QFutureWatcher>
+#endif
 #include <vector>
 #include <memory>
 
@@ -88,6 +91,7 @@ public:
 #ifndef SUBSURFACE_MOBILE
 	bool eventFilter(QObject *, QEvent *) override;
 	void clearHandlers();
+	void discardPlotInfoRequests(); // forget the queued background calculations of profiles
 #endif
 	void setToolTipVisibile(bool visible);
 	State currentState;
@@ -153,6 +157,7 @@ private:
 	void replot();
 	void changeGas(int tank, int seconds);
 	void fixBackgroundPos();
+	void updateLevelOfDetail();
 	void scrollViewTo(const QPoint &pos);
 	void setupSceneAndFlags();
 	void setupItemSizes();
@@ -255,6 +260,17 @@ private:
 	void repositionDiveHandlers();
 	int fixHandlerIndex(DiveHandler *activeHandler);
 	friend class DiveHandler;
+
+	// Calculation of the profile on a worker thread, see plotDive()
+	bool calculateInBackground(const struct dive *d, bool instant) const;
+	void requestPlotInfo(const struct dive *d, bool clearPictures);
+	void queueNeighbourDives(const struct dive *d);
+	void startPlotInfoCalculation();
+	void plotInfoCalculated();
+	QFutureWatcher<void> plotInfoWatcher;
+	int pendingDiveId; // dive to show once its profile is calculated, 0 if none
+	bool pendingClearPictures;
+	QVector<int> speculativeDiveIds; // dives that will probably be shown next
 #endif
 	QHash<Qt::Key, QAction *> actionsForKeys;
 	bool shouldCalculateMaxTime;
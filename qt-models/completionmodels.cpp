@@ -8,16 +8,15 @@
 #define CREATE_UPDATE_METHOD(Class, diveStructMember)          \
 	void Class::updateModel()                              \
 	{                                                      \
-		QStringList list;                              \
+		QSet<QString> set;                             \
 		struct dive *dive;                             \
 		int i = 0;                                     \
 		for_each_dive (i, dive)                        \
 		{                                              \
 			QString buddy(dive->diveStructMember); \
-			if (!list.contains(buddy)) {           \
-				list.append(buddy);            \
-			}                                      \
+			set.insert(buddy);                     \
 		}                                              \
+		QStringList list = set.values();               \
 		std::sort(list.begin(), list.end());           \
 		setStringList(list);                           \
 	}
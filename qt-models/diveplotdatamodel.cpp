@@ -79,11 +79,13 @@ QVariant DivePlotDataModel::data(const QModelIndex &index, int role) const
 	}
 
 	if (role == Qt::DisplayRole && index.column() >= TISSUE_1 && index.column() <= TISSUE_16) {
-		return item.ceilings[index.column() - TISSUE_1];
+		const plot_tissue_data *tissues = get_plot_tissue_data(&pInfo, index.row());
+		return tissues ? tissues->ceilings[index.column() - TISSUE_1] : 0;
 	}
 
 	if (role == Qt::DisplayRole && index.column() >= PERCENTAGE_1 && index.column() <= PERCENTAGE_16) {
-		return item.percentages[index.column() - PERCENTAGE_1];
+		const plot_tissue_data *tissues = get_plot_tissue_data(&pInfo, index.row());
+		return tissues ? tissues->percentages[index.column() - PERCENTAGE_1] : 0;
 	}
 
 	if (role == Qt::BackgroundRole) {
@@ -171,10 +173,7 @@ void DivePlotDataModel::clear()
 	if (rowCount() != 0) {
 		beginRemoveRows(QModelIndex(), 0, rowCount() - 1);
 		pInfo.nr = 0;
-		free(pInfo.entry);
-		free(pInfo.pressures);
-		pInfo.entry = nullptr;
-		pInfo.pressures = nullptr;
+		free_plot_info_data(&pInfo);
 		dcNr = -1;
 		endRemoveRows();
 	}
@@ -184,13 +183,19 @@ void DivePlotDataModel::setDive(dive *d, const plot_info &info)
 {
 	beginResetModel();
 	dcNr = dc_number;
-	free(pInfo.entry);
-	free(pInfo.pressures);
+	free_plot_info_data(&pInfo);
 	pInfo = info;
+	// The deco checkpoints are owned by the profile, we calculate our own if needed
+	pInfo.nr_deco_checkpoints = 0;
+	pInfo.deco_checkpoints = nullptr;
 	pInfo.entry = (plot_data *)malloc(sizeof(plot_data) * pInfo.nr);
 	memcpy(pInfo.entry, info.entry, sizeof(plot_data) * pInfo.nr);
 	pInfo.pressures = (plot_pressure_data *)malloc(sizeof(plot_pressure_data) * pInfo.nr_cylinders * pInfo.nr);
 	memcpy(pInfo.pressures, info.pressures, sizeof(plot_pressure_data) * pInfo.nr_cylinders * pInfo.nr);
+	if (info.tissues) {
+		pInfo.tissues = (plot_tissue_data *)malloc(sizeof(plot_tissue_data) * pInfo.nr);
+		memcpy(pInfo.tissues, info.tissues, sizeof(plot_tissue_data) * pInfo.nr);
+	}
 	endResetModel();
 }
 
@@ -224,7 +229,14 @@ void DivePlotDataModel::calculateDecompression()
 {
 	struct divecomputer *dc = select_dc(&displayed_dive);
 	init_decompression(&plot_deco_state, &displayed_dive);
+	// The entries are recalculated in place, so the previous results are the current entries
+	pInfo.prev_entry = pInfo.entry;
+	pInfo.prev_tissues = pInfo.tissues;
+	pInfo.prev_nr = pInfo.nr;
 	calculate_deco_information(&plot_deco_state, &(DivePlannerPointsModel::instance()->final_deco_state), &displayed_dive, dc, &pInfo, false);
+	pInfo.prev_entry = nullptr;
+	pInfo.prev_tissues = nullptr;
+	pInfo.prev_nr = 0;
 	dataChanged(index(0, CEILING), index(pInfo.nr - 1, TISSUE_16));
 }
 #endif
@@ -34,6 +34,7 @@
 #include "core/divesite.h"
 #include "core/membuffer.h"
 #include "core/tag.h"
+#include "core/stringpool.h"
 
 /* SmartTrak version, constant for every single file */
 int smtk_version;
@@ -996,7 +997,7 @@ void smartrak_import(const char *file, struct dive_table *divetable)
 		} else {
 			rc = DC_STATUS_NODEVICE;
 		}
-		smtkdive->dc.model = devdata->model;
+		smtkdive->dc.model = intern_string(devdata->model);
 		smtkdive->dc.serial = copy_string(col[coln(DCNUMBER)]->bind_ptr);
 		if (rc == DC_STATUS_SUCCESS) {
 			prf_buffer = mdb_ole_read_full(mdb, col[coln(PROFILE)], &prf_length);
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testdecoperformance.h"
+#include "core/deco.h"
+#include "core/dive.h"
+#include "core/pref.h"
+
+// Microbenchmark of the Buehlmann tissue kernels. Runs a synthetic three hour
+// trimix dive through add_segment() and tissue_tolerance_calc(), once with the
+// vectorized kernels (DECO_KERNEL in deco.c) and once with their scalar reference
+// versions. Both must give exactly the same tissue loadings and ceilings.
+
+#define DIVE_TIME (3 * 3600)
+
+// Returns the ceiling at the end of the dive. If ceilings is non-null, the ceilings after each step are added.
+static int replay(bool scalar, struct deco_state *ds, QVector<int> *ceilings = nullptr)
+{
+	struct gasmix trimix = {{180}, {450}};
+	struct gasmix ean50 = {{500}, {0}};
+	struct dive *dive = alloc_dive();
+	int t, ceiling = 0;
+
+	deco_scalar_kernels = scalar;
+	dive->dc.surface_pressure.mbar = 1013;
+	clear_deco(ds, 1.013);
+	for (t = 0; t < DIVE_TIME / 2; t += 20) {
+		add_segment(ds, depth_to_bar(90000, dive), trimix, 20, 0, OC, prefs.bottomsac);
+		ceiling = deco_allowed_depth(tissue_tolerance_calc(ds, dive, depth_to_bar(90000, dive)), 1.013, dive, true);
+		if (ceilings)
+			ceilings->push_back(ceiling);
+	}
+	for (; t < DIVE_TIME; t += 60) {
+		int depth = ceiling > 21000 ? ceiling : 21000;
+		add_segment(ds, depth_to_bar(depth, dive), ean50, 60, 0, OC, prefs.decosac);
+		ceiling = deco_allowed_depth(tissue_tolerance_calc(ds, dive, depth_to_bar(depth, dive)), 1.013, dive, true);
+		if (ceilings)
+			ceilings->push_back(ceiling);
+	}
+	deco_scalar_kernels = false;
+	free_dive(dive);
+	return ceiling;
+}
+
+void TestDecoPerformance::initTestCase()
+{
+	struct deco_state ds;
+
+	copy_prefs(&default_prefs, &prefs);
+	set_gf(30, 70);
+	referenceCeiling = replay(true, &ds);
+	// After 90 minutes at 90m, the diver is still in deco at the end
+	QVERIFY(referenceCeiling > 0);
+}
+
+void TestDecoPerformance::testScalarReference()
+{
+	struct deco_state ds, ref;
+	QVector<int> ceilings, refCeilings;
+
+	QCOMPARE(replay(false, &ds, &ceilings), replay(true, &ref, &refCeilings));
+	QCOMPARE(ceilings, refCeilings);
+	for (int ci = 0; ci < 16; ci++) {
+		QCOMPARE(ds.tissue_n2_sat[ci], ref.tissue_n2_sat[ci]);
+		QCOMPARE(ds.tissue_he_sat[ci], ref.tissue_he_sat[ci]);
+		QCOMPARE(ds.tissue_inertgas_saturation[ci], ref.tissue_inertgas_saturation[ci]);
+		QCOMPARE(ds.tolerated_by_tissue[ci], ref.tolerated_by_tissue[ci]);
+	}
+}
+
+void TestDecoPerformance::replayVectorized()
+{
+	struct deco_state ds;
+	int ceiling = 0;
+
+	QBENCHMARK {
+		ceiling = replay(false, &ds);
+	}
+	QCOMPARE(ceiling, referenceCeiling);
+}
+
+void TestDecoPerformance::replayScalar()
+{
+	struct deco_state ds;
+	int ceiling = 0;
+
+	QBENCHMARK {
+		ceiling = replay(true, &ds);
+	}
+	QCOMPARE(ceiling, referenceCeiling);
+}
+
+QTEST_GUILESS_MAIN(TestDecoPerformance)
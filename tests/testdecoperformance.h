@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTDECOPERFORMANCE_H
+#define TESTDECOPERFORMANCE_H
+
+#include <QtTest>
+
+class TestDecoPerformance : public QObject {
+	Q_OBJECT
+private slots:
+	void initTestCase();
+
+	void testScalarReference();
+	void replayVectorized();
+	void replayScalar();
+private:
+	int referenceCeiling;
+};
+
+#endif
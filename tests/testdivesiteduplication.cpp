@@ -11,4 +11,57 @@ void TestDiveSiteDuplication::testReadV2()
 	QCOMPARE(dive_site_table.nr, 2);
 }
 
+static struct dive_site *nearestSiteLinear(const location_t *loc, int distance, struct dive_site_table *ds_table)
+{
+	struct dive_site *res = nullptr;
+	unsigned int min_distance = distance;
+	for (int i = 0; i < ds_table->nr; i++) {
+		struct dive_site *ds = ds_table->dive_sites[i];
+		unsigned int cur_distance = get_distance(&ds->location, loc);
+		if (dive_site_has_gps_location(ds) && cur_distance < min_distance) {
+			min_distance = cur_distance;
+			res = ds;
+		}
+	}
+	return res;
+}
+
+void TestDiveSiteDuplication::testProximity()
+{
+	struct dive_site_table table = empty_dive_site_table;
+
+	// sites on a coarse grid, up to close to the poles and the antimeridian
+	for (int lat = -85; lat <= 85; lat += 5) {
+		for (int lon = -180; lon < 180; lon += 5) {
+			location_t loc = create_location(lat + 0.01 * lon / 5, lon + 0.003 * lat);
+			create_dive_site_with_gps("site", &loc, &table);
+		}
+	}
+
+	for (int lat = -90; lat <= 90; lat += 3) {
+		for (int lon = -180; lon < 180; lon += 7) {
+			location_t loc = create_location(lat, lon);
+			for (int distance: { 1000, 100000, 500000, 5000000 })
+				QCOMPARE(get_dive_site_by_gps_proximity(&loc, distance, &table),
+					 nearestSiteLinear(&loc, distance, &table));
+		}
+	}
+
+	// moving a site has to be picked up by the index
+	struct dive_site *ds = table.dive_sites[0];
+	location_t loc = create_location(12.3456, 65.4321);
+	QVERIFY(get_dive_site_by_gps(&loc, &table) == nullptr);
+	ds->location = loc;
+	invalidate_dive_site_grids();
+	QCOMPARE(get_dive_site_by_gps(&loc, &table), ds);
+	QCOMPARE(get_dive_site_by_gps_proximity(&loc, 100, &table), ds);
+
+	// as well as removing it
+	delete_dive_site(ds, &table);
+	QVERIFY(get_dive_site_by_gps(&loc, &table) == nullptr);
+
+	clear_dive_site_table(&table);
+	free(table.dive_sites);
+}
+
 QTEST_GUILESS_MAIN(TestDiveSiteDuplication)
@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testfiltercache.h"
+#include "core/dive.h"
+#include "core/divelist.h"
+#include "core/divesite.h"
+#include "core/file.h"
+#include "core/filtercache.h"
+#include "core/trip.h"
+
+void TestFilterCache::initTestCase()
+{
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/abitofeverything.ssrf", &dive_table, &trip_table, &dive_site_table), 0);
+	QVERIFY(dive_table.nr >= 3);
+}
+
+void TestFilterCache::cleanupTestCase()
+{
+	clear_dive_file_data();
+}
+
+void TestFilterCache::testLookup()
+{
+	FilterCache cache;
+	bool res;
+
+	cache.sync();
+	FilterCache::Entry *e = cache.entry(0);
+	QVERIFY(e != nullptr);
+	QCOMPARE(e->id, dive_table.dives[0]->id);
+	QVERIFY(cache.entry(dive_table.nr) == nullptr);
+	QVERIFY(!FilterCache::lookup(nullptr, FilterCache::TAGS, res));
+
+	QVERIFY(!FilterCache::lookup(e, FilterCache::TAGS, res));
+	FilterCache::store(e, FilterCache::TAGS, true);
+	FilterCache::store(e, FilterCache::PEOPLE, false);
+	QVERIFY(FilterCache::lookup(e, FilterCache::TAGS, res));
+	QCOMPARE(res, true);
+	QVERIFY(FilterCache::lookup(e, FilterCache::PEOPLE, res));
+	QCOMPARE(res, false);
+	QVERIFY(!FilterCache::lookup(e, FilterCache::SUIT, res));
+
+	// The results are overwritten
+	FilterCache::store(e, FilterCache::TAGS, false);
+	QVERIFY(FilterCache::lookup(e, FilterCache::TAGS, res));
+	QCOMPARE(res, false);
+
+	// An edited dive forgets everything
+	QCOMPARE(cache.reset(dive_table.dives[0]), e);
+	QVERIFY(!FilterCache::lookup(e, FilterCache::PEOPLE, res));
+}
+
+void TestFilterCache::testInvalidate()
+{
+	FilterCache cache;
+	bool res;
+
+	cache.sync();
+	for (int i = 0; i < dive_table.nr; i++) {
+		FilterCache::store(cache.entry(i), FilterCache::TAGS, true);
+		FilterCache::store(cache.entry(i), FilterCache::NOTES, true);
+	}
+	cache.invalidate(FilterCache::bit(FilterCache::NOTES));
+	for (int i = 0; i < dive_table.nr; i++) {
+		QVERIFY(FilterCache::lookup(cache.entry(i), FilterCache::TAGS, res));
+		QVERIFY(!FilterCache::lookup(cache.entry(i), FilterCache::NOTES, res));
+	}
+
+	cache.clear();
+	QVERIFY(cache.entry(0) == nullptr);
+}
+
+// The location depends on the trip and the dive site, which can be edited
+// without the filter of their dives being updated.
+void TestFilterCache::testLocationNotCached()
+{
+	FilterCache cache;
+	bool res;
+
+	cache.sync();
+	FilterCache::store(cache.entry(0), FilterCache::LOCATION, true);
+	QVERIFY(!FilterCache::lookup(cache.entry(0), FilterCache::LOCATION, res));
+}
+
+// The entries belong to the dives, not to the positions in the table
+void TestFilterCache::testTableChanges()
+{
+	FilterCache cache;
+	bool res;
+
+	cache.sync();
+	for (int i = 0; i < dive_table.nr; i++)
+		FilterCache::store(cache.entry(i), FilterCache::TAGS, true);
+
+	// Remove the first dive: all other dives move to a different position
+	int nr = dive_table.nr;
+	delete_single_dive(0);
+	cache.sync();
+	QVERIFY(cache.entry(nr - 1) == nullptr);
+	for (int i = 0; i < dive_table.nr; i++) {
+		QCOMPARE(cache.entry(i)->id, dive_table.dives[i]->id);
+		QVERIFY(!FilterCache::lookup(cache.entry(i), FilterCache::TAGS, res));
+	}
+
+	// Unchanged dives keep their results
+	for (int i = 0; i < dive_table.nr; i++)
+		FilterCache::store(cache.entry(i), FilterCache::TAGS, i % 2 == 0);
+	cache.sync();
+	for (int i = 0; i < dive_table.nr; i++) {
+		QVERIFY(FilterCache::lookup(cache.entry(i), FilterCache::TAGS, res));
+		QCOMPARE(res, i % 2 == 0);
+	}
+}
+
+QTEST_GUILESS_MAIN(TestFilterCache)
@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTFILTERCACHE_H
+#define TESTFILTERCACHE_H
+
+#include <QtTest>
+
+class TestFilterCache : public QObject {
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+
+	void testLookup();
+	void testInvalidate();
+	void testLocationNotCached();
+	void testTableChanges();
+};
+
+#endif
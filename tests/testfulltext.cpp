@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testfulltext.h"
+#include "core/dive.h"
+#include "core/divelist.h"
+#include "core/fulltext.h"
+
+#include <algorithm>
+
+static const char *notes[] = {
+	"Wreck diving Thistlegorm",
+	"Reef dive at Ras Mohammed",
+	"Night dive, wreck",
+	"a b",
+	"Tauchgang Übung"
+};
+
+void TestFullText::initTestCase()
+{
+	for (const char *s: notes) {
+		struct dive *d = alloc_dive();
+		d->notes = strdup(s);
+		record_dive_to_table(d, &dive_table);
+	}
+	fulltext_populate();
+}
+
+void TestFullText::cleanupTestCase()
+{
+	clear_dive_file_data();
+}
+
+// Indexes of the dives found by the index
+static QVector<int> find(const QString &s, StringFilterMode mode)
+{
+	FullTextQuery q;
+	q = s;
+	QVector<int> res;
+	for (const dive *d: fulltext_find_dives(q, mode).dives)
+		res.push_back(get_divenr(d));
+	std::sort(res.begin(), res.end());
+	return res;
+}
+
+void TestFullText::testSubstring()
+{
+	// Queries of three or more characters use the trigrams
+	QCOMPARE(find("reck", StringFilterMode::SUBSTRING), QVector<int>({ 0, 2 }));
+	QCOMPARE(find("ECK", StringFilterMode::SUBSTRING), QVector<int>({ 0, 2 }));
+	QCOMPARE(find("thistlegorm", StringFilterMode::SUBSTRING), QVector<int>({ 0 }));
+	QCOMPARE(find("übung", StringFilterMode::SUBSTRING), QVector<int>({ 4 }));
+	QCOMPARE(find("xyz", StringFilterMode::SUBSTRING), QVector<int>());
+	// All trigrams exist, but not in the same word
+	QCOMPARE(find("wreef", StringFilterMode::SUBSTRING), QVector<int>());
+
+	// Shorter queries scan all words
+	QCOMPARE(find("iv", StringFilterMode::SUBSTRING), QVector<int>({ 0, 1, 2 }));
+	QCOMPARE(find("a", StringFilterMode::SUBSTRING), QVector<int>({ 1, 3, 4 }));
+	QCOMPARE(find("üb", StringFilterMode::SUBSTRING), QVector<int>({ 4 }));
+	QCOMPARE(find("q", StringFilterMode::SUBSTRING), QVector<int>());
+}
+
+void TestFullText::testStartsWith()
+{
+	QCOMPARE(find("div", StringFilterMode::STARTSWITH), QVector<int>({ 0, 1, 2 }));
+	QCOMPARE(find("w", StringFilterMode::STARTSWITH), QVector<int>({ 0, 2 }));
+	QCOMPARE(find("reck", StringFilterMode::STARTSWITH), QVector<int>());
+	QCOMPARE(find("ree", StringFilterMode::STARTSWITH), QVector<int>({ 1 }));
+}
+
+void TestFullText::testExact()
+{
+	QCOMPARE(find("dive", StringFilterMode::EXACT), QVector<int>({ 1, 2 }));
+	QCOMPARE(find("div", StringFilterMode::EXACT), QVector<int>());
+	QCOMPARE(find("a", StringFilterMode::EXACT), QVector<int>({ 3 }));
+	QCOMPARE(find("wreck", StringFilterMode::EXACT), QVector<int>({ 0, 2 }));
+}
+
+// A dive must match all words of the query
+void TestFullText::testMultipleWords()
+{
+	QCOMPARE(find("wreck night", StringFilterMode::SUBSTRING), QVector<int>({ 2 }));
+	QCOMPARE(find("ree ras", StringFilterMode::STARTSWITH), QVector<int>({ 1 }));
+	QCOMPARE(find("dive wreck", StringFilterMode::EXACT), QVector<int>({ 2 }));
+	QCOMPARE(find("a b", StringFilterMode::EXACT), QVector<int>({ 3 }));
+	QCOMPARE(find("wreck reef", StringFilterMode::SUBSTRING), QVector<int>());
+}
+
+// The index has to give the same result as testing each dive
+void TestFullText::testFindMatchesDive()
+{
+	const char *queries[] = { "a", "b", "ü", "iv", "EC", "div", "dive", "reck", "ohamm", "ung", "gang", "x" };
+	StringFilterMode modes[] = { StringFilterMode::SUBSTRING, StringFilterMode::STARTSWITH, StringFilterMode::EXACT };
+	for (const char *s: queries) {
+		FullTextQuery q;
+		q = s;
+		for (StringFilterMode mode: modes) {
+			FullTextResult res = fulltext_find_dives(q, mode);
+			for (int i = 0; i < dive_table.nr; ++i) {
+				const dive *d = get_dive(i);
+				QCOMPARE(res.dive_matches(d), fulltext_dive_matches(d, q, mode));
+			}
+		}
+	}
+}
+
+QTEST_GUILESS_MAIN(TestFullText)
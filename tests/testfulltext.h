@@ -0,0 +1,20 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTFULLTEXT_H
+#define TESTFULLTEXT_H
+
+#include <QtTest>
+
+class TestFullText : public QObject {
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+
+	void testSubstring();
+	void testStartsWith();
+	void testExact();
+	void testMultipleWords();
+	void testFindMatchesDive();
+};
+
+#endif
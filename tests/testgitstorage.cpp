@@ -211,6 +211,106 @@ void TestGitStorage::testGitStorageLocal()
 	QCOMPARE(readin, written);
 }
 
+static QString branchTreeId(const QString &repoName)
+{
+	git_repository *repo;
+	git_object *tree;
+	char hex[GIT_OID_HEXSZ + 1];
+
+	if (git_repository_open(&repo, qPrintable(repoName)))
+		return QString();
+	if (git_revparse_single(&tree, repo, "test^{tree}")) {
+		git_repository_free(repo);
+		return QString();
+	}
+	git_oid_tostr(hex, sizeof(hex), git_object_id(tree));
+	git_object_free(tree);
+	git_repository_free(repo);
+	return QString(hex);
+}
+
+void TestGitStorage::testGitStorageIncremental()
+{
+	// an incremental save has to result in the same tree as a full save
+	git_repository *repo;
+	QString incrementalName("./gittestincremental");
+	QString fullName("./gittestfull");
+	QCOMPARE(QDir(incrementalName).removeRecursively(), true);
+	QCOMPARE(QDir(fullName).removeRecursively(), true);
+	QCOMPARE(QDir().mkdir(incrementalName), true);
+	QCOMPARE(QDir().mkdir(fullName), true);
+	QCOMPARE(git_repository_init(&repo, qPrintable(incrementalName), false), 0);
+	git_repository_free(repo);
+	QCOMPARE(git_repository_init(&repo, qPrintable(fullName), false), 0);
+	git_repository_free(repo);
+
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/SampleDivesV2.ssrf", &dive_table, &trip_table, &dive_site_table), 0);
+	QVERIFY(dive_table.nr > 1);
+	QVERIFY(trip_table.nr > 0);
+	QCOMPARE(save_dives(qPrintable(incrementalName + "[test]")), 0);
+	QString firstTree = branchTreeId(incrementalName);
+
+	// change a dive, and a trip, which isn't tracked by the dive cache
+	struct dive *d = get_dive(0);
+	free(d->notes);
+	d->notes = strdup("incremental save");
+	invalidate_dive_cache(d);
+	dive_trip_t *trip = trip_table.trips[0];
+	free(trip->location);
+	trip->location = strdup("Incremental");
+	QCOMPARE(save_dives(qPrintable(incrementalName + "[test]")), 0);
+	QString incrementalTree = branchTreeId(incrementalName);
+	QVERIFY(incrementalTree != firstTree);
+
+	// nothing changed, so the tree mustn't change either
+	QCOMPARE(save_dives(qPrintable(incrementalName + "[test]")), 0);
+	QCOMPARE(branchTreeId(incrementalName), incrementalTree);
+
+	// a new repository doesn't have the parent commit and gets a full save
+	QCOMPARE(save_dives(qPrintable(fullName + "[test]")), 0);
+	QCOMPARE(branchTreeId(fullName), incrementalTree);
+}
+
+static QString readFile(const QString &fileName)
+{
+	QFile f(fileName);
+	if (!f.open(QFile::ReadOnly))
+		return QString();
+	QTextStream s(&f);
+	return s.readAll();
+}
+
+void TestGitStorage::testGitStorageParallelLoad()
+{
+	// the dives of a repository are parsed on a thread pool - this
+	// has to give the same result as parsing them one after the other
+	git_repository *repo;
+	QString repoName("./gittestparallel");
+	QCOMPARE(QDir(repoName).removeRecursively(), true);
+	QCOMPARE(QDir().mkdir(repoName), true);
+	QCOMPARE(git_repository_init(&repo, qPrintable(repoName), false), 0);
+	git_repository_free(repo);
+
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/abitofeverything.ssrf", &dive_table, &trip_table, &dive_site_table), 0);
+	QVERIFY(dive_table.nr > 1);
+	QCOMPARE(save_dives(qPrintable(repoName + "[test]")), 0);
+	clear_dive_file_data();
+
+	git_load_sequential = true;
+	int res = parse_file(qPrintable(repoName + "[test]"), &dive_table, &trip_table, &dive_site_table);
+	git_load_sequential = false;
+	QCOMPARE(res, 0);
+	QCOMPARE(save_dives("./gittestsequential.ssrf"), 0);
+	clear_dive_file_data();
+
+	QCOMPARE(parse_file(qPrintable(repoName + "[test]"), &dive_table, &trip_table, &dive_site_table), 0);
+	QCOMPARE(save_dives("./gittestparallel.ssrf"), 0);
+
+	QString sequential = readFile("./gittestsequential.ssrf");
+	QVERIFY(!sequential.isEmpty());
+	QCOMPARE(readFile("./gittestparallel.ssrf"), sequential);
+}
+
 void TestGitStorage::testGitStorageCloud()
 {
 	// test writing and reading back from cloud storage
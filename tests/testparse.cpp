@@ -291,6 +291,25 @@ void TestParse::testParseDLD()
 		     SUBSURFACE_TEST_DATA "/dives/TestDiveDivelogsDE.xml")
 }
 
+void TestParse::testParseTruncated()
+{
+	// The file is parsed while it is read. A truncated file must
+	// not leave the dives that were parsed before the error.
+	struct memblock mem;
+	QVERIFY(readfile(SUBSURFACE_TEST_DATA "/dives/abitofeverything.ssrf", &mem) > 0);
+	int size = mem.size / 2;
+	((char *)mem.buffer)[size] = 0;
+	QVERIFY(parse_xml_buffer("truncated.ssrf", (const char *)mem.buffer, size, &dive_table, &trip_table, &dive_site_table, NULL) != 0);
+	QCOMPARE(dive_table.nr, 0);
+	QCOMPARE(trip_table.nr, 0);
+	QCOMPARE(dive_site_table.nr, 0);
+	free(mem.buffer);
+
+	// The complete file is imported as usual
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/abitofeverything.ssrf", &dive_table, &trip_table, &dive_site_table), 0);
+	QVERIFY(dive_table.nr > 0);
+}
+
 void TestParse::testParseMerge()
 {
 	/*
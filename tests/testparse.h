@@ -23,6 +23,7 @@ private slots:
 	void testParseHUDC();
 	void testParseNewFormat();
 	void testParseDLD();
+	void testParseTruncated();
 	void testParseMerge();
 
 	int parseCSVmanual(int, std::string);
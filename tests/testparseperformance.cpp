@@ -1,11 +1,13 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "testparseperformance.h"
+#include "git2.h"
 #include "core/divesite.h"
 #include "core/trip.h"
 #include "core/file.h"
 #include "core/git-access.h"
 #include "core/settings/qPrefProxy.h"
 #include "core/settings/qPrefCloudStorage.h"
+#include <QDir>
 #include <QFile>
 #include <QDebug>
 #include <QNetworkProxy>
@@ -83,4 +85,33 @@ void TestParsePerformance::parseGit()
 	}
 }
 
+void TestParsePerformance::parseLocalGit()
+{
+	// the dive blobs of a git repository are parsed in parallel - measure
+	// this without the network by writing the large sample to a local repo
+	QFile largeSsrfFile(SUBSURFACE_TEST_DATA "/dives/large-anon.ssrf");
+	if (!largeSsrfFile.exists()) {
+		qDebug() << "missing large sample data file - available at " LARGE_TEST_REPO;
+		return;
+	}
+	git_libgit2_init();
+
+	QString testDirName("./largeanon");
+	QDir testDir(testDirName);
+	QCOMPARE(testDir.removeRecursively(), true);
+	QCOMPARE(QDir().mkdir(testDirName), true);
+	git_repository *repo;
+	QCOMPARE(git_repository_init(&repo, qPrintable(testDirName), false), 0);
+	git_repository_free(repo);
+
+	QString repoName = testDirName + "[perf]";
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/large-anon.ssrf", &dive_table, &trip_table, &dive_site_table), 0);
+	QCOMPARE(save_dives(qPrintable(repoName)), 0);
+	cleanup();
+
+	QBENCHMARK {
+		parse_file(qPrintable(repoName), &dive_table, &trip_table, &dive_site_table);
+	}
+}
+
 QTEST_GUILESS_MAIN(TestParsePerformance)
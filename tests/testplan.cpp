@@ -3,6 +3,7 @@
 #include "core/deco.h"
 #include "core/dive.h"
 #include "core/planner.h"
+#include "core/profile.h"
 #include "core/qthelper.h"
 #include "core/subsurfacestartup.h"
 #include "core/units.h"
@@ -895,4 +896,83 @@ void TestPlan::testVpmbMetricRepeat()
 	QCOMPARE(finalDiveRunTimeSeconds, firstDiveRunTimeSeconds);
 }
 
+// The VPM-B scenarios above, for timing the CVA iterations of the planner and of the profile
+static const struct {
+	const char *name;
+	void (*setup)(struct diveplan *dp);
+} vpmbScenarios[] = {
+	{ "45m 30min Tx", setupPlanVpmb45m30mTx },
+	{ "60m 10min Tx", setupPlanVpmb60m10mTx },
+	{ "60m 30min Air", setupPlanVpmb60m30minAir },
+	{ "60m 30min EAN50", setupPlanVpmb60m30minEan50 },
+	{ "60m 30min Tx", setupPlanVpmb60m30minTx },
+	{ "100m 60min", setupPlanVpmb100m60min },
+	{ "Multi level Air", setupPlanVpmbMultiLevelAir },
+	{ "100m 10min", setupPlanVpmb100m10min },
+	{ "30m 20min", setupPlanVpmb30m20min },
+	{ "100m to 70m 30min", setupPlanVpmb100mTo70m30min }
+};
+
+static void addVpmbScenarios()
+{
+	QTest::addColumn<int>("scenario");
+	for (int i = 0; i < (int)(sizeof(vpmbScenarios) / sizeof(vpmbScenarios[0])); i++)
+		QTest::newRow(vpmbScenarios[i].name) << i;
+}
+
+void TestPlan::benchmarkVpmbPlan_data()
+{
+	addVpmbScenarios();
+}
+
+void TestPlan::benchmarkVpmbPlan()
+{
+	QFETCH(int, scenario);
+	struct deco_state *cache = NULL;
+	struct diveplan testPlan = {};
+
+	setupPrefsVpmb();
+	prefs.unit_system = METRIC;
+	prefs.units.length = units::METERS;
+	setAppState(ApplicationState::PlanDive);
+
+	QBENCHMARK {
+		vpmbScenarios[scenario].setup(&testPlan);
+		plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+	}
+	free(cache);
+}
+
+void TestPlan::benchmarkVpmbProfile_data()
+{
+	addVpmbScenarios();
+}
+
+// The profile of the planned dive, as shown in the dive list
+void TestPlan::benchmarkVpmbProfile()
+{
+	QFETCH(int, scenario);
+	struct deco_state *cache = NULL;
+	struct diveplan testPlan = {};
+
+	setupPrefsVpmb();
+	prefs.unit_system = METRIC;
+	prefs.units.length = units::METERS;
+	setAppState(ApplicationState::PlanDive);
+	vpmbScenarios[scenario].setup(&testPlan);
+	plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+	free(cache);
+
+	setAppState(ApplicationState::Default);
+	prefs.display_deco_mode = VPMB;
+	prefs.calcndltts = true;
+	QBENCHMARK {
+		// A new plot info each time, so that nothing is resumed from the previous calculation
+		struct plot_info pi;
+		init_plot_info(&pi);
+		create_plot_info_new(&displayed_dive, &displayed_dive.dc, &pi, false, nullptr);
+		free_plot_info_data(&pi);
+	}
+}
+
 QTEST_GUILESS_MAIN(TestPlan)
@@ -19,6 +19,10 @@ private slots:
 	void testVpmbMetric100m10min();
 	void testVpmbMetricRepeat();
 	void testMultipleGases();
+	void benchmarkVpmbPlan_data();
+	void benchmarkVpmbPlan();
+	void benchmarkVpmbProfile_data();
+	void benchmarkVpmbProfile();
 };
 
 #endif // TESTPLAN_H
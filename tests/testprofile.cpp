@@ -4,6 +4,15 @@
 #include "core/trip.h"
 #include "core/file.h"
 #include "core/save-profiledata.h"
+#include "core/divelist.h"
+#include "core/profile.h"
+#include "core/plotinfoservice.h"
+#include "core/deco.h"
+#include "core/fulltext.h"
+#include "core/gaspressures.h"
+#include "core/pref.h"
+
+#include <utility>
 
 // This test compares the content of struct profile against a known reference version for a list
 // of dives to prevent accidental regressions. Thus is you change anything in the profile this
@@ -29,4 +38,315 @@ void TestProfile::testProfileExport()
 
 }
 
+// Everything that is written by the deco calculation
+static void compareDeco(const struct plot_info *pi, const struct plot_info *ref)
+{
+	QCOMPARE(pi->nr, ref->nr);
+	for (int i = 0; i < pi->nr; i++) {
+		const struct plot_data *entry = pi->entry + i;
+		const struct plot_data *ref_entry = ref->entry + i;
+
+		QCOMPARE(entry->ambpressure, ref_entry->ambpressure);
+		QCOMPARE(entry->gfline, ref_entry->gfline);
+		QCOMPARE(entry->icd_warning, ref_entry->icd_warning);
+		QCOMPARE(entry->ceiling, ref_entry->ceiling);
+		QCOMPARE(entry->ndl, ref_entry->ndl);
+		QCOMPARE(entry->surface_gf, ref_entry->surface_gf);
+		QCOMPARE(entry->current_gf, ref_entry->current_gf);
+		QCOMPARE(entry->in_deco_calc, ref_entry->in_deco_calc);
+		QCOMPARE(entry->ndl_calc, ref_entry->ndl_calc);
+		QCOMPARE(entry->tts_calc, ref_entry->tts_calc);
+		QCOMPARE(entry->stoptime_calc, ref_entry->stoptime_calc);
+		QCOMPARE(entry->stopdepth_calc, ref_entry->stopdepth_calc);
+		QCOMPARE(memcmp(pi->tissues + i, ref->tissues + i, sizeof(ref->tissues[i])), 0);
+	}
+}
+
+// Recalculating the profile of an edited dive resumes the deco calculation from a
+// checkpoint. Make sure that this gives the same results as calculating it from scratch.
+void TestProfile::testIncrementalDeco()
+{
+	int i, resumed = 0;
+	struct dive *d;
+
+	clear_dive_file_data();
+	parse_file("../dives/abitofeverything.ssrf", &dive_table, &trip_table, &dive_site_table);
+	for_each_dive (i, d) {
+		struct plot_info pi, ref;
+		struct divecomputer *dc = &d->dc;
+		int edit_time;
+
+		if (dc->samples < 3)
+			continue;
+		init_plot_info(&pi);
+		init_plot_info(&ref);
+		create_plot_info_new(d, dc, &pi, false, nullptr);
+		dc->sample[dc->samples - 2].depth.mm += 1000;
+		create_plot_info_new(d, dc, &pi, false, nullptr);
+		create_plot_info_new(d, dc, &ref, false, nullptr);
+		compareDeco(&pi, &ref);
+
+		// Only the entries before the edited part of the profile may be taken over
+		edit_time = dc->sample[dc->samples - 3].time.seconds;
+		QVERIFY(pi.deco_resumed_entries < pi.nr);
+		if (pi.deco_resumed_entries > 0) {
+			QVERIFY(pi.entry[pi.deco_resumed_entries].sec <= edit_time);
+			resumed++;
+		}
+		free_plot_info_data(&pi);
+		free_plot_info_data(&ref);
+	}
+	// Otherwise the above tests nothing
+	QVERIFY(resumed > 0);
+}
+
+static void compareDepthAndDeco(const struct plot_info *pi, const struct plot_info *ref)
+{
+	QCOMPARE(pi->nr, ref->nr);
+	for (int i = 0; i < pi->nr; i++) {
+		QCOMPARE(pi->entry[i].sec, ref->entry[i].sec);
+		QCOMPARE(pi->entry[i].depth, ref->entry[i].depth);
+		QCOMPARE(pi->entry[i].ceiling, ref->entry[i].ceiling);
+		QCOMPARE(pi->entry[i].tts_calc, ref->entry[i].tts_calc);
+	}
+}
+
+// The cached plot info, which is calculated in parallel, must be the same as the one calculated
+// directly and must not be returned anymore once the dive was edited or its cache invalidated.
+void TestProfile::testPlotInfoCache()
+{
+	int i;
+	struct dive *d;
+
+	clear_dive_file_data();
+	parse_file("../dives/abitofeverything.ssrf", &dive_table, &trip_table, &dive_site_table);
+	precalculate_plot_info(dive_table.dives, dive_table.nr);
+	for_each_dive (i, d) {
+		struct plot_info pi, ref;
+		struct divecomputer *dc = &d->dc;
+
+		init_plot_info(&pi);
+		init_plot_info(&ref);
+		get_plot_info(d, &pi);
+		create_plot_info_new(d, dc, &ref, false, nullptr);
+		compareDepthAndDeco(&pi, &ref);
+		QVERIFY(lookup_plot_info(d, nullptr));
+		invalidate_dive_cache(d);
+		QVERIFY(!lookup_plot_info(d, nullptr));
+		if (dc->samples >= 2) {
+			dc->sample[dc->samples - 2].depth.mm += 1000;
+			get_plot_info(d, &pi);
+			create_plot_info_new(d, dc, &ref, false, nullptr);
+			compareDepthAndDeco(&pi, &ref);
+		}
+		free_plot_info_data(&pi);
+		free_plot_info_data(&ref);
+	}
+}
+
+static void compareDecoInit(struct dive *d)
+{
+	struct deco_state ds, ref;
+	int surface_time, ref_surface_time;
+
+	// The cached state must be the same as the one calculated from scratch
+	surface_time = init_decompression(&ds, d);
+	ref_surface_time = init_decompression_walk(&ref, d);
+	QCOMPARE(surface_time, ref_surface_time);
+	QCOMPARE(memcmp(ds.tissue_n2_sat, ref.tissue_n2_sat, sizeof(ds.tissue_n2_sat)), 0);
+	QCOMPARE(memcmp(ds.tissue_he_sat, ref.tissue_he_sat, sizeof(ds.tissue_he_sat)), 0);
+}
+
+// The tissue loading of previous dives is cached. Make sure that it is recalculated
+// when one of the previous dives is edited.
+void TestProfile::testDecoChainCache()
+{
+	int i;
+	struct dive *d;
+	struct deco_state ds;
+
+	clear_dive_file_data();
+	parse_file("../dives/abitofeverything.ssrf", &dive_table, &trip_table, &dive_site_table);
+	for_each_dive (i, d)
+		init_decompression(&ds, d);
+	for (i = 1; i < dive_table.nr; i++) {
+		struct divecomputer *dc = &dive_table.dives[i - 1]->dc;
+		if (dc->samples < 2)
+			continue;
+		dc->sample[dc->samples / 2].depth.mm += 5000;
+		invalidate_dive_cache(dive_table.dives[i - 1]);
+		compareDecoInit(dive_table.dives[i]);
+	}
+
+	// The undo commands exchange the data of a dive with that of an edited copy,
+	// which comes without a cache. Even if the cache isn't kept, as EditDive does,
+	// the following dives must not be calculated from the missing cache.
+	for (i = 1; i < dive_table.nr; i++) {
+		struct dive *old = dive_table.dives[i - 1];
+		struct dive *copy;
+
+		if (old->dc.samples < 2)
+			continue;
+		copy = alloc_dive();
+		copy_dive(old, copy);
+		copy->dc.sample[copy->dc.samples / 2].depth.mm += 5000;
+		fulltext_unregister(old);
+		std::swap(*copy, *old);
+		fulltext_register(old);
+		invalidate_dive_cache(old);
+		compareDecoInit(dive_table.dives[i]);
+		free_dive(copy);
+	}
+}
+
+// The min/max depths of the 9 minute windows around the plot entries are calculated in a single
+// pass. Compare them to a plain search of the window: the first entry with the smallest or largest
+// depth wins. (The sac rates are covered by the export test above.)
+void TestProfile::testMinMax()
+{
+	int i;
+	struct dive *d;
+
+	clear_dive_file_data();
+	parse_file("../dives/abitofeverything.ssrf", &dive_table, &trip_table, &dive_site_table);
+	for_each_dive (i, d) {
+		struct plot_info pi;
+
+		init_plot_info(&pi);
+		create_plot_info_new(d, &d->dc, &pi, false, nullptr);
+		for (int j = 0; j < pi.nr; j++) {
+			int min = -1, max = -1;
+			for (int k = 0; k < pi.nr; k++) {
+				if (pi.entry[k].sec < pi.entry[j].sec - 9 * 30 || pi.entry[k].sec > pi.entry[j].sec + 9 * 30)
+					continue;
+				if (min < 0 || pi.entry[k].depth < pi.entry[min].depth)
+					min = k;
+				if (max < 0 || pi.entry[k].depth > pi.entry[max].depth)
+					max = k;
+			}
+			QCOMPARE(pi.entry[j].min, min);
+			QCOMPARE(pi.entry[j].max, max);
+		}
+		free_plot_info_data(&pi);
+	}
+}
+
+// The pressures of all cylinders are interpolated in one pass. The references were
+// calculated with the previous implementation, which handled one cylinder at a time.
+// Cylinder 0 has a gap, is switched away from at 10 min and back at 15 min, and has
+// no data after its last sample. Cylinder 1 is used in between, cylinder 2 is a
+// diluent, which is interpolated over time instead of pressure-time.
+void TestProfile::testInterpolatedPressures()
+{
+	static const int nr = 20, nr_cylinders = 3;
+	static const int depths[nr] = {
+		0, 0, 10000, 20000, 30000, 30000, 28000, 25000, 22000, 21000,
+		21000, 18000, 15000, 12000, 9000, 6000, 6000, 5000, 3000, 0
+	};
+	static const int ref_pressure_time[nr] = {
+		0, 0, 91080, 151740, 212340, 242640, 236580, 221460, 203280, 191100,
+		188100, 178980, 160800, 142620, 124440, 0, 97140, 94140, 0, 0
+	};
+	static const int ref_pressures[nr_cylinders][nr] = {
+		{ 0, 200000, 197390, 193040, 186954, 180000, 170536, 166162, 162148, 158374,
+		  154659, 0, 0, 0, 0, 154659, 152293, 150000, 0, 0 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		  200000, 186147, 180078, 174696, 170000, 0, 0, 0, 0, 0 },
+		{ 0, 0, 200000, 199040, 198080, 197120, 196160, 195200, 194240, 193280,
+		  192320, 191360, 190000, 0, 0, 0, 0, 0, 0, 0 }
+	};
+	struct dive *d = alloc_dive();
+	struct plot_info pi;
+
+	d->surface_pressure.mbar = 1013;
+	d->salinity = 10300;
+	for (int c = 0; c < nr_cylinders; c++) {
+		cylinder_t *cyl = add_empty_cylinder(&d->cylinders);
+		cyl->start.mbar = 200000;
+		cyl->cylinder_use = c == 2 ? DILUENT : OC_GAS;
+	}
+	add_gas_switch_event(d, &d->dc, 600, 1);
+	add_gas_switch_event(d, &d->dc, 900, 0);
+
+	init_plot_info(&pi);
+	pi.nr = nr;
+	pi.nr_cylinders = nr_cylinders;
+	pi.entry = (struct plot_data *)calloc(nr, sizeof(struct plot_data));
+	pi.pressures = (struct plot_pressure_data *)calloc(nr * nr_cylinders, sizeof(struct plot_pressure_data));
+	for (int i = 0; i < nr; i++) {
+		pi.entry[i].sec = i * 60;
+		pi.entry[i].depth = depths[i];
+	}
+	set_plot_pressure_data(&pi, 1, SENSOR_PR, 0, 200000);
+	set_plot_pressure_data(&pi, 5, SENSOR_PR, 0, 180000);
+	set_plot_pressure_data(&pi, 17, SENSOR_PR, 0, 150000);
+	set_plot_pressure_data(&pi, 10, SENSOR_PR, 1, 200000);
+	set_plot_pressure_data(&pi, 14, SENSOR_PR, 1, 170000);
+	set_plot_pressure_data(&pi, 2, SENSOR_PR, 2, 200000);
+	set_plot_pressure_data(&pi, 12, SENSOR_PR, 2, 190000);
+
+	populate_pressure_information(d, &d->dc, &pi);
+	for (int i = 0; i < nr; i++) {
+		QCOMPARE(pi.entry[i].pressure_time, ref_pressure_time[i]);
+		for (int c = 0; c < nr_cylinders; c++)
+			QCOMPARE(get_plot_pressure(&pi, i, c), ref_pressures[c][i]);
+	}
+	free_plot_info_data(&pi);
+	free_dive(d);
+}
+
+// Restores the NDL / TTS preferences at the end of the scope, also if a test fails
+struct NdlTtsPrefsGuard {
+	bool calcndltts = prefs.calcndltts;
+	bool analyticndltts = prefs.analyticndltts;
+	enum deco_mode display_deco_mode = prefs.display_deco_mode;
+
+	~NdlTtsPrefsGuard()
+	{
+		prefs.calcndltts = calcndltts;
+		prefs.analyticndltts = analyticndltts;
+		prefs.display_deco_mode = display_deco_mode;
+	}
+};
+
+// The closed-form NDL / TTS is an approximation of the stepwise calculation. Both find the
+// NDL in whole minutes. It usually agrees exactly, but the closed form solves for the time
+// instead of adding minutes, which may round to the neighbouring minute. The TTS of the two
+// may differ by a few stop minutes.
+void TestProfile::testClosedFormNdlTts()
+{
+	int i, ndl_entries = 0, deco_entries = 0;
+	struct dive *d;
+	NdlTtsPrefsGuard guard;
+
+	prefs.calcndltts = true;
+	prefs.display_deco_mode = BUEHLMANN;
+	clear_dive_file_data();
+	parse_file("../dives/abitofeverything.ssrf", &dive_table, &trip_table, &dive_site_table);
+	for_each_dive (i, d) {
+		struct plot_info pi, ref;
+
+		init_plot_info(&pi);
+		init_plot_info(&ref);
+		prefs.analyticndltts = false;
+		create_plot_info_new(d, &d->dc, &ref, false, nullptr);
+		prefs.analyticndltts = true;
+		create_plot_info_new(d, &d->dc, &pi, false, nullptr);
+		QCOMPARE(pi.nr, ref.nr);
+		for (int j = 0; j < pi.nr; j++) {
+			QVERIFY(abs(pi.entry[j].ndl_calc - ref.entry[j].ndl_calc) <= 60);
+			QVERIFY(abs(pi.entry[j].tts_calc - ref.entry[j].tts_calc) <= 180);
+			if (ref.entry[j].ndl_calc > 0)
+				ndl_entries++;
+			if (ref.entry[j].tts_calc > 0)
+				deco_entries++;
+		}
+		free_plot_info_data(&pi);
+		free_plot_info_data(&ref);
+	}
+	// Otherwise the above tests nothing
+	QVERIFY(ndl_entries > 0);
+	QVERIFY(deco_entries > 0);
+}
+
 QTEST_GUILESS_MAIN(TestProfile)
@@ -9,6 +9,12 @@ class TestProfile : public QObject {
 	Q_OBJECT
 private slots:
 	void testProfileExport();
+	void testIncrementalDeco();
+	void testPlotInfoCache();
+	void testDecoChainCache();
+	void testMinMax();
+	void testInterpolatedPressures();
+	void testClosedFormNdlTts();
 };
 
 #endif
@@ -27,6 +27,7 @@ void TestQPrefTechnicalDetails::test_struct_get()
 	prefs.calcceiling = true;
 	prefs.calcceiling3m = true;
 	prefs.calcndltts = true;
+	prefs.analyticndltts = true;
 	prefs.dcceiling = true;
 	prefs.display_deco_mode = BUEHLMANN;
 	prefs.ead = true;
@@ -52,6 +53,7 @@ void TestQPrefTechnicalDetails::test_struct_get()
 	QCOMPARE(tst->calcceiling(), prefs.calcceiling);
 	QCOMPARE(tst->calcceiling3m(), prefs.calcceiling3m);
 	QCOMPARE(tst->calcndltts(), prefs.calcndltts);
+	QCOMPARE(tst->analyticndltts(), prefs.analyticndltts);
 	QCOMPARE(tst->dcceiling(), prefs.dcceiling);
 	QCOMPARE(tst->display_deco_mode(), prefs.display_deco_mode);
 	QCOMPARE(tst->ead(), prefs.ead);
@@ -85,6 +87,7 @@ void TestQPrefTechnicalDetails::test_set_struct()
 	tst->set_calcceiling(false);
 	tst->set_calcceiling3m(false);
 	tst->set_calcndltts(false);
+	tst->set_analyticndltts(false);
 	tst->set_dcceiling(false);
 	tst->set_display_deco_mode(RECREATIONAL);
 	tst->set_ead(false);
@@ -110,6 +113,7 @@ void TestQPrefTechnicalDetails::test_set_struct()
 	QCOMPARE(prefs.calcceiling, false);
 	QCOMPARE(prefs.calcceiling3m, false);
 	QCOMPARE(prefs.calcndltts, false);
+	QCOMPARE(prefs.analyticndltts, false);
 	QCOMPARE(prefs.dcceiling, false);
 	QCOMPARE(prefs.display_deco_mode, RECREATIONAL);
 	QCOMPARE(prefs.ead, false);
@@ -143,6 +147,7 @@ void TestQPrefTechnicalDetails::test_set_load_struct()
 	tst->set_calcceiling(false);
 	tst->set_calcceiling3m(false);
 	tst->set_calcndltts(false);
+	tst->set_analyticndltts(false);
 	tst->set_dcceiling(true);
 	tst->set_display_deco_mode(RECREATIONAL);
 	tst->set_ead(false);
@@ -169,6 +174,7 @@ void TestQPrefTechnicalDetails::test_set_load_struct()
 	prefs.calcceiling = true;
 	prefs.calcceiling3m = true;
 	prefs.calcndltts = true;
+	prefs.analyticndltts = true;
 	prefs.dcceiling = false;
 	prefs.display_deco_mode = BUEHLMANN;
 	prefs.ead = true;
@@ -195,6 +201,7 @@ void TestQPrefTechnicalDetails::test_set_load_struct()
 	QCOMPARE(prefs.calcceiling, false);
 	QCOMPARE(prefs.calcceiling3m, false);
 	QCOMPARE(prefs.calcndltts, false);
+	QCOMPARE(prefs.analyticndltts, false);
 	QCOMPARE(prefs.dcceiling, true);
 	QCOMPARE(prefs.display_deco_mode, RECREATIONAL);
 	QCOMPARE(prefs.ead, false);
@@ -228,6 +235,7 @@ void TestQPrefTechnicalDetails::test_struct_disk()
 	prefs.calcceiling = true;
 	prefs.calcceiling3m = true;
 	prefs.calcndltts = true;
+	prefs.analyticndltts = true;
 	prefs.dcceiling = true;
 	prefs.display_deco_mode = BUEHLMANN;
 	prefs.ead = true;
@@ -255,6 +263,7 @@ void TestQPrefTechnicalDetails::test_struct_disk()
 	prefs.calcceiling = false;
 	prefs.calcceiling3m = false;
 	prefs.calcndltts = false;
+	prefs.analyticndltts = false;
 	prefs.dcceiling = false;
 	prefs.display_deco_mode = RECREATIONAL;
 	prefs.ead = false;
@@ -281,6 +290,7 @@ void TestQPrefTechnicalDetails::test_struct_disk()
 	QCOMPARE(prefs.calcceiling, true);
 	QCOMPARE(prefs.calcceiling3m, true);
 	QCOMPARE(prefs.calcndltts, true);
+	QCOMPARE(prefs.analyticndltts, true);
 	QCOMPARE(prefs.dcceiling, true);
 	QCOMPARE(prefs.display_deco_mode, BUEHLMANN);
 	QCOMPARE(prefs.ead, true);
@@ -362,7 +372,9 @@ void TestQPrefTechnicalDetails::test_oldPreferences()
 	tecDetails->set_calcalltissues(true);
 	TEST(tecDetails->calcalltissues(), true);
 	tecDetails->set_calcndltts(true);
+	tecDetails->set_analyticndltts(true);
 	TEST(tecDetails->calcndltts(), true);
+	TEST(tecDetails->analyticndltts(), true);
 	tecDetails->set_hrgraph(true);
 	TEST(tecDetails->hrgraph(), true);
 	tecDetails->set_tankbar(true);
@@ -397,7 +409,9 @@ void TestQPrefTechnicalDetails::test_oldPreferences()
 	tecDetails->set_calcalltissues(false);
 	TEST(tecDetails->calcalltissues(), false);
 	tecDetails->set_calcndltts(false);
+	tecDetails->set_analyticndltts(false);
 	TEST(tecDetails->calcndltts(), false);
+	TEST(tecDetails->analyticndltts(), false);
 	tecDetails->set_hrgraph(false);
 	TEST(tecDetails->hrgraph(), false);
 	tecDetails->set_tankbar(false);
@@ -424,6 +438,7 @@ void TestQPrefTechnicalDetails::test_signals()
 	QSignalSpy spy2(qPrefTechnicalDetails::instance(), &qPrefTechnicalDetails::calcceilingChanged);
 	QSignalSpy spy3(qPrefTechnicalDetails::instance(), &qPrefTechnicalDetails::calcceiling3mChanged);
 	QSignalSpy spy4(qPrefTechnicalDetails::instance(), &qPrefTechnicalDetails::calcndlttsChanged);
+	QSignalSpy spy28(qPrefTechnicalDetails::instance(), &qPrefTechnicalDetails::analyticndlttsChanged);
 	QSignalSpy spy5(qPrefTechnicalDetails::instance(), &qPrefTechnicalDetails::dcceilingChanged);
 	QSignalSpy spy6(qPrefTechnicalDetails::instance(), &qPrefTechnicalDetails::display_deco_modeChanged);
 	QSignalSpy spy8(qPrefTechnicalDetails::instance(), &qPrefTechnicalDetails::eadChanged);
@@ -453,7 +468,9 @@ void TestQPrefTechnicalDetails::test_signals()
 	prefs.calcceiling3m = true;
 	qPrefTechnicalDetails::set_calcceiling3m(false);
 	prefs.calcndltts = true;
+	prefs.analyticndltts = true;
 	qPrefTechnicalDetails::set_calcndltts(false);
+	qPrefTechnicalDetails::set_analyticndltts(false);
 	prefs.dcceiling = true;
 	qPrefTechnicalDetails::set_dcceiling(false);
 	qPrefTechnicalDetails::set_display_deco_mode(VPMB);
@@ -517,6 +534,7 @@ void TestQPrefTechnicalDetails::test_signals()
 	QCOMPARE(spy25.count(), 1);
 	QCOMPARE(spy26.count(), 1);
 	QCOMPARE(spy27.count(), 1);
+	QCOMPARE(spy28.count(), 1);
 
 	QVERIFY(spy1.takeFirst().at(0).toBool() == false);
 	QVERIFY(spy2.takeFirst().at(0).toBool() == false);
@@ -4,6 +4,7 @@
 #include "core/divesite.h"
 #include "core/trip.h"
 #include "core/file.h"
+#include "core/divelist.h"
 #include <QTextStream>
 
 void TestRenumber::setup()
@@ -39,4 +40,56 @@ void TestRenumber::testMergeAndAppend()
 		QCOMPARE(d->number, 2);
 }
 
+// All dives, trips and sites of the tables must be found by their id
+static void compareLookups()
+{
+	for (int i = 0; i < dive_table.nr; i++) {
+		struct dive *d = dive_table.dives[i];
+		QCOMPARE(get_dive_by_uniq_id(d->id), d);
+		QCOMPARE(get_divenr(d), i);
+		QCOMPARE(get_idx_by_uniq_id(d->id), i);
+		if (i > 0)
+			QVERIFY(dive_less_than(dive_table.dives[i - 1], d));
+		if (d->divetrip)
+			QCOMPARE(get_trip_by_uniq_id(d->divetrip->id), d->divetrip);
+		if (d->dive_site)
+			QCOMPARE(get_dive_site_by_uuid(d->dive_site->uuid, &dive_site_table), d->dive_site);
+	}
+}
+
+void TestRenumber::testLookupById()
+{
+	// The imported dives were merged into the table in one go and the
+	// id index was built along the way - both have to agree with the table.
+	compareLookups();
+	QVERIFY(get_dive_by_uniq_id(-1) == NULL);
+	QCOMPARE(get_idx_by_uniq_id(-1), dive_table.nr);
+
+	// A removed dive must not be found anymore
+	QVERIFY(dive_table.nr >= 2);
+	int id = dive_table.dives[0]->id;
+	delete_single_dive(0);
+	QVERIFY(get_dive_by_uniq_id(id) == NULL);
+	compareLookups();
+
+	// The index moves with the dives. Tables other than the global one are searched linearly.
+	struct dive_table table = empty_dive_table;
+	struct dive *d = dive_table.dives[0];
+	id = d->id;
+	move_dive_table(&dive_table, &table);
+	QVERIFY(get_dive_by_uniq_id(id) == NULL);
+	QCOMPARE(get_by_id_in_dive_table(&table, id), d);
+	move_dive_table(&table, &dive_table);
+	QVERIFY(get_by_id_in_dive_table(&table, id) == NULL);
+	compareLookups();
+
+	// Clearing the table drops the index, which must be rebuilt when dives are added again
+	clear_dive_file_data();
+	QVERIFY(get_dive_by_uniq_id(id) == NULL);
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/test47.xml", &dive_table, &trip_table, &dive_site_table), 0);
+	process_loaded_dives();
+	QVERIFY(dive_table.nr > 0);
+	compareLookups();
+}
+
 QTEST_GUILESS_MAIN(TestRenumber)
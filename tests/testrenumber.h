@@ -10,6 +10,7 @@ private slots:
 	void setup();
 	void testMerge();
 	void testMergeAndAppend();
+	void testLookupById();
 };
 
 #endif
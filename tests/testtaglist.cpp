@@ -80,4 +80,38 @@ void TestTagList::testGetTagstringEmptyTagOnly()
 	free(tagstring);
 }
 
+void TestTagList::testCopySharesTags()
+{
+	struct tag_entry *tag_list = NULL;
+	struct divetag *tag = taglist_add_tag(&tag_list, "A shared tag");
+	QVERIFY(taglist_add_tag(&g_tag_list, "A shared tag") == tag);
+	struct tag_entry *copy = taglist_copy(tag_list);
+	QVERIFY(copy != NULL);
+	QVERIFY(copy->tag == tag);
+	QVERIFY(copy->next == NULL);
+	taglist_free(copy);
+	taglist_free(tag_list);
+}
+
+// Adding a tag finds the existing one in g_tag_list by a hashed index,
+// which must not get out of sync when g_tag_list is freed elsewhere.
+void TestTagList::testGlobalTagIndex()
+{
+	struct tag_entry *tag_list = NULL;
+	for (int i = 0; i < 1000; i++)
+		taglist_add_tag(&tag_list, qPrintable(QString("tag %1").arg(i % 300)));
+	struct divetag *tag = taglist_add_tag(&g_tag_list, "tag 42");
+	QVERIFY(taglist_add_tag(&tag_list, "tag 42") == tag);
+	QVERIFY(taglist_contains(g_tag_list, "tag 299"));
+
+	taglist_free(g_tag_list);
+	g_tag_list = NULL;
+	tag = taglist_add_tag(&tag_list, "tag 42");
+	QVERIFY(g_tag_list != NULL);
+	QVERIFY(g_tag_list->tag == tag);
+	QVERIFY(g_tag_list->next == NULL);
+	taglist_free(tag_list);
+	taglist_init_global();
+}
+
 QTEST_GUILESS_MAIN(TestTagList)
@@ -15,6 +15,8 @@ private slots:
 	void testGetTagstringMultipleTags();
 	void testGetTagstringWithAnEmptyTag();
 	void testGetTagstringEmptyTagOnly();
+	void testCopySharesTags();
+	void testGlobalTagIndex();
 };
 
 #endif
@@ -113,6 +113,10 @@ TestCase {
 		var x27 = PrefTechnicalDetails.zoomed_plot
 		PrefTechnicalDetails.zoomed_plot = true
 		compare(PrefTechnicalDetails.zoomed_plot, true)
+
+		var x28 = PrefTechnicalDetails.analyticndltts
+		PrefTechnicalDetails.analyticndltts = true
+		compare(PrefTechnicalDetails.analyticndltts, true)
 	}
 
 	Item {
@@ -144,6 +148,7 @@ TestCase {
 		property bool spy25 : false
 		property bool spy26 : false
 		property bool spy27 : false
+		property bool spy28 : false
 
 		Connections {
 			target: PrefTechnicalDetails
@@ -173,6 +178,7 @@ TestCase {
 			onTankbarChanged: {spyCatcher.spy25 = true }
 			onVpmb_conservatismChanged: {spyCatcher.spy26 = true }
 			onZoomed_plotChanged: {spyCatcher.spy27 = true }
+			onAnalyticndlttsChanged: {spyCatcher.spy28 = true }
 		}
 	}
 
@@ -204,6 +210,7 @@ TestCase {
 		PrefTechnicalDetails.tankbar = ! PrefTechnicalDetails.tankbar
 		PrefTechnicalDetails.vpmb_conservatism = -127
 		PrefTechnicalDetails.zoomed_plot = ! PrefTechnicalDetails.zoomed_plot
+		PrefTechnicalDetails.analyticndltts = ! PrefTechnicalDetails.analyticndltts
 
 		compare(spyCatcher.spy1, true)
 		compare(spyCatcher.spy2, true)
@@ -232,5 +239,6 @@ TestCase {
 		compare(spyCatcher.spy25, true)
 		compare(spyCatcher.spy26, true)
 		compare(spyCatcher.spy27, true)
+		compare(spyCatcher.spy28, true)
 	}
 }